@@ -0,0 +1,105 @@
+// highlights one wide line with every highlighter, the kind of line a minified file or a long log message has, so the
+// cost of a view is dominated by how fast a highlighter walks a line.
+//
+// usage: bench_ce_syntax
+
+#include "ce_syntax.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <locale.h>
+
+#define BENCH_LINE_LEN 4096
+#define BENCH_ITERATIONS 20
+
+FILE* g_ce_log = NULL;
+CeBuffer_t* g_ce_log_buffer = NULL;
+
+static CeSyntaxDef_t g_syntax_defs[CE_SYNTAX_COLOR_COUNT];
+
+static char* generate_wide_line(){
+     static const char* pattern = "if(value_%d == 0x1F){ call(\"str\", 'c', 3.5f); } /* ¢ */ ";
+     char* line = malloc(BENCH_LINE_LEN + 1);
+     if(!line) return NULL;
+     char chunk[128];
+     int64_t line_len = 0;
+     for(int i = 0; true; i++){
+          int64_t chunk_len = snprintf(chunk, sizeof(chunk), pattern, i);
+          if(line_len + chunk_len > BENCH_LINE_LEN) break;
+          memcpy(line + line_len, chunk, chunk_len);
+          line_len += chunk_len;
+     }
+     memset(line + line_len, 'x', BENCH_LINE_LEN - line_len);
+     line[BENCH_LINE_LEN] = 0;
+     return line;
+}
+
+static void highlight(CeSyntaxHighlightFunc_t* highlight_func, CeBuffer_t* buffer, CeDrawColorList_t* draw_color_list){
+     CeView_t view = {};
+     view.buffer = buffer;
+     view.rect = (CeRect_t){0, 79, 0, 0};
+     view.cursor = (CePoint_t){0, buffer->line_count};
+     CeRangeList_t range_list = {};
+     ce_draw_color_list_clear(draw_color_list);
+     highlight_func(&view, &range_list, draw_color_list, g_syntax_defs, NULL);
+     ce_range_list_free(&range_list);
+}
+
+int main(){
+     g_ce_log_buffer = calloc(1, sizeof(*g_ce_log_buffer));
+     ce_buffer_alloc(g_ce_log_buffer, 1, "[log]");
+     ce_log_init("ce_bench.log");
+     setlocale(LC_ALL, "");
+     for(int i = 0; i < CE_SYNTAX_COLOR_COUNT; i++){
+          g_syntax_defs[i].fg = i;
+          g_syntax_defs[i].bg = COLOR_DEFAULT;
+     }
+     g_syntax_defs[CE_SYNTAX_COLOR_NORMAL].fg = COLOR_DEFAULT;
+
+     static struct{
+          const char* name;
+          CeSyntaxHighlightFunc_t* func;
+     }languages[] = {
+          {"c", ce_syntax_highlight_c},
+          {"cpp", ce_syntax_highlight_cpp},
+          {"java", ce_syntax_highlight_java},
+          {"python", ce_syntax_highlight_python},
+          {"bash", ce_syntax_highlight_bash},
+          {"config", ce_syntax_highlight_config},
+          {"rust", ce_syntax_highlight_rust},
+          {"go", ce_syntax_highlight_go},
+          {"json", ce_syntax_highlight_json},
+          {"yaml", ce_syntax_highlight_yaml},
+          {"markdown", ce_syntax_highlight_markdown},
+          {"makefile", ce_syntax_highlight_makefile},
+          {"diff", ce_syntax_highlight_diff},
+          {"plain", ce_syntax_highlight_plain},
+     };
+
+     char* line = generate_wide_line();
+     if(!line) return 1;
+     CeBuffer_t buffer = {};
+     ce_buffer_load_string(&buffer, line, "bench");
+     CeDrawColorList_t draw_color_list = {};
+
+     for(size_t l = 0; l < sizeof(languages) / sizeof(languages[0]); l++){
+          struct timespec start;
+          struct timespec end;
+          clock_gettime(CLOCK_MONOTONIC, &start);
+          for(int i = 0; i < BENCH_ITERATIONS; i++){
+               highlight(languages[l].func, &buffer, &draw_color_list);
+          }
+          clock_gettime(CLOCK_MONOTONIC, &end);
+          double ms = (double)(end.tv_sec - start.tv_sec) * 1000.0 + (double)(end.tv_nsec - start.tv_nsec) / 1000000.0;
+          printf("highlight %d byte line %-8s %8.3f ms\n", BENCH_LINE_LEN, languages[l].name, ms / BENCH_ITERATIONS);
+     }
+
+     ce_draw_color_list_free(&draw_color_list);
+     ce_buffer_free(&buffer);
+     free(line);
+     ce_buffer_free(g_ce_log_buffer);
+     free(g_ce_log_buffer);
+     if(g_ce_log) fclose(g_ce_log);
+     return 0;
+}
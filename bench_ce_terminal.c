@@ -0,0 +1,444 @@
+// replays terminal output through the escape parser and screen model without a pty or curses, then checks the
+// final screen against a hash so a faster parser can't quietly be a wrong one.
+//
+// usage: bench_ce_terminal [capture...]
+//
+// with no arguments it replays generated workloads. captures come from the terminal_capture command, any other
+// file is replayed as raw output on a BENCH_WIDTH x BENCH_HEIGHT terminal
+
+#include "ce_terminal.h"
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <locale.h>
+
+#define BENCH_WIDTH 160
+#define BENCH_HEIGHT 48
+#define BENCH_SCROLL_BACK 1024
+#define BENCH_SCROLL_BACK_ARCHIVE 100000
+#define BENCH_RUNS 3 // the fastest run is reported
+#define BENCH_FRAME_SIZE (512 * 1024) // about what a frame's worth of output is when the main thread keeps up
+#define BENCH_SPLIT_SIZE 4093 // prime, so the check replay splits sequences in places the records don't
+#define BENCH_WORKLOAD_SIZE (16 * 1024 * 1024)
+
+FILE* g_ce_log = NULL;
+CeBuffer_t* g_ce_log_buffer = NULL;
+
+typedef struct{
+     char* bytes; // the same layout as a capture file
+     int64_t size;
+     int64_t capacity;
+     int64_t nanoseconds;
+     int64_t output_record; // offset of the last record if more output can join it, 0 if not
+}BenchCapture_t;
+
+typedef struct{
+     const char* name;
+     void (*generate)(BenchCapture_t* capture);
+     uint64_t hash; // of the final screen, update it when the terminal is meant to behave differently
+}BenchWorkload_t;
+
+static uint64_t g_random = 0x9E3779B97F4A7C15;
+
+static uint32_t bench_random(uint32_t max){
+     g_random ^= g_random << 13;
+     g_random ^= g_random >> 7;
+     g_random ^= g_random << 17;
+     return (uint32_t)(g_random >> 32) % max;
+}
+
+static bool capture_append(BenchCapture_t* capture, const void* bytes, int64_t len){
+     if(capture->size + len > capture->capacity){
+          int64_t capacity = capture->capacity ? capture->capacity : 1024 * 1024;
+          while(capture->size + len > capacity) capacity *= 2;
+          char* new_bytes = realloc(capture->bytes, capacity);
+          if(!new_bytes) return false;
+          capture->bytes = new_bytes;
+          capture->capacity = capacity;
+     }
+     memcpy(capture->bytes + capture->size, bytes, len);
+     capture->size += len;
+     return true;
+}
+
+static bool capture_begin(BenchCapture_t* capture, int32_t columns, int32_t rows){
+     CeTerminalCaptureHeader_t header = {};
+     memcpy(header.magic, CE_TERMINAL_CAPTURE_MAGIC, sizeof(header.magic));
+     header.columns = columns;
+     header.rows = rows;
+     return capture_append(capture, &header, sizeof(header));
+}
+
+static bool capture_record(BenchCapture_t* capture, CeTerminalCaptureRecordType_t type, const void* bytes, int32_t len){
+     // generated output comes faster than it is read, so it joins the last record like it would in a tty read
+     if(type == CE_TERMINAL_CAPTURE_RECORD_OUTPUT && capture->output_record){
+          CeTerminalCaptureRecord_t* record = (CeTerminalCaptureRecord_t*)(capture->bytes + capture->output_record);
+          if(record->length + len <= CE_TERMINAL_READ_MAX_SIZE){
+               if(!capture_append(capture, bytes, len)) return false;
+               record = (CeTerminalCaptureRecord_t*)(capture->bytes + capture->output_record);
+               record->length += len;
+               return true;
+          }
+     }
+
+     capture->nanoseconds += 1000;
+     CeTerminalCaptureRecord_t record = {capture->nanoseconds, type, len};
+     capture->output_record = (type == CE_TERMINAL_CAPTURE_RECORD_OUTPUT) ? capture->size : 0;
+     return capture_append(capture, &record, sizeof(record)) && capture_append(capture, bytes, len);
+}
+
+static void capture_printf(BenchCapture_t* capture, const char* format, ...){
+     char output[BUFSIZ];
+     va_list args;
+     va_start(args, format);
+     int len = vsnprintf(output, sizeof(output), format, args);
+     va_end(args);
+     if(len >= (int)(sizeof(output))) len = sizeof(output) - 1;
+     if(len > 0) capture_record(capture, CE_TERMINAL_CAPTURE_RECORD_OUTPUT, output, len);
+}
+
+static void capture_resize(BenchCapture_t* capture, int32_t columns, int32_t rows){
+     int32_t size[2] = {columns, rows};
+     capture_record(capture, CE_TERMINAL_CAPTURE_RECORD_RESIZE, size, sizeof(size));
+}
+
+static const char* g_words[] = {"buffer", "terminal", "line", "cursor", "view", "layout", "rune", "glyph", "scroll",
+                                "archive", "span", "snapshot", "parser", "escape", "screen", "config", "tab", "jump"};
+#define WORD_COUNT (int64_t)(sizeof(g_words) / sizeof(g_words[0]))
+
+static void generate_compiler_log(BenchCapture_t* capture){
+     capture_begin(capture, BENCH_WIDTH, BENCH_HEIGHT);
+     while(capture->size < BENCH_WORKLOAD_SIZE){
+          const char* file = g_words[bench_random(WORD_COUNT)];
+          const char* symbol = g_words[bench_random(WORD_COUNT)];
+          uint32_t line = bench_random(5000) + 1;
+          uint32_t column = bench_random(60) + 1;
+          switch(bench_random(4)){
+          default:
+               capture_printf(capture, "gcc -Wall -Wextra -std=gnu11 -O2 -c -o build/ce_%s.o ce_%s.c\r\n", file, file);
+               break;
+          case 1:
+               capture_printf(capture, "\033[01m\033[Kce_%s.c:\033[m\033[K In function '\033[01m\033[K%s_%s\033[m\033[K':\r\n"
+                              "\033[01m\033[Kce_%s.c:%u:%u:\033[m\033[K \033[01;35m\033[Kwarning: \033[m\033[K"
+                              "unused variable '\033[01m\033[K%s\033[m\033[K' [\033[01;35m\033[K-Wunused-variable\033[m\033[K]\r\n"
+                              "%5u |      int64_t %s = 0;\r\n      |              \033[01;35m\033[K^~~~~\033[m\033[K\r\n",
+                              file, file, symbol, file, line, column, symbol, line, symbol);
+               break;
+          case 2:
+               capture_printf(capture, "\033[01m\033[Kce_%s.c:%u:%u:\033[m\033[K \033[01;31m\033[Kerror: \033[m\033[K"
+                              "'\033[01m\033[K%s\033[m\033[K' undeclared (first use in this function)\r\n"
+                              "%5u |      %s->%s = \033[01;31m\033[K%s\033[m\033[K;\r\n"
+                              "      |                  \033[01;31m\033[K^~~~~~~\033[m\033[K\r\n",
+                              file, line, column, symbol, line, file, symbol, symbol);
+               break;
+          }
+     }
+}
+
+// a log with some colored levels, like what servers print
+static void generate_server_log(BenchCapture_t* capture){
+     static const char* levels[] = {"INFO", "\033[33mWARN\033[0m", "INFO", "\033[1;31mERROR\033[0m", "DEBUG"};
+     capture_begin(capture, BENCH_WIDTH, BENCH_HEIGHT);
+     for(int64_t i = 0; capture->size < BENCH_WORKLOAD_SIZE; i++){
+          capture_printf(capture, "2024-01-01 12:00:%02ld [%s] request %ld handled in %ld ms path=/api/v1/items/%ld\r\n",
+                         i % 60, levels[i % 5], i, (i * 7) % 1000, i * 13);
+     }
+}
+
+static void generate_colored_ls(BenchCapture_t* capture){
+     static const char* colors[] = {"0", "01;34", "01;32", "01;36", "40;33;01", "01;31", "01;35"};
+     capture_begin(capture, BENCH_WIDTH, BENCH_HEIGHT);
+     while(capture->size < BENCH_WORKLOAD_SIZE){
+          capture_printf(capture, "\033]0;ls --color\a");
+          for(int64_t row = 0; row < 40; row++){
+               for(int64_t column = 0; column < 6; column++){
+                    int64_t word = bench_random(WORD_COUNT);
+                    capture_printf(capture, "\033[0m\033[%sm%s_%03u%s\033[0m%*s", colors[bench_random(7)], g_words[word],
+                                   bench_random(1000), (column % 2) ? ".c" : "", (int)(20 - strlen(g_words[word])), "");
+               }
+               capture_printf(capture, "\r\n");
+          }
+     }
+}
+
+static void generate_large_cat(BenchCapture_t* capture){
+     static const char* unicode[] = {"é", "ü", "€", "漢字", "─", "│", "→", "😀"};
+     capture_begin(capture, BENCH_WIDTH, BENCH_HEIGHT);
+     while(capture->size < BENCH_WORKLOAD_SIZE){
+          char line[BUFSIZ] = "";
+          int64_t len = 0;
+          int64_t word_count = bench_random(60);
+          for(int64_t i = 0; i < word_count; i++){
+               const char* word = (bench_random(16) == 0) ? unicode[bench_random(8)] : g_words[bench_random(WORD_COUNT)];
+               len += snprintf(line + len, sizeof(line) - len, "%s%s", word, bench_random(10) ? " " : "\t");
+          }
+          capture_printf(capture, "%s\r\n", line);
+     }
+}
+
+// the full screen workloads stop while the program is still running, so the final screen is the one it drew
+static void generate_htop(BenchCapture_t* capture){
+     capture_begin(capture, BENCH_WIDTH, BENCH_HEIGHT);
+     capture_printf(capture, "\033[?1049h\033[22;0;0t\033[1;%dr\033[?25l\033[H\033[2J", BENCH_HEIGHT);
+     while(capture->size < BENCH_WORKLOAD_SIZE){
+          for(int64_t cpu = 0; cpu < 8; cpu++){
+               uint32_t used = bench_random(40);
+               capture_printf(capture, "\033[%ld;3H\033[36m%ld\033[39m\033[1m[\033[32m%.*s\033[31m%.*s\033[m%*s\033[1m%4.1f%%]\033[m",
+                              cpu + 1, cpu, (int)(used / 2), "||||||||||||||||||||", (int)(used - used / 2),
+                              "||||||||||||||||||||", (int)(40 - used), "", used * 2.5);
+          }
+          capture_printf(capture, "\033[10;1H\033[30;42m    PID USER      PRI  NI  VIRT   RES   SHR S CPU%% MEM%%   TIME+  Command%*s\033[m",
+                         BENCH_WIDTH - 80, "");
+          uint32_t selected = bench_random(BENCH_HEIGHT - 12);
+          for(int64_t row = 0; row < BENCH_HEIGHT - 12; row++){
+               capture_printf(capture, "\033[%ld;1H%s%7u %-9s  20   0 %5uM %5uM %5uM %c %4.1f %4.1f %2u:%02u.%02u %s\033[K\033[m",
+                              row + 11, (row == selected) ? "\033[30;46m" : "", bench_random(99999),
+                              g_words[bench_random(WORD_COUNT)], bench_random(9999), bench_random(999), bench_random(99),
+                              bench_random(2) ? 'S' : 'R', bench_random(1000) / 10.0, bench_random(1000) / 10.0,
+                              bench_random(60), bench_random(60), bench_random(100), g_words[bench_random(WORD_COUNT)]);
+          }
+          capture_printf(capture, "\033[%d;1H\033[30;46mF1\033[mHelp  \033[30;46mF2\033[mSetup \033[30;46mF10\033[mQuit\033[K",
+                         BENCH_HEIGHT);
+     }
+}
+
+static void generate_vim(BenchCapture_t* capture){
+     capture_begin(capture, BENCH_WIDTH, BENCH_HEIGHT);
+     capture_printf(capture, "\033[?1049h\033[?1h\033=\033[H\033[2J");
+     int32_t columns = BENCH_WIDTH;
+     int32_t rows = BENCH_HEIGHT;
+     while(capture->size < BENCH_WORKLOAD_SIZE){
+          // the window changes size every so often and vim redraws everything
+          if(bench_random(500) == 0){
+               columns = (columns == BENCH_WIDTH) ? BENCH_WIDTH - 40 : BENCH_WIDTH;
+               rows = (rows == BENCH_HEIGHT) ? BENCH_HEIGHT - 8 : BENCH_HEIGHT;
+               capture_resize(capture, columns, rows);
+               capture_printf(capture, "\033[1;%dr\033[H\033[2J", rows - 1);
+          }
+
+          switch(bench_random(4)){
+          default:
+               // scroll down a line and draw the new one at the bottom
+               capture_printf(capture, "\033[1;%dr\033[%d;1H\n\033[%d;1H\033[33m%4u \033[m\033[38;5;%um%s\033[m(%s, %s);\033[K",
+                              rows - 1, rows - 1, rows - 1, bench_random(9999), bench_random(256),
+                              g_words[bench_random(WORD_COUNT)], g_words[bench_random(WORD_COUNT)],
+                              g_words[bench_random(WORD_COUNT)]);
+               break;
+          case 1:
+               // scroll up a line and draw the new one at the top
+               capture_printf(capture, "\033[1;%dr\033[H\033M\033[33m%4u \033[m\033[1;34m%s\033[m %s = %u;\033[K",
+                              rows - 1, bench_random(9999), g_words[bench_random(WORD_COUNT)],
+                              g_words[bench_random(WORD_COUNT)], bench_random(1000));
+               break;
+          case 2:
+               // open and delete lines in the middle like o and dd do
+               capture_printf(capture, "\033[1;%dr\033[%u;1H\033[L\033[33m%4u \033[m     %s;\033[%u;1H\033[M",
+                              rows - 1, bench_random(rows - 2) + 1, bench_random(9999), g_words[bench_random(WORD_COUNT)],
+                              bench_random(rows - 2) + 1);
+               break;
+          case 3:
+               // type in the middle of a line
+               capture_printf(capture, "\033[%u;%uH\033[4h%s\033[4l\033[%u;%uH\033[1P",
+                              bench_random(rows - 2) + 1, bench_random(columns - 20) + 6, g_words[bench_random(WORD_COUNT)],
+                              bench_random(rows - 2) + 1, bench_random(columns - 20) + 6);
+               break;
+          }
+          capture_printf(capture, "\033[%d;1H\033[1m-- INSERT --\033[m\033[K\033[%d;%dH%u,%u%*sAll",
+                         rows, rows, columns - 20, bench_random(9999), bench_random(80), 10, "");
+     }
+}
+
+static BenchWorkload_t g_workloads[] = {
+     {"compiler log", generate_compiler_log, 0x738a3c1b8345d31c},
+     {"server log", generate_server_log, 0xdc4ec2cb9cd1d11b},
+     {"colored ls", generate_colored_ls, 0x6d0da4d4032f9dfe},
+     {"large cat", generate_large_cat, 0x8be972ba2d5b4315},
+     {"htop", generate_htop, 0xc8d8808f4b0f57d5},
+     {"vim", generate_vim, 0xc4bd40ddb6ec024d},
+};
+
+static bool capture_load(BenchCapture_t* capture, const char* filepath){
+     FILE* file = fopen(filepath, "rb");
+     if(!file) return false;
+     fseek(file, 0, SEEK_END);
+     int64_t size = ftell(file);
+     fseek(file, 0, SEEK_SET);
+     char* bytes = malloc(size ? size : 1);
+     bool success = bytes && fread(bytes, 1, size, file) == (size_t)(size);
+     fclose(file);
+     if(!success){
+          free(bytes);
+          return false;
+     }
+
+     if(size >= (int64_t)(sizeof(CeTerminalCaptureHeader_t)) && memcmp(bytes, CE_TERMINAL_CAPTURE_MAGIC, 8) == 0){
+          capture->bytes = bytes;
+          capture->size = size;
+          capture->capacity = size;
+          return true;
+     }
+
+     // not a capture, so it's what a program printed
+     success = capture_begin(capture, BENCH_WIDTH, BENCH_HEIGHT);
+     for(int64_t i = 0; success && i < size; i += CE_TERMINAL_READ_MAX_SIZE){
+          int64_t len = size - i;
+          if(len > CE_TERMINAL_READ_MAX_SIZE) len = CE_TERMINAL_READ_MAX_SIZE;
+          success = capture_record(capture, CE_TERMINAL_CAPTURE_RECORD_OUTPUT, bytes + i, len);
+     }
+     free(bytes);
+     return success;
+}
+
+// writes each record's output split_size bytes at a time, or all at once if split_size is 0
+static bool replay(CeTerminal_t* terminal, BenchCapture_t* capture, int64_t split_size, int64_t* output_size){
+     CeTerminalCaptureHeader_t header;
+     memcpy(&header, capture->bytes, sizeof(header));
+     if(!ce_terminal_init_headless(terminal, header.columns, header.rows, BENCH_SCROLL_BACK, BENCH_SCROLL_BACK_ARCHIVE,
+                                   "bench")){
+          return false;
+     }
+
+     *output_size = 0;
+     int64_t offset = sizeof(header);
+     while(offset + (int64_t)(sizeof(CeTerminalCaptureRecord_t)) <= capture->size){
+          CeTerminalCaptureRecord_t record;
+          memcpy(&record, capture->bytes + offset, sizeof(record));
+          offset += sizeof(record);
+          if(record.length < 0 || offset + record.length > capture->size) return false;
+          const char* bytes = capture->bytes + offset;
+          offset += record.length;
+
+          if(record.type == CE_TERMINAL_CAPTURE_RECORD_RESIZE){
+               int32_t size[2];
+               if(record.length != sizeof(size)) return false;
+               memcpy(size, bytes, sizeof(size));
+               ce_terminal_resize(terminal, size[0], size[1]);
+               continue;
+          }
+
+          for(int64_t i = 0; i < record.length; i += split_size ? split_size : record.length){
+               int64_t len = record.length - i;
+               if(split_size && len > split_size) len = split_size;
+               ce_terminal_write_output(terminal, bytes + i, len);
+          }
+
+          if((*output_size + record.length) / BENCH_FRAME_SIZE != *output_size / BENCH_FRAME_SIZE){
+               ce_terminal_update_snapshot(terminal);
+          }
+          *output_size += record.length;
+     }
+     ce_terminal_update_snapshot(terminal);
+     return offset == capture->size;
+}
+
+static uint64_t hash_bytes(uint64_t hash, const void* bytes, int64_t len){
+     const unsigned char* itr = bytes;
+     for(int64_t i = 0; i < len; i++){
+          hash ^= itr[i];
+          hash *= 0x100000001b3;
+     }
+     return hash;
+}
+
+static uint64_t hash_int(uint64_t hash, int64_t value){
+     return hash_bytes(hash, &value, sizeof(value));
+}
+
+// the text and attributes of the rows on screen and where the cursor is
+static uint64_t screen_hash(CeTerminal_t* terminal){
+     uint64_t hash = 0xcbf29ce484222325;
+     hash = hash_int(hash, terminal->columns);
+     hash = hash_int(hash, terminal->rows);
+     hash = hash_int(hash, terminal->snapshot.cursor.x);
+     hash = hash_int(hash, terminal->snapshot.cursor.y);
+     for(int64_t y = 0; y < terminal->rows; y++){
+          CeTerminalLineCopy_t* line = terminal->snapshot.lines[y];
+          if(!line) continue;
+          hash = hash_bytes(hash, line->text, strlen(line->text) + 1);
+          for(int32_t s = 0; s < line->count; s++){
+               CeTerminalSpan_t* span = line->spans + s;
+               hash = hash_int(hash, span->start);
+               hash = hash_int(hash, span->len);
+               hash = hash_int(hash, span->glyph.attributes);
+               hash = hash_int(hash, span->glyph.foreground);
+               hash = hash_int(hash, span->glyph.background);
+          }
+     }
+     return hash;
+}
+
+static double elapsed_seconds(struct timespec* start, struct timespec* end){
+     return (double)(end->tv_sec - start->tv_sec) + (double)(end->tv_nsec - start->tv_nsec) / 1000000000.0;
+}
+
+// returns whether the replay is valid, matches when split and matches the expected hash if there is one
+static bool bench(const char* name, BenchCapture_t* capture, uint64_t expected_hash){
+     double best_seconds = 0.0;
+     int64_t output_size = 0;
+     uint64_t hash = 0;
+     for(int64_t run = 0; run < BENCH_RUNS; run++){
+          CeTerminal_t terminal = {};
+          struct timespec start;
+          struct timespec end;
+          clock_gettime(CLOCK_MONOTONIC, &start);
+          bool valid = replay(&terminal, capture, 0, &output_size);
+          clock_gettime(CLOCK_MONOTONIC, &end);
+          if(terminal.lines_buffer){
+               hash = screen_hash(&terminal);
+               ce_terminal_free(&terminal);
+          }
+          if(!valid){
+               printf("%-16s invalid capture\n", name);
+               return false;
+          }
+          double seconds = elapsed_seconds(&start, &end);
+          if(run == 0 || seconds < best_seconds) best_seconds = seconds;
+     }
+
+     CeTerminal_t terminal = {};
+     int64_t split_output_size = 0;
+     bool split_matches = replay(&terminal, capture, BENCH_SPLIT_SIZE, &split_output_size) && screen_hash(&terminal) == hash;
+     ce_terminal_free(&terminal);
+
+     bool hash_matches = !expected_hash || expected_hash == hash;
+     double megabytes = output_size / (1024.0 * 1024.0);
+     printf("%-16s %8.1f MB %8.3f s %8.1f MB/s %6.2f ns/byte  screen 0x%016lx%s%s\n", name, megabytes, best_seconds,
+            megabytes / best_seconds, (best_seconds * 1000000000.0) / output_size, hash,
+            hash_matches ? "" : " doesn't match the expected screen", split_matches ? "" : " doesn't match when split");
+     return hash_matches && split_matches;
+}
+
+int main(int argc, char** argv){
+     g_ce_log_buffer = calloc(1, sizeof(*g_ce_log_buffer));
+     ce_buffer_alloc(g_ce_log_buffer, 1, "[log]");
+     ce_log_init("ce_bench.log");
+     setlocale(LC_ALL, "");
+
+     bool success = true;
+     if(argc > 1){
+          for(int i = 1; i < argc; i++){
+               BenchCapture_t capture = {};
+               if(!capture_load(&capture, argv[i])){
+                    printf("failed to load %s\n", argv[i]);
+                    success = false;
+                    continue;
+               }
+               success &= bench(argv[i], &capture, 0);
+               free(capture.bytes);
+          }
+     }else{
+          for(int64_t i = 0; i < (int64_t)(sizeof(g_workloads) / sizeof(g_workloads[0])); i++){
+               BenchCapture_t capture = {};
+               g_workloads[i].generate(&capture);
+               success &= bench(g_workloads[i].name, &capture, g_workloads[i].hash);
+               free(capture.bytes);
+          }
+     }
+
+     ce_buffer_free(g_ce_log_buffer);
+     free(g_ce_log_buffer);
+     if(g_ce_log) fclose(g_ce_log);
+     return success ? 0 : 1;
+}
@@ -96,6 +96,56 @@ static bool buffer_realloc_lines(CeBuffer_t* buffer, int64_t new_line_count){
      return true;
 }
 
+// every line's tokens have to be lexed again
+static void buffer_tokens_reset(CeBuffer_t* buffer){
+     buffer->version++;
+     if(buffer->no_token_cache) return;
+     buffer->tokens.valid_count = 0;
+     buffer->tokens.dirty_end = buffer->tokens.count;
+}
+
+// lines before first_line are untouched and lines from end_line on are the lines that came after the edit before it was
+// made, so their tokens move along with them instead of being thrown away
+static void buffer_lines_changed(CeBuffer_t* buffer, int64_t first_line, int64_t end_line){
+     buffer->version++;
+     if(buffer->no_token_cache) return;
+
+     CeBufferTokens_t* tokens = &buffer->tokens;
+     if(tokens->count == 0) return;
+
+     int64_t line_delta = buffer->line_count - tokens->count;
+     int64_t old_end_line = end_line - line_delta;
+     if(first_line > tokens->count || old_end_line < first_line || old_end_line > tokens->count){
+          buffer_tokens_reset(buffer);
+          return;
+     }
+
+     if(buffer->line_count > tokens->capacity){
+          int64_t new_capacity = tokens->capacity * 2;
+          if(new_capacity < buffer->line_count) new_capacity = buffer->line_count;
+          CeBufferLineTokens_t* new_lines = realloc(tokens->lines, new_capacity * sizeof(*new_lines));
+          if(!new_lines){
+               buffer_tokens_reset(buffer);
+               return;
+          }
+          tokens->lines = new_lines;
+          tokens->capacity = new_capacity;
+     }
+
+     // the edit doesn't change the state the first line starts in
+     int32_t first_line_state = (first_line < tokens->count) ? tokens->lines[first_line].start_state : 0;
+     for(int64_t i = first_line; i < old_end_line; i++) free(tokens->lines[i].tokens);
+     memmove(tokens->lines + end_line, tokens->lines + old_end_line, (tokens->count - old_end_line) * sizeof(*tokens->lines));
+     memset(tokens->lines + first_line, 0, (end_line - first_line) * sizeof(*tokens->lines));
+     tokens->count = buffer->line_count;
+     if(first_line < tokens->count) tokens->lines[first_line].start_state = first_line_state;
+
+     int64_t dirty_end = end_line;
+     if(tokens->valid_count < tokens->dirty_end && tokens->dirty_end >= old_end_line) dirty_end = tokens->dirty_end + line_delta;
+     if(tokens->valid_count > first_line) tokens->valid_count = first_line;
+     tokens->dirty_end = dirty_end;
+}
+
 bool ce_buffer_alloc(CeBuffer_t* buffer, int64_t line_count, const char* name){
      if(buffer->lines) ce_buffer_free(buffer);
 
@@ -118,6 +168,7 @@ bool ce_buffer_alloc(CeBuffer_t* buffer, int64_t line_count, const char* name){
      }
 
      buffer->status = CE_BUFFER_STATUS_MODIFIED;
+     buffer_tokens_reset(buffer);
      return true;
 }
 
@@ -129,13 +180,17 @@ void ce_buffer_free(CeBuffer_t* buffer){
      free(buffer->lines);
      free(buffer->name);
 
-     if(buffer->change_node){
-          CeBufferChangeNode_t* head = buffer->change_node;
-          while(head->prev) head = head->prev;
-          ce_buffer_change_node_free(&head);
+     ce_buffer_forget_changes(buffer);
+
+     for(int64_t i = 0; i < buffer->tokens.count; i++){
+          free(buffer->tokens.lines[i].tokens);
      }
+     free(buffer->tokens.lines);
 
+     // keep counting versions, so a buffer re-using this memory doesn't look unchanged to views
+     int64_t version = buffer->version;
      memset(buffer, 0, sizeof(*buffer));
+     buffer->version = version + 1;
 }
 
 bool ce_buffer_load_file(CeBuffer_t* buffer, const char* filename){
@@ -221,6 +276,7 @@ bool ce_buffer_load_string(CeBuffer_t* buffer, const char* string, const char* n
           }
      }
 
+     buffer_tokens_reset(buffer);
      return true;
 }
 
@@ -258,6 +314,7 @@ bool ce_buffer_empty(CeBuffer_t* buffer){
      buffer->lines[0][0] = 0;
      buffer->line_count = 1;
      buffer->status = CE_BUFFER_STATUS_NONE;
+     buffer_tokens_reset(buffer);
 
      return true;
 }
@@ -676,6 +733,7 @@ bool ce_buffer_insert_string(CeBuffer_t* buffer, const char* string, CePoint_t p
           line[total_len] = 0;
           buffer->lines[point.y] = line;
           buffer->status = CE_BUFFER_STATUS_MODIFIED;
+          buffer_lines_changed(buffer, point.y, point.y + 1);
           return true;
      }
 
@@ -739,6 +797,7 @@ bool ce_buffer_insert_string(CeBuffer_t* buffer, const char* string, CePoint_t p
      buffer->lines[next_line][last_line_len] = 0;
 
      buffer->status = CE_BUFFER_STATUS_MODIFIED;
+     buffer_lines_changed(buffer, point.y, next_line + 1);
      return true;
 }
 
@@ -781,10 +840,12 @@ bool ce_buffer_remove_string(CeBuffer_t* buffer, CePoint_t point, int64_t length
           buffer->lines[point.y] = new_line;
 
           buffer->status = CE_BUFFER_STATUS_MODIFIED;
+          buffer_lines_changed(buffer, point.y, point.y + 1);
           return true;
      }else if(length_left_on_line == length){
           if(point.x == 0){
                buffer->status = CE_BUFFER_STATUS_MODIFIED;
+               buffer_lines_changed(buffer, point.y, point.y + 1);
                return ce_buffer_remove_lines(buffer, point.y, 1);
           }
 
@@ -806,6 +867,7 @@ bool ce_buffer_remove_string(CeBuffer_t* buffer, CePoint_t point, int64_t length
           }
 
           buffer->status = CE_BUFFER_STATUS_MODIFIED;
+          buffer_lines_changed(buffer, point.y, point.y + 1);
           return ce_buffer_remove_lines(buffer, next_line_index, 1);
      }
 
@@ -857,6 +919,8 @@ bool ce_buffer_remove_string(CeBuffer_t* buffer, CePoint_t point, int64_t length
           save_current_line--;
      }
 
+     buffer_lines_changed(buffer, point.y, point.y + 1);
+
      // remove the intermediate lines
      return ce_buffer_remove_lines(buffer, save_current_line, lines_to_delete);
 }
@@ -889,6 +953,7 @@ bool ce_buffer_remove_lines(CeBuffer_t* buffer, int64_t line_start, int64_t line
      }
 
      buffer->status = CE_BUFFER_STATUS_MODIFIED;
+     buffer_lines_changed(buffer, line_start, line_start);
      return buffer->lines != NULL;
 }
 
@@ -1066,9 +1131,18 @@ bool ce_buffer_change(CeBuffer_t* buffer, CeBufferChange_t* change){
      return true;
 }
 
+void ce_buffer_forget_changes(CeBuffer_t* buffer){
+     if(!buffer->change_node) return;
+     CeBufferChangeNode_t* head = buffer->change_node;
+     while(head->prev) head = head->prev;
+     ce_buffer_change_node_free(&head);
+     buffer->change_node = NULL;
+     buffer->save_at_change_node = NULL;
+}
+
 bool ce_buffer_undo(CeBuffer_t* buffer, CePoint_t* cursor){
      // nothing to undo
-     if(!buffer->change_node) return true;
+     if(!buffer->change_node || buffer->no_undo) return true;
      if(!buffer->change_node->prev) return true;
 
      CeBufferChange_t* change = &buffer->change_node->change;
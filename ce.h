@@ -26,6 +26,14 @@
 #define COLOR_BRIGHT_CYAN 14
 #define COLOR_BRIGHT_WHITE 15
 
+// 24 bit colors, only the vt draw backend shows them exactly, curses gets the closest color it has
+#define CE_COLOR_RGB_FLAG 0x1000000
+#define CE_COLOR_RGB(r, g, b) (CE_COLOR_RGB_FLAG | ((r) << 16) | ((g) << 8) | (b))
+#define CE_COLOR_IS_RGB(color) ((color) >= CE_COLOR_RGB_FLAG)
+#define CE_COLOR_RED(color) (((color) >> 16) & 0xFF)
+#define CE_COLOR_GREEN(color) (((color) >> 8) & 0xFF)
+#define CE_COLOR_BLUE(color) ((color) & 0xFF)
+
 #define KEY_ESCAPE 27
 
 typedef int32_t CeRune_t;
@@ -83,6 +91,34 @@ typedef struct CeBufferChangeNode_t{
      struct CeBufferChangeNode_t* prev;
 }CeBufferChangeNode_t;
 
+// a syntax token on a line, start and len are in runes and the class is a CeSyntaxColor_t, normal text isn't stored
+typedef struct{
+     int32_t start;
+     int32_t len;
+     uint8_t syntax_class;
+}CeBufferToken_t;
+
+typedef struct{
+     CeBufferToken_t* tokens;
+     int32_t count;
+     int32_t capacity;
+     int32_t start_state; // the lexer state at the start of the line
+}CeBufferLineTokens_t;
+
+// tokens for every line of the buffer, filled in by the syntax highlighter, either for the lines it draws or ahead of
+// time while the editor is idle. edits shift the entries so lines after an edit keep their tokens:
+// - lines before valid_count are up to date
+// - lines from valid_count up to dirty_end have to be lexed again
+// - lines from dirty_end on were up to date before the edit, and still are if lexing reaches them in the same state
+typedef struct{
+     CeBufferLineTokens_t* lines;
+     int64_t count; // follows the buffer's line count
+     int64_t capacity;
+     int64_t valid_count;
+     int64_t dirty_end;
+     const void* owner; // identifies the lexer the tokens belong to
+}CeBufferTokens_t;
+
 typedef struct{
      char** lines;
      int64_t line_count;
@@ -99,6 +135,13 @@ typedef struct{
 
      bool no_line_numbers;
      bool no_highlight_current_line;
+     bool no_trailing_whitespace;
+     bool no_search_highlight;
+     bool no_undo; // edits are only kept in the change list until ce_buffer_forget_changes(), so they can't be undone
+     bool no_token_cache; // another thread writes the lines, so highlighting lexes a private copy of the tokens each time
+
+     int64_t version; // incremented whenever the lines change, so views know when they need to be redrawn
+     CeBufferTokens_t tokens;
 
      void* app_data; // TODO: this doesn't need to be a void*
      void* syntax_data;
@@ -123,12 +166,18 @@ typedef enum{
      CE_VISUAL_LINE_DISPLAY_TYPE_EXCLUDE_NEWLINE, // worst style
 }CeVisualLineDisplayType_t;
 
+typedef enum{
+     CE_DRAW_BACKEND_CURSES,
+     CE_DRAW_BACKEND_VT, // writes escape sequences straight to the terminal, one write per frame
+}CeDrawBackendType_t;
+
 typedef struct{
      CeLineNumber_t line_number;
      int64_t tab_width;
      int64_t horizontal_scroll_off;
      int64_t vertical_scroll_off;
      int64_t terminal_scroll_back;
+     int64_t terminal_scroll_back_archive; // lines kept as plain text in ~/.ce once they scroll past terminal_scroll_back, 0 turns it off
      bool insert_spaces_on_tab;
      CeVisualLineDisplayType_t visual_line_display_type;
      int ui_fg_color;
@@ -140,6 +189,11 @@ typedef struct{
      int apply_completion_key;
      int cycle_next_completion_key;
      int cycle_prev_completion_key;
+     int64_t max_frames_per_second; // caps redraws caused by terminal and shell command output, 0 means no cap
+     CeDrawBackendType_t draw_backend;
+     int64_t large_file_size;        // in bytes, files at least this big load in large file mode, 0 turns the check off
+     int64_t large_file_line_length; // files with a line at least this long load in large file mode, 0 turns the check off
+     int64_t highlight_thread_count; // threads highlighting views alongside the main thread, read once at startup
 }CeConfigOptions_t;
 
 typedef struct CeRuneNode_t{
@@ -203,6 +257,7 @@ bool ce_buffer_remove_string_change(CeBuffer_t* buffer, CePoint_t point, int64_t
                                     CePoint_t cursor_after, bool chain_undo);
 
 bool ce_buffer_change(CeBuffer_t* buffer, CeBufferChange_t* change); // TODO: unittest
+void ce_buffer_forget_changes(CeBuffer_t* buffer); // frees the change list, dropping the undo history
 bool ce_buffer_undo(CeBuffer_t* buffer, CePoint_t* cursor); // TODO: unittest
 bool ce_buffer_redo(CeBuffer_t* buffer, CePoint_t* cursor); // TODO: unittest
 
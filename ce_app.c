@@ -241,15 +241,28 @@ void ce_syntax_highlight_terminal(CeView_t* view, CeRangeList_t* highlight_range
                ce_draw_color_list_insert(draw_color_list, ce_draw_color_list_last_fg_color(draw_color_list), new_bg, point);
           }
 
-          for(int64_t x = 0; x < terminal->columns; ++x){
-               point.x = x;
-               ce_syntax_highlight_visual(&range_node, &in_visual, point, draw_color_list, syntax_defs);
-
-               CeTerminalGlyph_t* glyph = terminal->lines[y] + x;
-               if(glyph->foreground != fg || glyph->background != bg){
-                    fg = glyph->foreground;
-                    bg = in_visual ? ce_syntax_def_get_bg(syntax_defs, CE_SYNTAX_COLOR_VISUAL, COLOR_DEFAULT) : glyph->background;
-                    ce_draw_color_list_insert(draw_color_list, fg, bg, point);
+          // archived lines lost their attributes, so they get the default colors
+          CeTerminalSpan_t archived_span = {0, terminal->columns, {0, COLOR_DEFAULT, COLOR_DEFAULT}};
+          CeTerminalLineCopy_t archived_line = {NULL, &archived_span, 1, 1, 0};
+          const CeTerminalLineCopy_t* line = &archived_line;
+          if(y >= terminal->snapshot.archived) line = terminal->snapshot.lines[y - terminal->snapshot.archived];
+          for(int32_t s = 0; s < line->count; ++s){
+               const CeTerminalSpan_t* span = line->spans + s;
+               point.x = span->start;
+
+               // the colors only change at the start of a span, but a visual range can start or end anywhere inside it
+               int64_t visual_end = span->start + 1;
+               if(range_node || in_visual) visual_end = span->start + span->len;
+
+               for(int64_t x = span->start; x < visual_end; ++x){
+                    point.x = x;
+                    ce_syntax_highlight_visual(&range_node, &in_visual, point, draw_color_list, syntax_defs);
+
+                    if(span->glyph.foreground != fg || span->glyph.background != bg){
+                         fg = span->glyph.foreground;
+                         bg = in_visual ? ce_syntax_def_get_bg(syntax_defs, CE_SYNTAX_COLOR_VISUAL, COLOR_DEFAULT) : span->glyph.background;
+                         ce_draw_color_list_insert(draw_color_list, fg, bg, point);
+                    }
                }
           }
      }
@@ -459,7 +472,7 @@ void ce_run_command_in_terminal(CeTerminal_t* terminal, const char* command){
 CeView_t* ce_switch_to_terminal(CeApp_t* app, CeView_t* view, CeLayout_t* tab_layout){
      CeTerminalNode_t* itr = app->terminal_list.head;
      while(itr){
-          CeLayout_t* terminal_layout = ce_layout_buffer_in_view(tab_layout, itr->terminal.buffer);
+          CeLayout_t* terminal_layout = ce_layout_buffer_in_view(tab_layout, itr->terminal.snapshot.buffer);
           if(terminal_layout){
                tab_layout->tab.current = terminal_layout;
                app->vim.mode = CE_VIM_MODE_INSERT;
@@ -473,16 +486,16 @@ CeView_t* ce_switch_to_terminal(CeApp_t* app, CeView_t* view, CeLayout_t* tab_la
      int64_t height = view->rect.bottom - view->rect.top;
 
      if(app->last_terminal){
-          app->last_terminal->buffer->cursor_save.x = app->last_terminal->cursor.x;
-          app->last_terminal->buffer->cursor_save.y = app->last_terminal->cursor.y + app->last_terminal->start_line;
-          ce_view_switch_buffer(view, app->last_terminal->buffer, &app->vim, &app->multiple_cursors, &app->config_options,
+          app->last_terminal->snapshot.buffer->cursor_save.x = app->last_terminal->snapshot.cursor.x;
+          app->last_terminal->snapshot.buffer->cursor_save.y = app->last_terminal->snapshot.cursor.y + app->last_terminal->snapshot.start_line;
+          ce_view_switch_buffer(view, app->last_terminal->snapshot.buffer, &app->vim, &app->multiple_cursors, &app->config_options,
                                 &app->terminal_list, &app->last_terminal, true);
           ce_terminal_resize(app->last_terminal, width, height);
      }else{
           CeTerminal_t* terminal = create_terminal(app, width, height);
-          terminal->buffer->cursor_save.x = terminal->cursor.x;
-          terminal->buffer->cursor_save.y = terminal->cursor.y + terminal->start_line;
-          ce_view_switch_buffer(view, terminal->buffer, &app->vim, &app->multiple_cursors, &app->config_options,
+          terminal->snapshot.buffer->cursor_save.x = terminal->snapshot.cursor.x;
+          terminal->snapshot.buffer->cursor_save.y = terminal->snapshot.cursor.y + terminal->snapshot.start_line;
+          ce_view_switch_buffer(view, terminal->snapshot.buffer, &app->vim, &app->multiple_cursors, &app->config_options,
                                 &app->terminal_list, &app->last_terminal, true);
           app->last_terminal = terminal;
           update_terminal_last_goto_using_cursor(terminal);
@@ -582,6 +595,7 @@ CeBuffer_t* load_file_into_view(CeBufferNode_t** buffer_node_head, CeView_t* vie
           ce_view_switch_buffer(view, buffer, vim, multiple_cursors, config_options, terminal_list, last_terminal,
                                 insert_into_jump_list);
           determine_buffer_syntax(buffer);
+          determine_large_file(buffer, config_options);
      }else{
           free(buffer);
           return NULL;
@@ -622,6 +636,21 @@ void determine_buffer_syntax(CeBuffer_t* buffer){
           buffer_data->syntax_function = ce_syntax_highlight_bash;
      }else if(string_ends_with(buffer->name, ".cfg")){
           buffer_data->syntax_function = ce_syntax_highlight_config;
+     }else if(string_ends_with(buffer->name, ".rs")){
+          buffer_data->syntax_function = ce_syntax_highlight_rust;
+     }else if(string_ends_with(buffer->name, ".go")){
+          buffer_data->syntax_function = ce_syntax_highlight_go;
+     }else if(string_ends_with(buffer->name, ".json")){
+          buffer_data->syntax_function = ce_syntax_highlight_json;
+     }else if(string_ends_with(buffer->name, ".yaml") ||
+              string_ends_with(buffer->name, ".yml")){
+          buffer_data->syntax_function = ce_syntax_highlight_yaml;
+     }else if(string_ends_with(buffer->name, ".md")){
+          buffer_data->syntax_function = ce_syntax_highlight_markdown;
+     }else if(string_ends_with(buffer->name, "Makefile") ||
+              string_ends_with(buffer->name, "makefile") ||
+              string_ends_with(buffer->name, ".mk")){
+          buffer_data->syntax_function = ce_syntax_highlight_makefile;
      }else if(string_ends_with(buffer->name, ".diff") ||
               string_ends_with(buffer->name, ".patch") ||
               string_ends_with(buffer->name, "COMMIT_EDITMSG")){
@@ -631,6 +660,67 @@ void determine_buffer_syntax(CeBuffer_t* buffer){
      }
 }
 
+// large files turn off features that cost something for every line drawn or every edit made
+void determine_large_file(CeBuffer_t* buffer, CeConfigOptions_t* config_options){
+     CeAppBufferData_t* buffer_data = buffer->app_data;
+     if(!buffer_data) return;
+     int64_t size = 0;
+     int64_t longest_line = 0;
+     for(int64_t i = 0; i < buffer->line_count; i++){
+          int64_t line_len = strlen(buffer->lines[i]);
+          size += line_len + 1;
+          if(line_len > longest_line) longest_line = line_len;
+     }
+
+     bool large_file = (config_options->large_file_size > 0 && size >= config_options->large_file_size) ||
+                       (config_options->large_file_line_length > 0 && longest_line >= config_options->large_file_line_length);
+
+     if(!large_file){
+          if(buffer_data->large_file) large_file_enable(buffer, "all");
+          return;
+     }
+
+     // syntax_function is only the real one while it isn't stashed, e.g. after large_file_enable syntax and a reload
+     if(!buffer_data->large_file_syntax_function) buffer_data->large_file_syntax_function = buffer_data->syntax_function;
+     buffer_data->large_file = true;
+     buffer_data->syntax_function = ce_syntax_highlight_plain;
+     buffer->no_trailing_whitespace = true;
+     buffer->no_search_highlight = true;
+     buffer->no_undo = true;
+     ce_log("'%s' is a large file (%ld bytes, longest line %ld bytes), syntax highlighting, trailing whitespace, "
+            "search highlighting and undo are off\n", buffer->name, size, longest_line);
+}
+
+// turns a feature large file mode turned off back on, leaving large file mode once they all are
+bool large_file_enable(CeBuffer_t* buffer, const char* feature){
+     CeAppBufferData_t* buffer_data = buffer->app_data;
+     if(!buffer_data->large_file) return false;
+
+     bool all = strcmp(feature, "all") == 0;
+     if(all || strcmp(feature, "syntax") == 0){
+          if(buffer_data->large_file_syntax_function) buffer_data->syntax_function = buffer_data->large_file_syntax_function;
+          buffer_data->large_file_syntax_function = NULL;
+     }else if(strcmp(feature, "trailing_whitespace") == 0){
+          buffer->no_trailing_whitespace = false;
+     }else if(strcmp(feature, "search_highlight") == 0){
+          buffer->no_search_highlight = false;
+     }else if(strcmp(feature, "undo") == 0){
+          buffer->no_undo = false;
+     }else{
+          return false;
+     }
+
+     if(all){
+          buffer->no_trailing_whitespace = false;
+          buffer->no_search_highlight = false;
+          buffer->no_undo = false;
+     }
+
+     buffer_data->large_file = buffer_data->large_file_syntax_function || buffer->no_trailing_whitespace ||
+                               buffer->no_search_highlight || buffer->no_undo;
+     return true;
+}
+
 char* directory_from_filename(const char* filename){
      const char* last_slash = strrchr(filename, '/');
      char* directory = NULL;
@@ -891,11 +981,12 @@ void user_config_free(CeUserConfig_t* user_config){
 }
 
 void update_terminal_last_goto_using_cursor(CeTerminal_t* terminal){
-     CeAppBufferData_t* buffer_data = terminal->buffer->app_data;
-     buffer_data->last_goto_destination = terminal->cursor.y + terminal->start_line;
+     CeAppBufferData_t* buffer_data = terminal->snapshot.buffer->app_data;
+     buffer_data->last_goto_destination = terminal->snapshot.cursor.y + terminal->snapshot.start_line;
 }
 
-CeTerminal_t* ce_terminal_list_new_terminal(CeTerminalList_t* terminal_list, int width, int height, int64_t scroll_back){
+CeTerminal_t* ce_terminal_list_new_terminal(CeTerminalList_t* terminal_list, int width, int height, int64_t scroll_back,
+                                            int64_t scroll_back_archive){
      CeTerminalNode_t* node = calloc(1, sizeof(*node));
 
      const int max_name_len = 64;
@@ -903,7 +994,7 @@ CeTerminal_t* ce_terminal_list_new_terminal(CeTerminalList_t* terminal_list, int
      terminal_list->unique_id++;
      snprintf(name, max_name_len, "terminal_%ld", terminal_list->unique_id);
 
-     ce_terminal_init(&node->terminal, width, height, scroll_back, name);
+     ce_terminal_init(&node->terminal, width, height, scroll_back, scroll_back_archive, name);
 
      if(terminal_list->tail){
           terminal_list->tail->next = node;
@@ -931,8 +1022,9 @@ CeTerminal_t* ce_buffer_in_terminal_list(CeBuffer_t* buffer, CeTerminalList_t* t
 }
 
 CeTerminal_t* create_terminal(CeApp_t* app, int width, int height){
-     CeTerminal_t* terminal = ce_terminal_list_new_terminal(&app->terminal_list, width, height, app->config_options.terminal_scroll_back);
-     ce_buffer_node_insert(&app->buffer_node_head, terminal->buffer);
+     CeTerminal_t* terminal = ce_terminal_list_new_terminal(&app->terminal_list, width, height, app->config_options.terminal_scroll_back,
+                                                            app->config_options.terminal_scroll_back_archive);
+     ce_buffer_node_insert(&app->buffer_node_head, terminal->snapshot.buffer);
 
      terminal->lines_buffer->app_data = calloc(1, sizeof(CeAppBufferData_t));
      CeAppBufferData_t* buffer_data = terminal->lines_buffer->app_data;
@@ -1056,11 +1148,14 @@ void ce_app_init_default_commands(CeApp_t* app){
           {command_clear_cursors, "clear_cursors", "clear multiple cursors so you go back to having one cursor"},
           {command_command, "command", "interactively send a commmand"},
           {command_delete_layout, "delete_layout", "delete the current layout (unless it's the only one left)"},
+          {command_draw_backend, "draw_backend", "change how the screen is drawn: 'curses' or 'vt' (escape sequences written directly)"},
+          {command_draw_stats, "draw_stats", "show how many rows were redrawn in the last frame and on average"},
           {command_goto_destination_in_line, "goto_destination_in_line", "scan current line for destination formats"},
           {command_goto_next_destination, "goto_next_destination", "find the next line in the buffer that contains a destination to goto"},
           {command_goto_prev_destination, "goto_prev_destination", "find the previous line in the buffer that contains a destination to goto"},
           {command_goto_prev_buffer_in_view, "goto_prev_buffer_in_view", "go to the previous buffer that was shown in the current view"},
           {command_jump_list, "jump_list", "jump to 'next' or 'previous' jump location based on argument passed in"},
+          {command_large_file_enable, "large_file_enable", "turn a feature large file mode turned off back on: 'syntax', 'trailing_whitespace', 'search_highlight', 'undo' or 'all'"},
           {command_line_number, "line_number", "change line number mode: 'none', 'absolute', 'relative', or 'both'"},
           {command_load_file, "load_file", "load a file (optionally specified)"},
           {command_man_page_on_word_under_cursor, "man_page_on_word_under_cursor", "run man on the word under the cursor"},
@@ -1087,11 +1182,13 @@ void ce_app_init_default_commands(CeApp_t* app){
           {command_show_jumps, "show_jumps", "show the state of your jumps"},
           {command_show_macros, "show_macros", "show the state of your macros"},
           {command_show_marks, "show_marks", "show the state of your vim marks"},
+          {command_show_syntax_info, "show_syntax_info", "show how much of each buffer is lexed and how often the line span cache hits"},
           {command_show_yanks, "show_yanks", "show the state of your vim yanks"},
           {command_split_layout, "split_layout", "split the current layout 'horizontal' or 'vertical' into 2 layouts"},
           {command_switch_buffer, "switch_buffer", "open dialogue to switch buffer by name"},
           {command_switch_to_terminal, "switch_to_terminal", "if the terminal is in view, goto it, otherwise, open the terminal in the current view"},
-          {command_syntax, "syntax", "set the current buffer's type: 'c', 'cpp', 'python', 'java', 'bash', 'config', 'diff', 'plain'"},
+          {command_syntax, "syntax", "set the current buffer's type: 'c', 'cpp', 'python', 'java', 'bash', 'config', 'rust', 'go', 'json', 'yaml', 'markdown', 'makefile', 'diff', 'plain'"},
+          {command_terminal_capture, "terminal_capture", "record the output of the terminal in view to a file for make bench-terminal, no argument stops recording"},
           {command_terminal_command, "terminal_command", "run a command in the terminal"},
           {command_toggle_log_keys_pressed, "toggle_log_keys_pressed", "debug command to log key presses"},
           {command_toggle_cursors_active, "toggle_cursors_active", "toggle whether the multiple cursors are active or not"},
@@ -1340,7 +1437,7 @@ bool search_input_complete_func(CeApp_t* app, CeBuffer_t* input_buffer){
      yank->type = CE_VIM_YANK_TYPE_STRING;
 
      // clear input buffer
-     app->input_view.buffer->lines[0][0] = 0;
+     ce_buffer_remove_string(app->input_view.buffer, (CePoint_t){0, 0}, ce_utf8_strlen(app->input_view.buffer->lines[0]));
 
      // insert jump
      CeAppViewData_t* view_data = view->user_data;
@@ -1430,6 +1527,21 @@ typedef struct{
      volatile bool* ready_to_draw;
 }ShellCommandData_t;
 
+// only wake the main loop if it hasn't been woken since it last drew
+static bool notify_shell_command_ready(ShellCommandData_t* shell_command_data){
+     if(__atomic_exchange_n(shell_command_data->ready_to_draw, true, __ATOMIC_ACQ_REL)) return true;
+
+     int rc;
+     do{
+          rc = write(g_shell_command_ready_fds[1], "1", 2);
+     }while(rc == -1 && errno == EINTR);
+     if(rc < 0){
+          ce_log("%s() write() to shell command ready fd failed: %s", __FUNCTION__, strerror(errno));
+          return false;
+     }
+     return true;
+}
+
 void run_shell_command_cleanup(void* data){
      ShellCommandData_t* shell_command_data = (ShellCommandData_t*)(data);
      free(shell_command_data->command);
@@ -1473,13 +1585,7 @@ static void* run_shell_command_and_output_to_buffer(void* data){
 
      while(fgets(bytes, BUFSIZ, subprocess.stdout) != NULL){
           ce_buffer_insert_string(shell_command_data->buffer, bytes, ce_buffer_end_point(shell_command_data->buffer));
-          do{
-               rc = write(g_shell_command_ready_fds[1], "1", 2);
-          }while(rc == -1 && errno == EINTR);
-          if(rc < 0){
-               ce_log("%s() write() to terminal ready fd failed: %s", __FUNCTION__, strerror(errno));
-               pthread_exit(NULL);
-          }
+          if(!notify_shell_command_ready(shell_command_data)) pthread_exit(NULL);
      }
 
      if(ferror(subprocess.stdout)){
@@ -1502,13 +1608,7 @@ static void* run_shell_command_and_output_to_buffer(void* data){
 
      ce_buffer_insert_string(shell_command_data->buffer, bytes, ce_buffer_end_point(shell_command_data->buffer));
      shell_command_data->buffer->status = CE_BUFFER_STATUS_READONLY;
-     do{
-          rc = write(g_shell_command_ready_fds[1], "1", 2);
-     }while(rc == -1 && errno == EINTR);
-     if(rc < 0){
-          ce_log("%s() write() to terminal ready fd failed: %s", __FUNCTION__, strerror(errno));
-          pthread_exit(NULL);
-     }
+     if(!notify_shell_command_ready(shell_command_data)) pthread_exit(NULL);
      // no need to run our cleanup a second time
      pthread_cleanup_pop(0);
      pthread_cleanup_pop(1);
@@ -59,13 +59,111 @@ typedef struct{
      int64_t last_goto_destination;
      CeSyntaxHighlightFunc_t* syntax_function;
      char* base_directory;
+     bool large_file; // some features are turned off until they are turned back on with the large_file_enable command
+     CeSyntaxHighlightFunc_t* large_file_syntax_function; // what the syntax would be if it weren't a large file
 }CeAppBufferData_t;
 
+// everything that determines what a view looks like, if none of it changes, we don't need to redraw the view
+typedef struct{
+     CeBuffer_t* buffer;
+     int64_t buffer_version;
+     CeSyntaxHighlightFunc_t* syntax_function;
+     CeRect_t rect;
+     CePoint_t scroll;
+     CePoint_t cursor;
+     uint64_t highlight_hash;
+     int64_t frame;
+}CeViewDrawState_t;
+
 typedef struct{
      CeJumpList_t jump_list;
      CeBuffer_t* prev_buffer;
+     CeViewDrawState_t draw_state;
 }CeAppViewData_t;
 
+typedef struct{
+     CeRune_t rune;
+     int fg;
+     int bg;
+}CeDrawCell_t;
+
+typedef struct CeDrawScreen_t CeDrawScreen_t;
+
+// sends the cells that differ between cells and drawn_cells to the terminal and places the cursor
+typedef struct{
+     CeDrawBackendType_t type;
+     const char* name;
+     void (*clear_screen)(CeDrawScreen_t* screen); // called when what is on the terminal is unknown and everything will be redrawn
+     void (*flush)(CeDrawScreen_t* screen, CePoint_t cursor);
+     void (*stop)(CeDrawScreen_t* screen); // called when we switch away from the backend or exit, NULL if there is nothing to undo
+}CeDrawBackend_t;
+
+typedef struct{
+     char* bytes;
+     int64_t count;
+     int64_t capacity;
+     int fg; // the colors and position the terminal is currently at
+     int bg;
+     int64_t x;
+     int64_t y;
+     CePoint_t cursor; // where the cursor was left at the end of the last frame
+}CeDrawVtOutput_t;
+
+// a view to highlight this frame, the draw color list is filled in on the highlight pool and drawn afterwards
+typedef struct{
+     CeLayout_t* layout;
+     CeSyntaxHighlightFunc_t* syntax_function;
+     CeDrawColorList_t draw_color_list;
+     CeRangeList_t range_list;
+     bool needs_redraw;
+     int64_t next_same_buffer; // a buffer's tokens are updated as it's highlighted, so one thread does all of its views
+}CeDrawViewJob_t;
+
+// threads that highlight views while the main thread waits, buffers don't change until every view is highlighted
+typedef struct{
+     pthread_t* threads;
+     int64_t thread_count;
+     pthread_mutex_t lock;
+     pthread_cond_t work_ready;
+     pthread_cond_t work_done;
+     int64_t generation; // bumped each time there is a frame's worth of views to highlight
+     int64_t threads_working;
+     bool quit;
+
+     CeDrawViewJob_t* jobs; // the rest are set for each frame
+     int64_t* buffer_jobs;  // the first job for each buffer
+     int64_t buffer_job_count;
+     int64_t next_buffer_job;
+     CeSyntaxDef_t* syntax_defs;
+}CeHighlightPool_t;
+
+struct CeDrawScreen_t{
+     CeDrawCell_t* cells;       // what we compose each frame
+     CeDrawCell_t* drawn_cells; // what we have sent to the terminal
+     int64_t width;
+     int64_t height;
+     int64_t frame;
+     uint64_t frame_hash;       // overlays and options that cover or affect every view
+     bool invalidated;
+     bool redraw_all;
+     CeColorDefs_t color_defs;
+     CeDrawColorList_t draw_color_list; // reused by every view we draw
+     CeRangeList_t range_list;
+     CeDrawViewJob_t* view_jobs; // one per view in the current tab, reused between frames
+     int64_t view_job_count;
+     int64_t view_job_capacity;
+     int64_t* buffer_jobs; // the first job of each buffer that needs highlighting
+     CeHighlightPool_t highlight_pool;
+     const CeDrawBackend_t* backend;
+     CeDrawVtOutput_t vt_output;
+
+     int64_t views_redrawn;
+     int64_t rows_redrawn;
+     int64_t total_rows_redrawn;
+     int64_t bytes_written; // only known for the vt backend
+     int64_t total_bytes_written;
+};
+
 struct CeApp_t;
 
 typedef bool CeUserConfigFunc(struct CeApp_t*);
@@ -129,6 +227,7 @@ typedef struct CeApp_t{
      CeBuffer_t* macro_list_buffer;
      CeBuffer_t* mark_list_buffer;
      CeBuffer_t* jump_list_buffer;
+     CeBuffer_t* syntax_info_buffer;
      CeBuffer_t* shell_command_buffer;
      CeBuffer_t* last_goto_buffer;
      CeComplete_t input_complete;
@@ -157,6 +256,8 @@ typedef struct CeApp_t{
 
      CeMultipleCursors_t multiple_cursors;
 
+     CeDrawScreen_t draw_screen;
+
      // debug
      bool log_key_presses;
 }CeApp_t;
@@ -210,6 +311,8 @@ CeBuffer_t* load_file_into_view(CeBufferNode_t** buffer_node_head, CeView_t* vie
                                 CeTerminal_t** last_terminal, bool insert_into_jump_list, const char* filepath);
 CeBuffer_t* new_buffer();
 void determine_buffer_syntax(CeBuffer_t* buffer);
+void determine_large_file(CeBuffer_t* buffer, CeConfigOptions_t* config_options);
+bool large_file_enable(CeBuffer_t* buffer, const char* feature);
 char* buffer_base_directory(CeBuffer_t* buffer, CeTerminalList_t* terminal_list);
 void complete_files(CeComplete_t* complete, const char* line, const char* base_directory);
 void build_complete_list(CeBuffer_t* buffer, CeComplete_t* complete);
@@ -221,7 +324,8 @@ bool user_config_init(CeUserConfig_t* user_config, const char* filepath);
 void user_config_free(CeUserConfig_t* user_config);
 void update_terminal_last_goto_using_cursor(CeTerminal_t* terminal);
 
-CeTerminal_t* ce_terminal_list_new_terminal(CeTerminalList_t* terminal_list, int width, int height, int64_t scroll_back);
+CeTerminal_t* ce_terminal_list_new_terminal(CeTerminalList_t* terminal_list, int width, int height, int64_t scroll_back,
+                                            int64_t scroll_back_archive);
 CeTerminal_t* ce_buffer_in_terminal_list(CeBuffer_t* buffer, CeTerminalList_t* terminal_list);
 CeTerminal_t* create_terminal(CeApp_t* app, int width, int height);
 void ce_terminal_list_free_terminal(CeTerminalList_t* terminal_list, CeTerminal_t* terminal);
@@ -252,6 +252,11 @@ CeCommandStatus_t command_show_jumps(CeCommand_t* command, void* user_data){
      return command_show_info_buffer(command, user_data, app->jump_list_buffer);
 }
 
+CeCommandStatus_t command_show_syntax_info(CeCommand_t* command, void* user_data){
+     CeApp_t* app = user_data;
+     return command_show_info_buffer(command, user_data, app->syntax_info_buffer);
+}
+
 CeCommandStatus_t command_split_layout(CeCommand_t* command, void* user_data){
      if(command->arg_count != 1) return CE_COMMAND_PRINT_HELP;
      if(command->args[0].type != CE_COMMAND_ARG_STRING) return CE_COMMAND_PRINT_HELP;
@@ -586,7 +591,7 @@ CeCommandStatus_t command_new_terminal(CeCommand_t* command, void* user_data){
 
      CeTerminal_t* terminal = create_terminal(app, width, height);
      if(terminal){
-          ce_view_switch_buffer(command_context.view, terminal->buffer, &app->vim, &app->multiple_cursors,
+          ce_view_switch_buffer(command_context.view, terminal->snapshot.buffer, &app->vim, &app->multiple_cursors,
                                 &app->config_options, &app->terminal_list, &app->last_terminal, true);
           app->vim.mode = CE_VIM_MODE_INSERT;
           app->last_terminal = terminal;
@@ -634,7 +639,42 @@ CeCommandStatus_t command_switch_buffer(CeCommand_t* command, void* user_data){
 }
 
 CeCommandStatus_t command_redraw(CeCommand_t* command, void* user_data){
-     clear();
+     CeApp_t* app = user_data;
+     app->draw_screen.invalidated = true;
+     return CE_COMMAND_SUCCESS;
+}
+
+CeCommandStatus_t command_draw_stats(CeCommand_t* command, void* user_data){
+     if(command->arg_count != 0) return CE_COMMAND_PRINT_HELP;
+     CeApp_t* app = user_data;
+     CeDrawScreen_t* screen = &app->draw_screen;
+     double average = 0.0;
+     if(screen->frame) average = (double)(screen->total_rows_redrawn) / (double)(screen->frame);
+     if(screen->backend && screen->backend->type == CE_DRAW_BACKEND_VT){
+          double average_bytes = 0.0;
+          if(screen->frame) average_bytes = (double)(screen->total_bytes_written) / (double)(screen->frame);
+          ce_app_message(app, "vt: last frame redrew %ld rows in %ld views, wrote %ld bytes, %.2f rows and %.2f bytes per frame over %ld frames",
+                         screen->rows_redrawn, screen->views_redrawn, screen->bytes_written, average, average_bytes,
+                         screen->frame);
+     }else{
+          ce_app_message(app, "curses: last frame redrew %ld rows in %ld views, %.2f rows per frame over %ld frames",
+                         screen->rows_redrawn, screen->views_redrawn, average, screen->frame);
+     }
+     return CE_COMMAND_SUCCESS;
+}
+
+CeCommandStatus_t command_draw_backend(CeCommand_t* command, void* user_data){
+     if(command->arg_count != 1) return CE_COMMAND_PRINT_HELP;
+     if(command->args[0].type != CE_COMMAND_ARG_STRING) return CE_COMMAND_PRINT_HELP;
+     CeApp_t* app = user_data;
+     if(strcmp(command->args[0].string, "curses") == 0){
+          app->config_options.draw_backend = CE_DRAW_BACKEND_CURSES;
+     }else if(strcmp(command->args[0].string, "vt") == 0){
+          app->config_options.draw_backend = CE_DRAW_BACKEND_VT;
+     }else{
+          return CE_COMMAND_PRINT_HELP;
+     }
+
      return CE_COMMAND_SUCCESS;
 }
 
@@ -700,7 +740,7 @@ CeCommandStatus_t command_goto_next_destination(CeCommand_t* command, void* user
      if(!get_command_context(app, &command_context)) return CE_COMMAND_NO_ACTION;
 
      CeBuffer_t* buffer = app->last_goto_buffer;
-     if(!buffer && app->last_terminal) buffer = app->last_terminal->buffer;
+     if(!buffer && app->last_terminal) buffer = app->last_terminal->snapshot.buffer;
      if(!buffer || buffer->line_count == 0) return CE_COMMAND_SUCCESS;
 
      CeAppBufferData_t* buffer_data = buffer->app_data;
@@ -754,7 +794,7 @@ CeCommandStatus_t command_goto_prev_destination(CeCommand_t* command, void* user
      if(!get_command_context(app, &command_context)) return CE_COMMAND_NO_ACTION;
 
      CeBuffer_t* buffer = app->last_goto_buffer;
-     if(!buffer && app->last_terminal) buffer = app->last_terminal->buffer;
+     if(!buffer && app->last_terminal) buffer = app->last_terminal->snapshot.buffer;
      if(!buffer || buffer->line_count == 0) return CE_COMMAND_SUCCESS;
 
      CeAppBufferData_t* buffer_data = buffer->app_data;
@@ -856,6 +896,7 @@ CeCommandStatus_t command_reload_file(CeCommand_t* command, void* user_data){
      ce_buffer_free(command_context.view->buffer);
      command_context.view->buffer->app_data = buffer_data; // NOTE: not great that I need to save user data and reset it
      ce_buffer_load_file(command_context.view->buffer, filename);
+     determine_large_file(command_context.view->buffer, &app->config_options);
      free(filename);
 
      return CE_COMMAND_SUCCESS;
@@ -888,29 +929,45 @@ CeCommandStatus_t command_syntax(CeCommand_t* command, void* user_data){
 
      if(!get_command_context(app, &command_context)) return CE_COMMAND_NO_ACTION;
 
-     CeAppBufferData_t* buffer_data = command_context.view->buffer->app_data;
-
+     CeSyntaxHighlightFunc_t* syntax_function = NULL;
      if(strcmp(command->args[0].string, "c") == 0){
-          buffer_data->syntax_function = ce_syntax_highlight_c;
+          syntax_function = ce_syntax_highlight_c;
      }else if(strcmp(command->args[0].string, "cpp") == 0 ||
               strcmp(command->args[0].string, "c++") == 0){
-          buffer_data->syntax_function = ce_syntax_highlight_cpp;
+          syntax_function = ce_syntax_highlight_cpp;
      }else if(strcmp(command->args[0].string, "python") == 0){
-          buffer_data->syntax_function = ce_syntax_highlight_python;
+          syntax_function = ce_syntax_highlight_python;
      }else if(strcmp(command->args[0].string, "java") == 0){
-          buffer_data->syntax_function = ce_syntax_highlight_java;
+          syntax_function = ce_syntax_highlight_java;
      }else if(strcmp(command->args[0].string, "bash") == 0){
-          buffer_data->syntax_function = ce_syntax_highlight_bash;
+          syntax_function = ce_syntax_highlight_bash;
      }else if(strcmp(command->args[0].string, "config") == 0){
-          buffer_data->syntax_function = ce_syntax_highlight_config;
+          syntax_function = ce_syntax_highlight_config;
+     }else if(strcmp(command->args[0].string, "rust") == 0){
+          syntax_function = ce_syntax_highlight_rust;
+     }else if(strcmp(command->args[0].string, "go") == 0){
+          syntax_function = ce_syntax_highlight_go;
+     }else if(strcmp(command->args[0].string, "json") == 0){
+          syntax_function = ce_syntax_highlight_json;
+     }else if(strcmp(command->args[0].string, "yaml") == 0){
+          syntax_function = ce_syntax_highlight_yaml;
+     }else if(strcmp(command->args[0].string, "markdown") == 0){
+          syntax_function = ce_syntax_highlight_markdown;
+     }else if(strcmp(command->args[0].string, "makefile") == 0){
+          syntax_function = ce_syntax_highlight_makefile;
      }else if(strcmp(command->args[0].string, "diff") == 0){
-          buffer_data->syntax_function = ce_syntax_highlight_diff;
+          syntax_function = ce_syntax_highlight_diff;
      }else if(strcmp(command->args[0].string, "plain") == 0){
-          buffer_data->syntax_function = ce_syntax_highlight_plain;
+          syntax_function = ce_syntax_highlight_plain;
      }else{
           return CE_COMMAND_PRINT_HELP;
      }
 
+     // the choice replaces whatever large file mode stashed, so turning large file features back on keeps it
+     CeAppBufferData_t* buffer_data = command_context.view->buffer->app_data;
+     large_file_enable(command_context.view->buffer, "syntax");
+     buffer_data->syntax_function = syntax_function;
+
      return CE_COMMAND_SUCCESS;
 }
 
@@ -950,6 +1007,24 @@ CeCommandStatus_t command_rename_buffer(CeCommand_t* command, void* user_data){
      return CE_COMMAND_SUCCESS;
 }
 
+CeCommandStatus_t command_large_file_enable(CeCommand_t* command, void* user_data){
+     if(command->arg_count != 1) return CE_COMMAND_PRINT_HELP;
+     if(command->args[0].type != CE_COMMAND_ARG_STRING) return CE_COMMAND_PRINT_HELP;
+     CeApp_t* app = user_data;
+     CommandContext_t command_context = {};
+
+     if(!get_command_context(app, &command_context)) return CE_COMMAND_NO_ACTION;
+
+     CeAppBufferData_t* buffer_data = command_context.view->buffer->app_data;
+     if(!buffer_data->large_file){
+          ce_app_message(app, "'%s' isn't in large file mode", command_context.view->buffer->name);
+          return CE_COMMAND_NO_ACTION;
+     }
+
+     if(!large_file_enable(command_context.view->buffer, command->args[0].string)) return CE_COMMAND_PRINT_HELP;
+     return CE_COMMAND_SUCCESS;
+}
+
 CeCommandStatus_t command_jump_list(CeCommand_t* command, void* user_data){
      if(command->arg_count != 1) return CE_COMMAND_PRINT_HELP;
      if(command->args[0].type != CE_COMMAND_ARG_STRING) return CE_COMMAND_PRINT_HELP;
@@ -1037,17 +1112,46 @@ CeCommandStatus_t command_terminal_command(CeCommand_t* command, void* user_data
 
      update_terminal_last_goto_using_cursor(app->last_terminal);
      ce_run_command_in_terminal(app->last_terminal, command->args[0].string);
-     CeLayout_t* terminal_layout = ce_layout_buffer_in_view(tab_layout, app->last_terminal->buffer);
+     CeLayout_t* terminal_layout = ce_layout_buffer_in_view(tab_layout, app->last_terminal->snapshot.buffer);
      if(terminal_layout){
-          terminal_layout->view.cursor.x = app->last_terminal->cursor.x;
-          terminal_layout->view.cursor.y = app->last_terminal->cursor.y;
-          terminal_layout->view.scroll.y = app->last_terminal->cursor.y + app->last_terminal->start_line;
+          terminal_layout->view.cursor.x = app->last_terminal->snapshot.cursor.x;
+          terminal_layout->view.cursor.y = app->last_terminal->snapshot.cursor.y;
+          terminal_layout->view.scroll.y = app->last_terminal->snapshot.cursor.y + app->last_terminal->snapshot.start_line;
           terminal_layout->view.scroll.x = 0;
      }
 
      return CE_COMMAND_SUCCESS;
 }
 
+CeCommandStatus_t command_terminal_capture(CeCommand_t* command, void* user_data){
+     if(command->arg_count > 1) return CE_COMMAND_PRINT_HELP;
+     if(command->arg_count == 1 && command->args[0].type != CE_COMMAND_ARG_STRING) return CE_COMMAND_PRINT_HELP;
+
+     CeApp_t* app = user_data;
+     CommandContext_t command_context = {};
+     if(!get_command_context(app, &command_context)) return CE_COMMAND_NO_ACTION;
+
+     CeTerminal_t* terminal = ce_buffer_in_terminal_list(command_context.view->buffer, &app->terminal_list);
+     if(!terminal){
+          ce_app_message(app, "terminal_capture: the current view isn't showing a terminal");
+          return CE_COMMAND_FAILURE;
+     }
+
+     if(command->arg_count == 0){
+          ce_terminal_capture_stop(terminal);
+          ce_app_message(app, "terminal_capture: stopped");
+          return CE_COMMAND_SUCCESS;
+     }
+
+     if(!ce_terminal_capture_start(terminal, command->args[0].string)){
+          ce_app_message(app, "terminal_capture: failed to record to %s, see the log", command->args[0].string);
+          return CE_COMMAND_FAILURE;
+     }
+
+     ce_app_message(app, "terminal_capture: recording to %s", command->args[0].string);
+     return CE_COMMAND_SUCCESS;
+}
+
 CeCommandStatus_t command_man_page_on_word_under_cursor(CeCommand_t* command, void* user_data){
      if(command->arg_count != 0) return CE_COMMAND_PRINT_HELP;
 
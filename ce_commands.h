@@ -18,6 +18,7 @@ CeCommandStatus_t command_show_yanks(CeCommand_t* command, void* user_data);
 CeCommandStatus_t command_show_macros(CeCommand_t* command, void* user_data);
 CeCommandStatus_t command_show_marks(CeCommand_t* command, void* user_data);
 CeCommandStatus_t command_show_jumps(CeCommand_t* command, void* user_data);
+CeCommandStatus_t command_show_syntax_info(CeCommand_t* command, void* user_data);
 CeCommandStatus_t command_split_layout(CeCommand_t* command, void* user_data);
 CeCommandStatus_t command_select_parent_layout(CeCommand_t* command, void* user_data);
 CeCommandStatus_t command_delete_layout(CeCommand_t* command, void* user_data);
@@ -34,6 +35,8 @@ CeCommandStatus_t command_switch_to_terminal(CeCommand_t* command, void* user_da
 CeCommandStatus_t command_new_terminal(CeCommand_t* command, void* user_data);
 CeCommandStatus_t command_switch_buffer(CeCommand_t* command, void* user_data);
 CeCommandStatus_t command_redraw(CeCommand_t* command, void* user_data);
+CeCommandStatus_t command_draw_stats(CeCommand_t* command, void* user_data);
+CeCommandStatus_t command_draw_backend(CeCommand_t* command, void* user_data);
 CeCommandStatus_t command_goto_destination_in_line(CeCommand_t* command, void* user_data);
 CeCommandStatus_t command_goto_next_destination(CeCommand_t* command, void* user_data);
 CeCommandStatus_t command_goto_prev_destination(CeCommand_t* command, void* user_data);
@@ -45,8 +48,10 @@ CeCommandStatus_t command_syntax(CeCommand_t* command, void* user_data);
 CeCommandStatus_t command_new_buffer(CeCommand_t* command, void* user_data);
 CeCommandStatus_t command_rename_buffer(CeCommand_t* command, void* user_data);
 CeCommandStatus_t command_jump_list(CeCommand_t* command, void* user_data);
+CeCommandStatus_t command_large_file_enable(CeCommand_t* command, void* user_data);
 CeCommandStatus_t command_line_number(CeCommand_t* command, void* user_data);
 CeCommandStatus_t command_terminal_command(CeCommand_t* command, void* user_data);
+CeCommandStatus_t command_terminal_capture(CeCommand_t* command, void* user_data);
 CeCommandStatus_t command_man_page_on_word_under_cursor(CeCommand_t* command, void* user_data);
 CeCommandStatus_t command_shell_command(CeCommand_t* command, void* user_data);
 
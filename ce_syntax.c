@@ -2,10 +2,11 @@
 
 #include <stdlib.h>
 #include <ncurses.h>
+#include <pthread.h>
 #include <string.h>
 #include <ctype.h>
 
-#define SEARCH_BACK_LINES 1024
+#define SYNTAX_LINE_TOKENS_INITIAL_CAPACITY 8
 
 int ce_syntax_def_get_fg(CeSyntaxDef_t* syntax_defs, CeSyntaxColor_t syntax_color, int current_fg){
      int new_color = syntax_defs[syntax_color].fg;
@@ -19,10 +20,52 @@ int ce_syntax_def_get_bg(CeSyntaxDef_t* syntax_defs, CeSyntaxColor_t syntax_colo
      return new_color;
 }
 
+#define SYNTAX_LIST_INITIAL_CAPACITY 64
+
+// point head, tail and every next into the node array, needed whenever the array moves or nodes are shifted
+static void draw_color_list_link(CeDrawColorList_t* list){
+     for(int64_t i = 0; i < list->count; i++){
+          list->nodes[i].next = (i + 1 < list->count) ? list->nodes + i + 1 : NULL;
+     }
+     list->head = list->count ? list->nodes : NULL;
+     list->tail = list->count ? list->nodes + list->count - 1 : NULL;
+}
+
+static bool draw_color_list_grow(CeDrawColorList_t* list){
+     if(list->count < list->capacity) return true;
+     int64_t new_capacity = list->capacity ? list->capacity * 2 : SYNTAX_LIST_INITIAL_CAPACITY;
+     CeDrawColorNode_t* new_nodes = realloc(list->nodes, new_capacity * sizeof(*new_nodes));
+     if(!new_nodes) return false;
+     list->nodes = new_nodes;
+     list->capacity = new_capacity;
+     draw_color_list_link(list);
+     return true;
+}
+
+static bool range_list_grow(CeRangeList_t* list){
+     if(list->count < list->capacity) return true;
+     int64_t new_capacity = list->capacity ? list->capacity * 2 : SYNTAX_LIST_INITIAL_CAPACITY;
+     uintptr_t old_nodes = (uintptr_t)(list->nodes);
+     CeRangeNode_t* new_nodes = realloc(list->nodes, new_capacity * sizeof(*new_nodes));
+     if(!new_nodes) return false;
+     list->nodes = new_nodes;
+     list->capacity = new_capacity;
+
+     // sorted inserts link nodes out of array order, so the links move with the array instead of being rebuilt
+     for(int64_t i = 0; i < list->count; i++){
+          CeRangeNode_t* next = list->nodes[i].next;
+          if(next) list->nodes[i].next = list->nodes + ((uintptr_t)(next) - old_nodes) / sizeof(*next);
+     }
+     list->head = list->nodes + ((uintptr_t)(list->head) - old_nodes) / sizeof(*list->head);
+     list->tail = list->nodes + ((uintptr_t)(list->tail) - old_nodes) / sizeof(*list->tail);
+     return true;
+}
+
 bool ce_draw_color_list_insert(CeDrawColorList_t* list, int fg, int bg, CePoint_t point){
      if(list->tail && list->tail->fg == fg && list->tail->bg == bg && list->tail->point.y == point.y) return true;
-     CeDrawColorNode_t* node = malloc(sizeof(*node));
-     if(!node) return false;
+     if(!draw_color_list_grow(list)) return false;
+     CeDrawColorNode_t* node = list->nodes + list->count;
+     list->count++;
      node->fg = fg;
      node->bg = bg;
      node->point = point;
@@ -33,21 +76,21 @@ bool ce_draw_color_list_insert(CeDrawColorList_t* list, int fg, int bg, CePoint_
      return true;
 }
 
-void ce_draw_color_list_free(CeDrawColorList_t* list){
-     CeDrawColorNode_t* itr = list->head;
-     while(itr){
-          CeDrawColorNode_t* tmp = itr;
-          itr = itr->next;
-          free(tmp);
-     }
-
+void ce_draw_color_list_clear(CeDrawColorList_t* list){
      list->head = NULL;
      list->tail = NULL;
+     list->count = 0;
+}
+
+void ce_draw_color_list_free(CeDrawColorList_t* list){
+     free(list->nodes);
+     memset(list, 0, sizeof(*list));
 }
 
 bool ce_range_list_insert(CeRangeList_t* list, CePoint_t start, CePoint_t end){
-     CeRangeNode_t* node = malloc(sizeof(*node));
-     if(!node) return false;
+     if(!range_list_grow(list)) return false;
+     CeRangeNode_t* node = list->nodes + list->count;
+     list->count++;
      node->range.start = start;
      node->range.end = end;
      node->next = NULL;
@@ -58,58 +101,47 @@ bool ce_range_list_insert(CeRangeList_t* list, CePoint_t start, CePoint_t end){
 }
 
 bool ce_range_list_insert_sorted(CeRangeList_t* list, CePoint_t start, CePoint_t end){
-     CeRangeNode_t* itr = list->head;
+     // ranges usually come in order, so check whether it goes after the tail before walking the list
      CeRangeNode_t* prev = NULL;
-     while(itr){
-          if(prev){
-               if(ce_point_after(itr->range.start, end) &&
-                  ce_point_after(end, prev->range.end)){
-                    break;
-               }
-          }else{
-               if(ce_point_after(itr->range.start, end)){
-                    break;
-               }
+     CeRangeNode_t* itr = NULL;
+     if(list->tail && ce_point_after(list->tail->range.start, end)){
+          for(itr = list->head; itr; itr = itr->next){
+               if(ce_point_after(itr->range.start, end) && (!prev || ce_point_after(end, prev->range.end))) break;
+               prev = itr;
           }
-
-          prev = itr;
-          itr = itr->next;
+     }else{
+          prev = list->tail;
      }
 
-     if(itr){
-          if(!ce_point_after(end, itr->range.start)) return false;
-     }
+     if(itr && !ce_point_after(end, itr->range.start)) return false;
 
-     CeRangeNode_t* node = malloc(sizeof(*node));
-     if(!node) return false;
+     // the node is added to the end of the array and linked in where it belongs
+     int64_t prev_index = prev ? prev - list->nodes : -1;
+     int64_t itr_index = itr ? itr - list->nodes : -1;
+     if(!range_list_grow(list)) return false;
+     CeRangeNode_t* node = list->nodes + list->count;
+     list->count++;
      node->range.start = start;
      node->range.end = end;
-
-     if(!itr){
-          node->next = NULL;
-     }else{
-          node->next = itr;
-     }
-
-     if(prev){
-          prev->next = node;
+     node->next = (itr_index >= 0) ? list->nodes + itr_index : NULL;
+     if(prev_index >= 0){
+          list->nodes[prev_index].next = node;
      }else{
           list->head = node;
      }
-
+     if(!node->next) list->tail = node;
      return true;
 }
 
-void ce_range_list_free(CeRangeList_t* list){
-     CeRangeNode_t* itr = list->head;
-     while(itr){
-          CeRangeNode_t* tmp = itr;
-          itr = itr->next;
-          free(tmp);
-     }
-
+void ce_range_list_clear(CeRangeList_t* list){
      list->head = NULL;
      list->tail = NULL;
+     list->count = 0;
+}
+
+void ce_range_list_free(CeRangeList_t* list){
+     free(list->nodes);
+     memset(list, 0, sizeof(*list));
 }
 
 int ce_draw_color_list_last_fg_color(CeDrawColorList_t* draw_color_list){
@@ -126,150 +158,107 @@ int ce_draw_color_list_last_bg_color(CeDrawColorList_t* draw_color_list){
 
 int ce_draw_color_list_next_to_last_fg_color(CeDrawColorList_t* draw_color_list){
      int fg = COLOR_DEFAULT;
-     if(draw_color_list->tail && (draw_color_list->head != draw_color_list->tail)){
-          CeDrawColorNode_t* itr = draw_color_list->head;
-          while(itr->next != draw_color_list->tail) itr = itr->next;
-          fg = itr->fg;
-     }
+     if(draw_color_list->count > 1) fg = draw_color_list->nodes[draw_color_list->count - 2].fg;
      return fg;
 }
 
-int ce_color_def_get(CeColorDefs_t* color_defs, int fg, int bg){
-     // search for the already defined color
-     for(int32_t i = 0; i < color_defs->count; ++i){
-          if(color_defs->pairs[i].fg == fg && color_defs->pairs[i].bg == bg){
-               return i;
-          }
-     }
-
-     // increment the color pair we are going to define, but make sure it wraps around to 0 at the max
-     color_defs->current++;
-     color_defs->current %= 256;
-     if(color_defs->current <= 0) color_defs->current = 1; // when we wrap around, start at 1, because curses doesn't like 0 index color pairs
-
-     // create the pair definition
-     init_pair(color_defs->current, fg, bg);
-
-     // set our internal definition
-     color_defs->pairs[color_defs->current].fg = fg;
-     color_defs->pairs[color_defs->current].bg = bg;
-
-     if(color_defs->current >= color_defs->count){
-          color_defs->count = color_defs->current + 1;
-     }
-
-     return color_defs->current;
+static uint32_t color_def_hash(int fg, int bg){
+     uint32_t hash = (uint32_t)(fg + 1) * 2654435761u;
+     hash ^= (uint32_t)(bg + 1) * 40503u;
+     return (hash ^ (hash >> 16)) & (CE_COLOR_DEF_HASH_SIZE - 1);
 }
 
-static bool is_c_type_char(int ch){
-     return isalnum(ch) || ch == '_';
+static void color_def_hash_insert(CeColorDefs_t* color_defs, int16_t pair_id){
+     CeColorPair_t* pair = color_defs->pairs + pair_id;
+     uint32_t index = color_def_hash(pair->fg, pair->bg);
+     while(color_defs->hash_table[index]) index = (index + 1) & (CE_COLOR_DEF_HASH_SIZE - 1);
+     color_defs->hash_table[index] = pair_id;
 }
 
-static int64_t match_words(const char* str, const char* beginning_of_line, const char** words, int64_t word_count){
-     for(int64_t i = 0; i < word_count; ++i){
-          int64_t word_len = strlen(words[i]);
-          if(strncmp(words[i], str, word_len) == 0){
-               // make sure word isn't in the middle of an identifier
-               char post_char = str[word_len];
-               if(is_c_type_char(post_char)) return 0;
-               if(str > beginning_of_line){
-                    char pre_char = *(str - 1);
-                    if(is_c_type_char(pre_char)) return 0;
-               }
+int ce_color_def_get(CeColorDefs_t* color_defs, int fg, int bg){
+     color_defs->uses++;
 
-               return word_len;
+     // search for the already defined color
+     uint32_t index = color_def_hash(fg, bg);
+     while(color_defs->hash_table[index]){
+          CeColorPair_t* pair = color_defs->pairs + color_defs->hash_table[index];
+          if(pair->fg == fg && pair->bg == bg){
+               pair->last_used = color_defs->uses;
+               return color_defs->hash_table[index];
           }
+          index = (index + 1) & (CE_COLOR_DEF_HASH_SIZE - 1);
      }
 
-     return 0;
-}
+     if(color_defs->capacity == 0){
+          color_defs->capacity = ((COLOR_PAIRS < CE_COLOR_PAIR_MAX) ? COLOR_PAIRS : CE_COLOR_PAIR_MAX) - 1;
+          if(color_defs->capacity < 1) color_defs->capacity = 1;
+     }
 
-static int64_t match_c_type(const char* str, const char* beginning_of_line){
-     if(!isalpha(*str)) return false;
+     int16_t pair_id;
+     if(color_defs->count < color_defs->capacity){
+          // curses doesn't like 0 index color pairs
+          pair_id = ++color_defs->count;
+     }else{
+          pair_id = 1;
+          for(int16_t i = 2; i <= color_defs->count; i++){
+               if(color_defs->pairs[i].last_used < color_defs->pairs[pair_id].last_used) pair_id = i;
+          }
 
-     const char* itr = str;
-     while(*itr){
-          if(!is_c_type_char(*itr)) break;
-          itr++;
-     }
+          color_defs->last_evicted = color_defs->pairs[pair_id];
+          color_defs->evictions++;
 
-     int64_t len = itr - str;
-     if(len > 1){
-          if(strncmp((itr - 2), "_t", 2) == 0) return len;
+          // evictions are rare, so rebuild the table rather than deal with deleting from the probe sequence
+          memset(color_defs->hash_table, 0, sizeof(color_defs->hash_table));
+          for(int16_t i = 1; i <= color_defs->count; i++){
+               if(i != pair_id) color_def_hash_insert(color_defs, i);
+          }
      }
 
-     static const char* keywords[] = {
-          "bool",
-          "char",
-          "double",
-          "float",
-          "int",
-          "long",
-          "short",
-          "signed",
-          "unsigned",
-          "void",
-          "S8",
-          "S16",
-          "S32",
-          "S64",
-          "U8",
-          "U16",
-          "U32",
-          "U64",
-          "F32",
-          "F64",
-     };
-
-     static const int64_t keyword_count = sizeof(keywords) / sizeof(keywords[0]);
-
-     return match_words(str, beginning_of_line, keywords, keyword_count);
-}
-
-static int64_t match_c_keyword(const char* str, const char* beginning_of_line){
-     static const char* keywords[] = {
-          "__thread",
-          "auto",
-          "case",
-          "default",
-          "do",
-          "else",
-          "enum",
-          "extern",
-          "false",
-          "for",
-          "if",
-          "inline",
-          "register",
-          "sizeof",
-          "static",
-          "struct",
-          "switch",
-          "true",
-          "typedef",
-          "typeof",
-          "union",
-          "volatile",
-          "while",
-     };
+     // create the pair definition
+     init_pair(pair_id, fg, bg);
 
-     static const int64_t keyword_count = sizeof(keywords) / sizeof(keywords[0]);
+     // set our internal definition
+     color_defs->pairs[pair_id].fg = fg;
+     color_defs->pairs[pair_id].bg = bg;
+     color_defs->pairs[pair_id].last_used = color_defs->uses;
+     color_def_hash_insert(color_defs, pair_id);
 
-     return match_words(str, beginning_of_line, keywords, keyword_count);
+     return pair_id;
 }
 
-static int64_t match_c_control(const char* str, const char* beginning_of_line){
-     static const char* keywords [] = {
-          "break",
-          "const",
-          "continue",
-          "goto",
-          "return",
-     };
+static bool is_c_type_char(int ch){
+     return isalnum(ch) || ch == '_';
+}
 
-     static const int64_t keyword_count = sizeof(keywords) / sizeof(keywords[0]);
+typedef struct{
+     const char* word;
+     int64_t len;
+     CeSyntaxColor_t color;
+}SyntaxKeyword_t;
+
+#define SYNTAX_KEYWORD(word, color) {word, sizeof(word) - 1, color}
+
+#define SYNTAX_ARRAY_COUNT(array) ((int64_t)(sizeof(array) / sizeof(array[0])))
+
+// returns the color of the keyword if the len bytes at str are one, keyword tables are sorted by length and then by
+// strcmp(), so this is one binary search instead of comparing against every word
+static bool syntax_keyword_lookup(const SyntaxKeyword_t* keywords, int64_t keyword_count, const char* str, int64_t len,
+                                  CeSyntaxColor_t* color){
+     int64_t low = 0;
+     int64_t high = keyword_count - 1;
+     while(low <= high){
+          int64_t mid = (low + high) / 2;
+          const SyntaxKeyword_t* keyword = keywords + mid;
+          int cmp = (keyword->len == len) ? strncmp(keyword->word, str, len) : (keyword->len < len ? -1 : 1);
+          if(cmp == 0){
+               *color = keyword->color;
+               return true;
+          }
+          if(cmp < 0) low = mid + 1;
+          else high = mid - 1;
+     }
 
-     return match_words(str, beginning_of_line, keywords, keyword_count);
+     return false;
 }
 
 static bool is_caps_var_char(int ch){
@@ -314,49 +303,6 @@ static int64_t match_c_preproc(const char* str){
      return 0;
 }
 
-static int64_t utf8_strlen_until_trailing_whitespace(const char* str){
-     const char* itr = str;
-     while(*itr) itr++;
-     itr--;
-     while(itr > str && *itr && isblank(*itr)) itr--;
-     return ce_utf8_strlen_between(str, itr);
-}
-
-static int64_t match_c_comment(const char* str){
-     if(strncmp("//", str, 2) == 0) return utf8_strlen_until_trailing_whitespace(str);
-     return 0;
-}
-
-static int64_t match_c_multiline_comment(const char* str){
-     if(strncmp("/*", str, 2) == 0){
-          char* matching_comment = strstr(str, "*/");
-          if(matching_comment) return (matching_comment - str);
-          return utf8_strlen_until_trailing_whitespace(str);
-     }
-
-     return 0;
-}
-
-static int64_t match_c_multiline_comment_end(const char* str){
-     if(strncmp("*/", str, 2) == 0) return 2;
-
-     return 0;
-}
-
-static int64_t match_c_string(const char* str){
-     if(*str == '"'){
-          const char* match = str;
-          while(match){
-               match = strchr(match + 1, '"');
-               if(match && *(match - 1) != '\\'){
-                    return (match - str) + 1;
-               }
-          }
-     }
-
-     return 0;
-}
-
 static int64_t match_c_character_literal(const char* str){
      // c character literals are one character long unless that character is escaped
      // in which case the literal will be 2 characters long before we see an end '
@@ -458,14 +404,32 @@ static int64_t match_c_literal(const char* str, const char* beginning_of_line){
      return count;
 }
 
-static int64_t match_trailing_whitespace(const char* str){
-     const char* itr = str;
-     while(*itr){
-          if(!isspace(*itr)) return 0;
-          itr++;
-     }
+// walks a line one rune at a time, so highlighters can hand each match function the byte position of the current rune
+// without decoding the line from the beginning for every character
+typedef struct{
+     const char* line;
+     const char* str;                 // current position in the line
+     int64_t x;                       // rune index of str
+     int64_t len;                     // runes in the line, -1 if the line isn't valid utf8
+     const char* trailing_whitespace; // where the whitespace at the end of the line starts
+}SyntaxCursor_t;
+
+static SyntaxCursor_t syntax_cursor_begin(const char* line){
+     SyntaxCursor_t cursor = {line, line, 0, ce_utf8_strlen(line), line + strlen(line)};
+     while(cursor.trailing_whitespace > line && isspace(cursor.trailing_whitespace[-1])) cursor.trailing_whitespace--;
+     return cursor;
+}
 
-     return (itr - str);
+static void syntax_cursor_next(SyntaxCursor_t* cursor){
+     int64_t bytes = 1;
+     ce_utf8_decode(cursor->str, &bytes);
+     cursor->str += bytes;
+     cursor->x++;
+}
+
+static int64_t match_trailing_whitespace(const SyntaxCursor_t* cursor){
+     if(cursor->str < cursor->trailing_whitespace) return 0;
+     return strlen(cursor->str);
 }
 
 static void change_draw_color(CeDrawColorList_t* draw_color_list, CeSyntaxDef_t* syntax_defs, CeSyntaxColor_t syntax_color, CePoint_t point){
@@ -534,587 +498,523 @@ void check_visual_mode_end(CeRangeNode_t* range_node, bool* in_visual, int64_t l
      }
 }
 
-void ce_syntax_highlight_c(CeView_t* view, CeRangeList_t* highlight_range_list, CeDrawColorList_t* draw_color_list,
-                           CeSyntaxDef_t* syntax_defs, void* user_data){
-     if(!view->buffer) return;
-     if(view->buffer->line_count <= 0) return;
-     int64_t min = view->scroll.y;
-     int64_t max = min + (view->rect.bottom - view->rect.top);
-     int64_t clamp_max = (view->buffer->line_count - 1);
-     if(clamp_max < 0) clamp_max = 0;
-     CE_CLAMP(min, 0, clamp_max);
-     CE_CLAMP(max, 0, clamp_max);
-     int64_t match_len = 0;
-     bool multiline_comment = false;
-     bool in_visual = false;
-     CeRangeNode_t* range_node = highlight_range_list->head;
-
-     check_visual_start(range_node, min, draw_color_list, syntax_defs, &in_visual);
-
-     int prepass_min = min - SEARCH_BACK_LINES;
-     if(prepass_min < 0) prepass_min = 0;
+// counts the runes in [start, end)
+static int64_t syntax_rune_count(const char* start, const char* end){
+     int64_t count = 0;
+     for(const char* itr = start; itr < end; itr++){
+          if((*itr & 0xC0) != 0x80) count++;
+     }
+     return count;
+}
 
-     // pre-pass to check if we are in a multiline comment
-     for(int64_t y = prepass_min; y < min; y++){
-          char* line = view->buffer->lines[y];
-          int64_t line_len = ce_utf8_strlen(line);
+typedef enum{
+     SYNTAX_RULE_LINE,         // from the opener up to the trailing whitespace at the end of the line
+     SYNTAX_RULE_REGION,       // from the opener through the closer, the closer may be on a later line if multi_line is set
+     SYNTAX_RULE_CHAR_LITERAL, // c style character literal starting at the opener
+     SYNTAX_RULE_PREPROC,      // the opener followed by letters
+}SyntaxRuleType_t;
+
+typedef struct{
+     SyntaxRuleType_t type;
+     const char* open;
+     const char* close;
+     char escape;          // the character after this one can't close a region
+     bool multi_line;
+     bool line_start_only; // the opener only counts as the first character on the line
+     CeSyntaxColor_t color;
+}SyntaxRule_t;
+
+#define SYNTAX_DFA_MAX_STATES 64
+
+#define SYNTAX_ACCEPT_NONE -1
+#define SYNTAX_ACCEPT_IDENTIFIER -2
+#define SYNTAX_ACCEPT_NUMBER -3
+
+#define SYNTAX_DFA_IDENTIFIER_STATE 1
+#define SYNTAX_DFA_NUMBER_STATE 2
+#define SYNTAX_DFA_NUMBER_PREFIX_STATE 3
+#define SYNTAX_DFA_FIRST_RULE_STATE 4
+
+// describes a language, the rule openers, identifiers and numbers are compiled into a dfa the first time the lexer is used
+// so finding the token at a position is one walk over the table, lexer states for multi line regions are the rule
+// index + 1 and 0 when outside of any region
+typedef struct{
+     const SyntaxRule_t* rules;
+     int64_t rule_count;
+     const SyntaxKeyword_t* keywords;
+     int64_t keyword_count;
+     bool type_suffix; // identifiers ending in _t are types
+     bool caps_vars;
+     bool numbers;
+
+     bool compiled;
+     int64_t state_count;
+     uint8_t transitions[SYNTAX_DFA_MAX_STATES][256]; // 0 is the start state, so going back to it means no match
+     int8_t accept[SYNTAX_DFA_MAX_STATES];              // rule index or one of the SYNTAX_ACCEPT_* values
+}SyntaxLexer_t;
+
+#define SYNTAX_LEXER(rule_list, keyword_list) .rules = rule_list, .rule_count = SYNTAX_ARRAY_COUNT(rule_list), \
+                                               .keywords = keyword_list, .keyword_count = SYNTAX_ARRAY_COUNT(keyword_list)
+
+typedef struct{
+     int64_t len; // in runes, 0 if nothing matched
+     CeSyntaxColor_t color;
+}SyntaxToken_t;
+
+// views are highlighted on several threads at once, so the first use of a lexer may race to compile it
+static pthread_mutex_t g_lexer_compile_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void syntax_lexer_compile(SyntaxLexer_t* lexer){
+     pthread_mutex_lock(&g_lexer_compile_lock);
+     if(lexer->compiled){
+          pthread_mutex_unlock(&g_lexer_compile_lock);
+          return;
+     }
 
-          for(int64_t x = 0; x < line_len; ++x){
-               char* str = ce_utf8_iterate_to(line, x);
+     memset(lexer->transitions, 0, sizeof(lexer->transitions));
+     memset(lexer->accept, SYNTAX_ACCEPT_NONE, sizeof(lexer->accept));
+     lexer->state_count = SYNTAX_DFA_FIRST_RULE_STATE;
 
-               if(multiline_comment){
-                    if(match_c_multiline_comment_end(str)){
-                         multiline_comment = false;
-                    }
-               }else{
-                    if((match_len = match_c_multiline_comment(str))){
-                         multiline_comment = true;
-                         x += (match_len - 1);
-                    }
-               }
+     for(int ch = 0; ch < 256; ch++){
+          if(isalpha(ch) || ch == '_'){
+               lexer->transitions[0][ch] = SYNTAX_DFA_IDENTIFIER_STATE;
           }
+          if(is_c_type_char(ch)) lexer->transitions[SYNTAX_DFA_IDENTIFIER_STATE][ch] = SYNTAX_DFA_IDENTIFIER_STATE;
      }
+     lexer->accept[SYNTAX_DFA_IDENTIFIER_STATE] = SYNTAX_ACCEPT_IDENTIFIER;
 
-     for(int64_t y = min; y <= max; ++y){
-          char* line = view->buffer->lines[y];
-          int64_t line_len = ce_utf8_strlen(line);
-          int64_t current_match_len = 1;
-          CePoint_t match_point = {0, y};
-
-          if(multiline_comment){
-               change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_COMMENT, match_point);
+     if(lexer->numbers){
+          for(int ch = '0'; ch <= '9'; ch++){
+               lexer->transitions[0][ch] = SYNTAX_DFA_NUMBER_STATE;
+               lexer->transitions[SYNTAX_DFA_NUMBER_PREFIX_STATE][ch] = SYNTAX_DFA_NUMBER_STATE;
           }
+          lexer->transitions[0]['-'] = SYNTAX_DFA_NUMBER_PREFIX_STATE;
+          lexer->transitions[0]['.'] = SYNTAX_DFA_NUMBER_PREFIX_STATE;
+          lexer->transitions[SYNTAX_DFA_NUMBER_PREFIX_STATE]['.'] = SYNTAX_DFA_NUMBER_STATE;
+          lexer->accept[SYNTAX_DFA_NUMBER_STATE] = SYNTAX_ACCEPT_NUMBER;
+     }
 
-          ce_syntax_highlight_visual(&range_node, &in_visual, match_point, draw_color_list, syntax_defs);
-
-          if(in_visual && line_len == 0) change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_VISUAL, match_point);
-
-          for(int64_t x = 0; x < line_len; ++x){
-               char* str = ce_utf8_iterate_to(line, x);
-               match_point.x = x;
-
-               ce_syntax_highlight_visual(&range_node, &in_visual, match_point, draw_color_list, syntax_defs);
-
-               if(current_match_len <= 1){
-                    if(multiline_comment){
-                         if((match_len = match_c_multiline_comment_end(str))){
-                              multiline_comment = false;
-                         }else if(((view->cursor.y != y) || (x > view->cursor.x)) && (match_len = match_trailing_whitespace(str))){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_TRAILING_WHITESPACE, match_point);
-                              ce_draw_color_list_insert(draw_color_list, ce_syntax_def_get_fg(syntax_defs, CE_SYNTAX_COLOR_NORMAL, COLOR_DEFAULT),
-                                                        ce_syntax_def_get_bg(syntax_defs, CE_SYNTAX_COLOR_NORMAL, COLOR_DEFAULT),
-                                                        (CePoint_t){0, match_point.y + 1});
-                         }
-                    }else{
-                         if((match_len = match_c_type(str, line))){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_TYPE, match_point);
-                         }else if((match_len = match_c_keyword(str, line))){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_KEYWORD, match_point);
-                         }else if((match_len = match_c_control(str, line))){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_CONTROL, match_point);
-                         }else if((match_len = match_caps_var(str, line))){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_CAPS_VAR, match_point);
-                         }else if((match_len = match_c_comment(str))){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_COMMENT, match_point);
-                         }else if((match_len = match_c_string(str))){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_STRING, match_point);
-                         }else if((match_len = match_c_character_literal(str))){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_CHAR_LITERAL, match_point);
-                         }else if((match_len = match_c_literal(str, line))){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_NUMBER_LITERAL, match_point);
-                         }else if((match_len = match_c_preproc(str))){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_PREPROCESSOR, match_point);
-                         }else if((match_len = match_c_multiline_comment(str))){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_COMMENT, match_point);
-                              multiline_comment = true;
-                         }else if(((view->cursor.y != y) || (x > view->cursor.x)) && (match_len = match_trailing_whitespace(str))){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_TRAILING_WHITESPACE, match_point);
-                              ce_draw_color_list_insert(draw_color_list, ce_syntax_def_get_fg(syntax_defs, CE_SYNTAX_COLOR_NORMAL, COLOR_DEFAULT),
-                                                        ce_syntax_def_get_bg(syntax_defs, CE_SYNTAX_COLOR_NORMAL, COLOR_DEFAULT),
-                                                        (CePoint_t){0, match_point.y + 1});
-                         }else if(!draw_color_list->tail || (draw_color_list->tail->fg != COLOR_DEFAULT || draw_color_list->tail->bg != COLOR_DEFAULT)){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_NORMAL, match_point);
-                         }
+     // openers form a trie, when two rules share an opener the first one wins
+     for(int64_t r = 0; r < lexer->rule_count; r++){
+          const unsigned char* itr = (const unsigned char*)(lexer->rules[r].open);
+          int64_t state = 0;
+          for(; *itr; itr++){
+               int64_t next = lexer->transitions[state][*itr];
+               if(next == 0){
+                    if(lexer->state_count >= SYNTAX_DFA_MAX_STATES){
+                         ce_log("%s() ran out of dfa states adding '%s'\n", __FUNCTION__, lexer->rules[r].open);
+                         break;
                     }
-
-                    if(match_len) current_match_len = match_len;
-               }else{
-                    current_match_len--;
+                    next = lexer->state_count++;
+                    lexer->transitions[state][*itr] = next;
+               }else if(next < SYNTAX_DFA_FIRST_RULE_STATE){
+                    ce_log("%s() rule opener '%s' overlaps identifiers or numbers\n", __FUNCTION__, lexer->rules[r].open);
+                    break;
                }
-
-               if(in_visual) change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_VISUAL, match_point);
+               state = next;
           }
 
-          check_visual_mode_end(range_node, &in_visual, match_point.y, line_len, draw_color_list);
+          if(*itr == 0 && lexer->accept[state] == SYNTAX_ACCEPT_NONE) lexer->accept[state] = r;
      }
-}
 
-static int64_t match_cpp_keyword(const char* str, const char* beginning_of_line){
-     static const char* keywords[] = {
-          "Asm",
-          "auto",
-          "bool",
-          "case",
-          "char",
-          "class",
-          "const_cast",
-          "default",
-          "delete",
-          "do",
-          "double",
-          "else",
-          "enum",
-          "dynamic_cast",
-          "extern",
-          "false",
-          "float",
-          "for",
-          "union",
-          "unsigned",
-          "using",
-          "friend",
-          "if",
-          "inline",
-          "int",
-          "long",
-          "mutable",
-          "virtual",
-          "namespace",
-          "new",
-          "nullptr",
-          "operator",
-          "private",
-          "protected",
-          "public",
-          "register",
-          "void",
-          "reinterpret_cast",
-          "short",
-          "signed",
-          "sizeof",
-          "static",
-          "static_cast",
-          "volatile",
-          "struct",
-          "switch",
-          "template",
-          "this",
-          "true",
-          "typedef",
-          "typeid",
-          "typename",
-          "unsigned",
-          "wchar_t",
-          "while",
-     };
-
-     static const int64_t keyword_count = sizeof(keywords) / sizeof(keywords[0]);
-
-     return match_words(str, beginning_of_line, keywords, keyword_count);
+     __atomic_store_n(&lexer->compiled, true, __ATOMIC_RELEASE);
+     pthread_mutex_unlock(&g_lexer_compile_lock);
 }
 
-static int64_t match_cpp_control(const char* str, const char* beginning_of_line){
-     static const char* keywords [] = {
-          "break",
-          "catch",
-          "const",
-          "continue",
-          "goto",
-          "return",
-          "throw",
-          "try",
-     };
-
-     static const int64_t keyword_count = sizeof(keywords) / sizeof(keywords[0]);
-
-     return match_words(str, beginning_of_line, keywords, keyword_count);
+// walk the dfa as far as it goes and return what the longest match accepted
+static int8_t syntax_lexer_match(const SyntaxLexer_t* lexer, const char* str, int64_t* match_bytes){
+     int8_t accept = SYNTAX_ACCEPT_NONE;
+     int64_t state = 0;
+     for(const unsigned char* itr = (const unsigned char*)(str); *itr; itr++){
+          state = lexer->transitions[state][*itr];
+          if(state == 0) break;
+          if(lexer->accept[state] != SYNTAX_ACCEPT_NONE){
+               accept = lexer->accept[state];
+               *match_bytes = (itr + 1) - (const unsigned char*)(str);
+          }
+     }
+     return accept;
 }
 
-void ce_syntax_highlight_cpp(CeView_t* view, CeRangeList_t* highlight_range_list, CeDrawColorList_t* draw_color_list,
-                             CeSyntaxDef_t* syntax_defs, void* user_data){
-     if(!view->buffer) return;
-     if(view->buffer->line_count <= 0) return;
-     int64_t min = view->scroll.y;
-     int64_t max = min + (view->rect.bottom - view->rect.top);
-     int64_t clamp_max = (view->buffer->line_count - 1);
-     if(clamp_max < 0) clamp_max = 0;
-     CE_CLAMP(min, 0, clamp_max);
-     CE_CLAMP(max, 0, clamp_max);
-     int64_t match_len = 0;
-     bool multiline_comment = false;
-     bool in_visual = false;
-     CeRangeNode_t* range_node = highlight_range_list->head;
-
-     check_visual_start(range_node, min, draw_color_list, syntax_defs, &in_visual);
-
-     int prepass_min = min - SEARCH_BACK_LINES;
-     if(prepass_min < 0) prepass_min = 0;
-
-     // pre-pass to check if we are in a multiline comment
-     for(int64_t y = prepass_min; y < min; y++){
-          char* line = view->buffer->lines[y];
-          int64_t line_len = ce_utf8_strlen(line);
-
-          for(int64_t x = 0; x < line_len; ++x){
-               char* str = ce_utf8_iterate_to(line, x);
-
-               if(multiline_comment){
-                    if(match_c_multiline_comment_end(str)){
-                         multiline_comment = false;
-                    }
-               }else{
-                    if((match_len = match_c_multiline_comment(str))){
-                         multiline_comment = true;
-                         x += (match_len - 1);
-                    }
-               }
+static const char* syntax_region_close(const SyntaxRule_t* rule, const char* str){
+     int64_t close_len = strlen(rule->close);
+     for(const char* itr = str; *itr; itr++){
+          if(rule->escape && *itr == rule->escape){
+               if(!itr[1]) break;
+               itr++;
+               continue;
           }
+          if(strncmp(itr, rule->close, close_len) == 0) return itr + close_len;
      }
+     return NULL;
+}
 
-     for(int64_t y = min; y <= max; ++y){
-          char* line = view->buffer->lines[y];
-          int64_t line_len = ce_utf8_strlen(line);
-          int64_t current_match_len = 1;
-          CePoint_t match_point = {0, y};
+// the rest of a multi line region, or up to the trailing whitespace of the line if the region doesn't end on it
+static SyntaxToken_t syntax_region_rest(const SyntaxRule_t* rule, const SyntaxCursor_t* cursor, const char* str, int32_t* state){
+     const char* end = syntax_region_close(rule, str);
+     if(end){
+          *state = 0;
+     }else{
+          end = (cursor->str < cursor->trailing_whitespace) ? cursor->trailing_whitespace : cursor->str + strlen(cursor->str);
+     }
+     return (SyntaxToken_t){syntax_rune_count(cursor->str, end), rule->color};
+}
 
-          if(multiline_comment){
-               change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_COMMENT, match_point);
+static SyntaxToken_t syntax_lex(SyntaxLexer_t* lexer, const SyntaxCursor_t* cursor, int32_t* state){
+     const char* str = cursor->str;
+     SyntaxToken_t token = {0, CE_SYNTAX_COLOR_NORMAL};
+
+     if(*state > 0 && *state <= lexer->rule_count) return syntax_region_rest(lexer->rules + (*state - 1), cursor, str, state);
+
+     int64_t match_bytes = 0;
+     int8_t accept = syntax_lexer_match(lexer, str, &match_bytes);
+     switch(accept){
+     default:{
+          const SyntaxRule_t* rule = lexer->rules + accept;
+          if(rule->line_start_only && str != cursor->line) break;
+
+          switch(rule->type){
+          case SYNTAX_RULE_LINE:{
+               const char* end = (str < cursor->trailing_whitespace) ? cursor->trailing_whitespace : str + match_bytes;
+               token = (SyntaxToken_t){syntax_rune_count(str, end), rule->color};
+          } break;
+          case SYNTAX_RULE_REGION:{
+               const char* end = syntax_region_close(rule, str + match_bytes);
+               if(end){
+                    token = (SyntaxToken_t){syntax_rune_count(str, end), rule->color};
+               }else if(rule->multi_line){
+                    *state = accept + 1;
+                    token = (SyntaxToken_t){syntax_rune_count(str, cursor->trailing_whitespace), rule->color};
+               }
+          } break;
+          case SYNTAX_RULE_CHAR_LITERAL:
+               token.len = match_c_character_literal(str);
+               break;
+          case SYNTAX_RULE_PREPROC:
+               token.len = match_c_preproc(str);
+               break;
           }
 
-          ce_syntax_highlight_visual(&range_node, &in_visual, match_point, draw_color_list, syntax_defs);
-
-          if(in_visual && line_len == 0) change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_VISUAL, match_point);
-
-          for(int64_t x = 0; x < line_len; ++x){
-               char* str = ce_utf8_iterate_to(line, x);
-               match_point.x = x;
-
-               ce_syntax_highlight_visual(&range_node, &in_visual, match_point, draw_color_list, syntax_defs);
+          if(token.len) token.color = rule->color;
+     } break;
+     case SYNTAX_ACCEPT_NONE:
+          break;
+     case SYNTAX_ACCEPT_IDENTIFIER:
+          token.len = match_bytes;
+          // the middle of an identifier, like after a number that ran into it
+          if(str > cursor->line && is_c_type_char(str[-1])) break;
+          if(lexer->type_suffix && isalpha(*str) && match_bytes > 1 && strncmp(str + match_bytes - 2, "_t", 2) == 0){
+               token.color = CE_SYNTAX_COLOR_TYPE;
+          }else if(syntax_keyword_lookup(lexer->keywords, lexer->keyword_count, str, match_bytes, &token.color)){
+               // found it
+          }else if(lexer->caps_vars && match_caps_var(str, cursor->line)){
+               token.color = CE_SYNTAX_COLOR_CAPS_VAR;
+          }
+          break;
+     case SYNTAX_ACCEPT_NUMBER:
+          token.len = match_c_literal(str, cursor->line);
+          if(token.len) token.color = CE_SYNTAX_COLOR_NUMBER_LITERAL;
+          break;
+     }
 
-               if(current_match_len <= 1){
-                    if(multiline_comment){
-                         if((match_len = match_c_multiline_comment_end(str))){
-                              multiline_comment = false;
-                         }else if(((view->cursor.y != y) || (x > view->cursor.x)) && (match_len = match_trailing_whitespace(str))){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_TRAILING_WHITESPACE, match_point);
-                              ce_draw_color_list_insert(draw_color_list, ce_syntax_def_get_fg(syntax_defs, CE_SYNTAX_COLOR_NORMAL, COLOR_DEFAULT),
-                                                        ce_syntax_def_get_bg(syntax_defs, CE_SYNTAX_COLOR_NORMAL, COLOR_DEFAULT),
-                                                        (CePoint_t){0, match_point.y + 1});
-                         }
-                    }else{
-                         if((match_len = match_c_type(str, line))){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_TYPE, match_point);
-                         }else if((match_len = match_cpp_keyword(str, line))){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_KEYWORD, match_point);
-                         }else if((match_len = match_cpp_control(str, line))){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_CONTROL, match_point);
-                         }else if((match_len = match_caps_var(str, line))){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_CAPS_VAR, match_point);
-                         }else if((match_len = match_c_comment(str))){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_COMMENT, match_point);
-                         }else if((match_len = match_c_string(str))){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_STRING, match_point);
-                         }else if((match_len = match_c_character_literal(str))){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_CHAR_LITERAL, match_point);
-                         }else if((match_len = match_c_literal(str, line))){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_NUMBER_LITERAL, match_point);
-                         }else if((match_len = match_c_preproc(str))){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_PREPROCESSOR, match_point);
-                         }else if((match_len = match_c_multiline_comment(str))){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_COMMENT, match_point);
-                              multiline_comment = true;
-                         }else if(((view->cursor.y != y) || (x > view->cursor.x)) && (match_len = match_trailing_whitespace(str))){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_TRAILING_WHITESPACE, match_point);
-                              ce_draw_color_list_insert(draw_color_list, ce_syntax_def_get_fg(syntax_defs, CE_SYNTAX_COLOR_NORMAL, COLOR_DEFAULT),
-                                                        ce_syntax_def_get_bg(syntax_defs, CE_SYNTAX_COLOR_NORMAL, COLOR_DEFAULT),
-                                                        (CePoint_t){0, match_point.y + 1});
-                         }else if(!draw_color_list->tail || (draw_color_list->tail->fg != COLOR_DEFAULT || draw_color_list->tail->bg != COLOR_DEFAULT)){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_NORMAL, match_point);
-                         }
-                    }
+     return token;
+}
 
-                    if(match_len) current_match_len = match_len;
-               }else{
-                    current_match_len--;
-               }
+static bool syntax_line_tokens_append(CeBufferLineTokens_t* line_tokens, int64_t start, int64_t len, CeSyntaxColor_t color){
+     if(line_tokens->count >= line_tokens->capacity){
+          int32_t new_capacity = line_tokens->capacity ? line_tokens->capacity * 2 : SYNTAX_LINE_TOKENS_INITIAL_CAPACITY;
+          CeBufferToken_t* new_tokens = realloc(line_tokens->tokens, new_capacity * sizeof(*new_tokens));
+          if(!new_tokens) return false;
+          line_tokens->tokens = new_tokens;
+          line_tokens->capacity = new_capacity;
+     }
+     line_tokens->tokens[line_tokens->count++] = (CeBufferToken_t){start, len, color};
+     return true;
+}
 
-               if(in_visual) change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_VISUAL, match_point);
+// lexes the line into its token list and returns the state the next line starts in
+static int32_t syntax_tokenize_line(SyntaxLexer_t* lexer, const char* line, CeBufferLineTokens_t* line_tokens){
+     int32_t state = line_tokens->start_state;
+     line_tokens->count = 0;
+     SyntaxCursor_t line_cursor = syntax_cursor_begin(line);
+     while(line_cursor.x < line_cursor.len){
+          SyntaxToken_t token = syntax_lex(lexer, &line_cursor, &state);
+          if(token.len && token.color != CE_SYNTAX_COLOR_NORMAL){
+               syntax_line_tokens_append(line_tokens, line_cursor.x, token.len, token.color);
           }
-
-          check_visual_mode_end(range_node, &in_visual, match_point.y, line_len, draw_color_list);
+          int64_t advance = token.len ? token.len : 1;
+          for(int64_t i = 0; i < advance && line_cursor.x < line_cursor.len; i++) syntax_cursor_next(&line_cursor);
      }
+     return state;
 }
 
-static int64_t match_java_type(const char* str, const char* beginning_of_line){
-     static const char* keywords[] = {
-          "boolean",
-          "byte",
-          "float",
-          "int",
-          "long",
-          "short",
-          "void",
-     };
-
-     static const int64_t keyword_count = sizeof(keywords) / sizeof(keywords[0]);
-
-     return match_words(str, beginning_of_line, keywords, keyword_count);
-}
-
-static int64_t match_java_keyword(const char* str, const char* beginning_of_line){
-     static const char* keywords[] = {
-          "abstract",
-          "for",
-          "new",
-          "switch",
-          "assert",
-          "default",
-          "package",
-          "synchronized",
-          "do",
-          "if",
-          "private",
-          "this",
-          "double",
-          "implements",
-          "protected",
-          "else",
-          "import",
-          "public",
-          "case",
-          "enum",
-          "instanceof",
-          "transient",
-          "extends",
-          "char",
-          "final",
-          "interface",
-          "static",
-          "class",
-          "strictfp",
-          "volatile",
-          "native",
-          "super",
-          "while",
-     };
-
-     static const int64_t keyword_count = sizeof(keywords) / sizeof(keywords[0]);
-
-     return match_words(str, beginning_of_line, keywords, keyword_count);
-}
-
-static int64_t match_java_control(const char* str, const char* beginning_of_line){
-     static const char* keywords [] = {
-          "try",
-          "continue",
-          "goto",
-          "break",
-          "throw",
-          "throws",
-          "return",
-          "catch",
-          "finally",
-          "const",
-
-
-          "yield",
-          "break",
-          "except",
-          "raise",
-          "continue",
-          "finally",
-          "return",
-          "try",
-     };
-
-     static const int64_t keyword_count = sizeof(keywords) / sizeof(keywords[0]);
-
-     return match_words(str, beginning_of_line, keywords, keyword_count);
+#define SYNTAX_SPAN_CACHE_SIZE 4096      // lines kept, the least recently used is replaced when it is full
+#define SYNTAX_SPAN_CACHE_HASH_SIZE 8192 // power of 2, twice the entries so chains stay short
+#define SYNTAX_SPAN_CACHE_NONE -1
+
+typedef struct{
+     uint64_t hash;               // of the line's bytes
+     int64_t line_len;
+     const SyntaxLexer_t* lexer;
+     int32_t start_state;
+     int32_t end_state;
+     CeBufferToken_t* tokens;
+     int32_t token_count;
+     int32_t hash_next;
+     int32_t lru_prev;
+     int32_t lru_next;
+}SyntaxSpanCacheEntry_t;
+
+// tokens for recently lexed lines keyed by their contents and the state they start in, so lines that are lexed again
+// after an edit moves the states around, an undo or a reload, or that repeat in the file, are copied instead of lexed
+typedef struct{
+     SyntaxSpanCacheEntry_t entries[SYNTAX_SPAN_CACHE_SIZE];
+     int32_t hash_table[SYNTAX_SPAN_CACHE_HASH_SIZE];
+     int32_t count;
+     int32_t lru_head; // most recently used
+     int32_t lru_tail;
+     CeSyntaxCacheStats_t stats;
+}SyntaxSpanCache_t;
+
+static SyntaxSpanCache_t g_span_cache = {.lru_head = SYNTAX_SPAN_CACHE_NONE, .lru_tail = SYNTAX_SPAN_CACHE_NONE};
+static pthread_mutex_t g_span_cache_lock = PTHREAD_MUTEX_INITIALIZER; // shared by every thread highlighting views
+
+static uint64_t syntax_hash_line(const char* line, int64_t len){
+     uint64_t hash = 14695981039346656037ULL;
+     for(int64_t i = 0; i < len; i++){
+          hash ^= (unsigned char)(line[i]);
+          hash *= 1099511628211ULL;
+     }
+     return hash;
 }
 
-void ce_syntax_highlight_java(CeView_t* view, CeRangeList_t* highlight_range_list, CeDrawColorList_t* draw_color_list,
-                              CeSyntaxDef_t* syntax_defs, void* user_data){
-     if(!view->buffer) return;
-     if(view->buffer->line_count <= 0) return;
-     int64_t min = view->scroll.y;
-     int64_t max = min + (view->rect.bottom - view->rect.top);
-     int64_t clamp_max = (view->buffer->line_count - 1);
-     if(clamp_max < 0) clamp_max = 0;
-     CE_CLAMP(min, 0, clamp_max);
-     CE_CLAMP(max, 0, clamp_max);
-     int64_t match_len = 0;
-     bool multiline_comment = false;
-     bool in_visual = false;
-     CeRangeNode_t* range_node = highlight_range_list->head;
+static int32_t* syntax_span_cache_bucket(const SyntaxLexer_t* lexer, uint64_t hash, int32_t start_state){
+     uint64_t key = hash ^ ((uint64_t)(uintptr_t)(lexer) * 31) ^ (uint64_t)(start_state);
+     return g_span_cache.hash_table + (key & (SYNTAX_SPAN_CACHE_HASH_SIZE - 1));
+}
 
-     check_visual_start(range_node, min, draw_color_list, syntax_defs, &in_visual);
+static void syntax_span_cache_lru_unlink(int32_t index){
+     SyntaxSpanCacheEntry_t* entry = g_span_cache.entries + index;
+     if(entry->lru_prev != SYNTAX_SPAN_CACHE_NONE){
+          g_span_cache.entries[entry->lru_prev].lru_next = entry->lru_next;
+     }else{
+          g_span_cache.lru_head = entry->lru_next;
+     }
+     if(entry->lru_next != SYNTAX_SPAN_CACHE_NONE){
+          g_span_cache.entries[entry->lru_next].lru_prev = entry->lru_prev;
+     }else{
+          g_span_cache.lru_tail = entry->lru_prev;
+     }
+}
 
-     for(int64_t y = min; y <= max; ++y){
-          char* line = view->buffer->lines[y];
-          int64_t line_len = ce_utf8_strlen(line);
-          int64_t current_match_len = 1;
-          CePoint_t match_point = {0, y};
+static void syntax_span_cache_lru_push(int32_t index){
+     SyntaxSpanCacheEntry_t* entry = g_span_cache.entries + index;
+     entry->lru_prev = SYNTAX_SPAN_CACHE_NONE;
+     entry->lru_next = g_span_cache.lru_head;
+     if(g_span_cache.lru_head != SYNTAX_SPAN_CACHE_NONE) g_span_cache.entries[g_span_cache.lru_head].lru_prev = index;
+     g_span_cache.lru_head = index;
+     if(g_span_cache.lru_tail == SYNTAX_SPAN_CACHE_NONE) g_span_cache.lru_tail = index;
+}
 
-          if(multiline_comment){
-               change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_COMMENT, match_point);
+static SyntaxSpanCacheEntry_t* syntax_span_cache_find(const SyntaxLexer_t* lexer, uint64_t hash, int64_t line_len,
+                                                      int32_t start_state){
+     if(g_span_cache.count == 0) return NULL;
+     int32_t index = *syntax_span_cache_bucket(lexer, hash, start_state);
+     while(index != SYNTAX_SPAN_CACHE_NONE){
+          SyntaxSpanCacheEntry_t* entry = g_span_cache.entries + index;
+          if(entry->hash == hash && entry->line_len == line_len && entry->lexer == lexer && entry->start_state == start_state){
+               syntax_span_cache_lru_unlink(index);
+               syntax_span_cache_lru_push(index);
+               return entry;
           }
+          index = entry->hash_next;
+     }
+     return NULL;
+}
 
-          ce_syntax_highlight_visual(&range_node, &in_visual, match_point, draw_color_list, syntax_defs);
-
-          if(in_visual && line_len == 0) change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_VISUAL, match_point);
-
-          for(int64_t x = 0; x < line_len; ++x){
-               char* str = ce_utf8_iterate_to(line, x);
-               match_point.x = x;
+static void syntax_span_cache_insert(const SyntaxLexer_t* lexer, uint64_t hash, int64_t line_len,
+                                     const CeBufferLineTokens_t* line_tokens, int32_t end_state){
+     if(g_span_cache.count == 0){
+          for(int32_t i = 0; i < SYNTAX_SPAN_CACHE_HASH_SIZE; i++) g_span_cache.hash_table[i] = SYNTAX_SPAN_CACHE_NONE;
+     }
 
-               ce_syntax_highlight_visual(&range_node, &in_visual, match_point, draw_color_list, syntax_defs);
+     CeBufferToken_t* tokens = NULL;
+     if(line_tokens->count){
+          tokens = malloc(line_tokens->count * sizeof(*tokens));
+          if(!tokens) return;
+          memcpy(tokens, line_tokens->tokens, line_tokens->count * sizeof(*tokens));
+     }
 
-               if(current_match_len <= 1){
-                    if(multiline_comment){
-                         if((match_len = match_c_multiline_comment_end(str))){
-                              multiline_comment = false;
-                         }
-                    }else{
-                         if((match_len = match_java_type(str, line))){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_TYPE, match_point);
-                         }else if((match_len = match_java_keyword(str, line))){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_KEYWORD, match_point);
-                         }else if((match_len = match_java_control(str, line))){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_CONTROL, match_point);
-                         }else if((match_len = match_caps_var(str, line))){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_CAPS_VAR, match_point);
-                         }else if((match_len = match_c_comment(str))){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_COMMENT, match_point);
-                         }else if((match_len = match_c_string(str))){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_STRING, match_point);
-                         }else if((match_len = match_c_character_literal(str))){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_CHAR_LITERAL, match_point);
-                         }else if((match_len = match_c_literal(str, line))){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_NUMBER_LITERAL, match_point);
-                         }else if((match_len = match_c_multiline_comment(str))){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_COMMENT, match_point);
-                              multiline_comment = true;
-                         }else if(((view->cursor.y != y) || (x > view->cursor.x)) && (match_len = match_trailing_whitespace(str))){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_TRAILING_WHITESPACE, match_point);
-                              ce_draw_color_list_insert(draw_color_list, ce_syntax_def_get_fg(syntax_defs, CE_SYNTAX_COLOR_NORMAL, COLOR_DEFAULT),
-                                                        ce_syntax_def_get_bg(syntax_defs, CE_SYNTAX_COLOR_NORMAL, COLOR_DEFAULT),
-                                                        (CePoint_t){0, match_point.y + 1});
-                         }else if(!draw_color_list->tail || (draw_color_list->tail->fg != COLOR_DEFAULT || draw_color_list->tail->bg != COLOR_DEFAULT)){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_NORMAL, match_point);
-                         }
-                    }
+     int32_t index;
+     if(g_span_cache.count < SYNTAX_SPAN_CACHE_SIZE){
+          index = g_span_cache.count++;
+     }else{
+          // replace the least recently used entry
+          index = g_span_cache.lru_tail;
+          SyntaxSpanCacheEntry_t* evicted = g_span_cache.entries + index;
+          int32_t* link = syntax_span_cache_bucket(evicted->lexer, evicted->hash, evicted->start_state);
+          while(*link != index) link = &g_span_cache.entries[*link].hash_next;
+          *link = evicted->hash_next;
+          syntax_span_cache_lru_unlink(index);
+          free(evicted->tokens);
+          g_span_cache.stats.evictions++;
+     }
 
-                    if(match_len) current_match_len = match_len;
-               }else{
-                    current_match_len--;
-               }
+     int32_t* bucket = syntax_span_cache_bucket(lexer, hash, line_tokens->start_state);
+     g_span_cache.entries[index] = (SyntaxSpanCacheEntry_t){
+          .hash = hash,
+          .line_len = line_len,
+          .lexer = lexer,
+          .start_state = line_tokens->start_state,
+          .end_state = end_state,
+          .tokens = tokens,
+          .token_count = line_tokens->count,
+          .hash_next = *bucket,
+     };
+     *bucket = index;
+     syntax_span_cache_lru_push(index);
+}
 
-               if(in_visual) change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_VISUAL, match_point);
+// like syntax_tokenize_line(), but copies the tokens out of the span cache when the line has been lexed before, the
+// cache is only locked while looking up and inserting so lexing a miss doesn't hold up other threads
+static int32_t syntax_tokenize_line_cached(SyntaxLexer_t* lexer, const char* line, CeBufferLineTokens_t* line_tokens){
+     int64_t line_len = strlen(line);
+     uint64_t hash = syntax_hash_line(line, line_len);
+     pthread_mutex_lock(&g_span_cache_lock);
+     SyntaxSpanCacheEntry_t* entry = syntax_span_cache_find(lexer, hash, line_len, line_tokens->start_state);
+     if(entry && entry->token_count > line_tokens->capacity){
+          CeBufferToken_t* new_tokens = realloc(line_tokens->tokens, entry->token_count * sizeof(*new_tokens));
+          if(new_tokens){
+               line_tokens->tokens = new_tokens;
+               line_tokens->capacity = entry->token_count;
+          }else{
+               entry = NULL;
           }
+     }
 
-          check_visual_mode_end(range_node, &in_visual, match_point.y, line_len, draw_color_list);
+     if(entry){
+          g_span_cache.stats.hits++;
+          if(entry->token_count) memcpy(line_tokens->tokens, entry->tokens, entry->token_count * sizeof(*entry->tokens));
+          line_tokens->count = entry->token_count;
+          int32_t end_state = entry->end_state;
+          pthread_mutex_unlock(&g_span_cache_lock);
+          return end_state;
      }
-}
 
-static int64_t match_python_keyword(const char* str, const char* beginning_of_line){
-     static const char* keywords[] = {
-          "and",
-          "del",
-          "from",
-          "not",
-          "while",
-          "as",
-          "elif",
-          "global",
-          "or",
-          "with",
-          "assert",
-          "else",
-          "if",
-          "pass",
-          "import",
-          "print",
-          "class",
-          "exec",
-          "in",
-          "finally",
-          "is",
-          "def",
-          "for",
-          "lambda",
-          "self",
-     };
+     g_span_cache.stats.misses++;
+     pthread_mutex_unlock(&g_span_cache_lock);
 
-     static const int64_t keyword_count = sizeof(keywords) / sizeof(keywords[0]);
+     int32_t end_state = syntax_tokenize_line(lexer, line, line_tokens);
 
-     return match_words(str, beginning_of_line, keywords, keyword_count);
+     pthread_mutex_lock(&g_span_cache_lock);
+     syntax_span_cache_insert(lexer, hash, line_len, line_tokens, end_state);
+     pthread_mutex_unlock(&g_span_cache_lock);
+     return end_state;
 }
 
-static int64_t match_python_control(const char* str, const char* beginning_of_line){
-     static const char* keywords[] = {
-          "yield",
-          "break",
-          "except",
-          "raise",
-          "continue",
-          "finally",
-          "return",
-          "try",
-     };
+// start over if the tokens were made by another lexer or the buffer's lines changed without telling us
+static bool syntax_tokens_match_buffer(CeBufferTokens_t* tokens, CeBuffer_t* buffer, SyntaxLexer_t* lexer){
+     if(tokens->owner == (const void*)(lexer) && tokens->count == buffer->line_count) return true;
 
-     static const int64_t keyword_count = sizeof(keywords) / sizeof(keywords[0]);
+     if(buffer->line_count > tokens->capacity){
+          CeBufferLineTokens_t* new_lines = realloc(tokens->lines, buffer->line_count * sizeof(*new_lines));
+          if(!new_lines) return false;
+          tokens->lines = new_lines;
+          tokens->capacity = buffer->line_count;
+     }
 
-     return match_words(str, beginning_of_line, keywords, keyword_count);
-}
+     for(int64_t i = buffer->line_count; i < tokens->count; i++){
+          free(tokens->lines[i].tokens);
+     }
+     for(int64_t i = tokens->count; i < buffer->line_count; i++){
+          tokens->lines[i] = (CeBufferLineTokens_t){};
+     }
 
-static int64_t match_python_comment(const char* str){
-     if(*str == '#') return ce_utf8_strlen(str);
+     tokens->owner = (const void*)(lexer);
+     tokens->count = buffer->line_count;
+     tokens->valid_count = 0;
+     tokens->dirty_end = tokens->count;
+     return true;
+}
 
-     return 0;
+static void syntax_tokens_free(CeBufferTokens_t* tokens){
+     for(int64_t i = 0; i < tokens->count; i++) free(tokens->lines[i].tokens);
+     free(tokens->lines);
+     memset(tokens, 0, sizeof(*tokens));
 }
 
-static int64_t match_python_string(const char* str){
-     if(*str == '\'' || *str == '"'){
-          const char* match = str;
-          while(match){
-               match = strchr(match + 1, *str);
-               if(match && *(match - 1) != '\\'){
-                    return ce_utf8_strlen_between(str, match);
-               }
+// lexes lines until the tokens are up to date through last_line or max_lines have been lexed, returns how many were lexed
+static int64_t syntax_tokens_update(CeBuffer_t* buffer, CeBufferTokens_t* tokens, SyntaxLexer_t* lexer, int64_t last_line,
+                                    int64_t max_lines){
+     if(!syntax_tokens_match_buffer(tokens, buffer, lexer)) return 0;
+     if(!__atomic_load_n(&lexer->compiled, __ATOMIC_ACQUIRE)) syntax_lexer_compile(lexer);
+     if(last_line >= tokens->count) last_line = tokens->count - 1;
+
+     if(tokens->valid_count == 0 && tokens->count > 0) tokens->lines[0].start_state = 0;
+
+     int64_t lexed = 0;
+     while(tokens->valid_count <= last_line && lexed < max_lines){
+          int64_t y = tokens->valid_count;
+          int32_t state = syntax_tokenize_line_cached(lexer, buffer->lines[y], tokens->lines + y);
+          lexed++;
+
+          int64_t next = y + 1;
+          if(next >= tokens->count){
+               tokens->valid_count = tokens->count;
+               tokens->dirty_end = tokens->count;
+          }else if(next >= tokens->dirty_end && tokens->lines[next].start_state == state){
+               // we are back in sync with the tokens from before the edit
+               tokens->valid_count = tokens->count;
+               tokens->dirty_end = tokens->count;
+          }else{
+               tokens->lines[next].start_state = state;
+               tokens->valid_count = next;
+               if(tokens->dirty_end <= next) tokens->dirty_end = next + 1;
           }
      }
 
-     return 0;
+     return lexed;
 }
 
-typedef enum{
-     PYTHON_DOCSTRING_NONE,
-     PYTHON_DOCSTRING_SINGLE_QUOTE,
-     PYTHON_DOCSTRING_DOUBLE_QUOTE,
-}PythonDocstring_t;
-
-static int64_t match_python_docstring(const char* str, PythonDocstring_t* python_docstring){
-     if(strncmp(str, "\"\"\"", 3) == 0){
-          *python_docstring = PYTHON_DOCSTRING_DOUBLE_QUOTE;
-          char* match = strstr(str, "\"\"\"");
-          if(match) return ce_utf8_strlen_between(str, match);
-          return ce_utf8_strlen(str);
+// lexes lines first through last from the default state into tokens, whose lines start at first
+static bool syntax_tokens_lex_window(CeBuffer_t* buffer, CeBufferTokens_t* tokens, SyntaxLexer_t* lexer, int64_t first,
+                                     int64_t last){
+     int64_t count = last - first + 1;
+     tokens->lines = calloc(count, sizeof(*tokens->lines));
+     if(!tokens->lines) return false;
+     if(!__atomic_load_n(&lexer->compiled, __ATOMIC_ACQUIRE)) syntax_lexer_compile(lexer);
+     tokens->count = count;
+     tokens->capacity = count;
+     tokens->owner = (const void*)(lexer);
+
+     int32_t state = 0;
+     for(int64_t i = 0; i < count; i++){
+          tokens->lines[i].start_state = state;
+          state = syntax_tokenize_line_cached(lexer, buffer->lines[first + i], tokens->lines + i);
      }
+     tokens->valid_count = count;
+     tokens->dirty_end = count;
+     return true;
+}
 
-     if(strncmp(str, "'''", 3) == 0){
-          *python_docstring = PYTHON_DOCSTRING_SINGLE_QUOTE;
-          char* match = strstr(str, "'''");
-          if(match) return ce_utf8_strlen_between(str, match);
-          return ce_utf8_strlen(str);
+// returns the tokens for lines first through last, indexed from first. they come from the buffer's tokens if lexing at
+// most max_lines brings them up to date, otherwise the lines are lexed into private_tokens, which the caller frees,
+// starting CE_SYNTAX_LOOK_BACK_LINES above first. buffers another thread writes always lex into private_tokens
+static const CeBufferLineTokens_t* syntax_tokens_range(CeBuffer_t* buffer, SyntaxLexer_t* lexer, int64_t first, int64_t last,
+                                                       int64_t max_lines, CeBufferTokens_t* private_tokens){
+     if(!buffer->no_token_cache){
+          syntax_tokens_update(buffer, &buffer->tokens, lexer, last, max_lines);
+          if(buffer->tokens.valid_count > last) return buffer->tokens.lines + first;
      }
 
-     return 0;
+     int64_t window_first = first - CE_SYNTAX_LOOK_BACK_LINES;
+     if(window_first < 0) window_first = 0;
+     if(!syntax_tokens_lex_window(buffer, private_tokens, lexer, window_first, last)) return NULL;
+     return private_tokens->lines + (first - window_first);
 }
 
-void ce_syntax_highlight_python(CeView_t* view, CeRangeList_t* highlight_range_list, CeDrawColorList_t* draw_color_list,
-                                CeSyntaxDef_t* syntax_defs, void* user_data){
-     if(!view->buffer) return;
-     if(view->buffer->line_count <= 0) return;
+static void syntax_highlight_lexer_tokens(CeView_t* view, CeRangeList_t* highlight_range_list, CeDrawColorList_t* draw_color_list,
+                                          CeSyntaxDef_t* syntax_defs, SyntaxLexer_t* lexer, CeBufferTokens_t* private_tokens){
      int64_t min = view->scroll.y;
      int64_t max = min + (view->rect.bottom - view->rect.top);
      int64_t clamp_max = (view->buffer->line_count - 1);
@@ -1123,99 +1023,52 @@ void ce_syntax_highlight_python(CeView_t* view, CeRangeList_t* highlight_range_l
      CE_CLAMP(max, 0, clamp_max);
      int64_t match_len = 0;
      bool in_visual = false;
-     PythonDocstring_t docstring = PYTHON_DOCSTRING_NONE;
      CeRangeNode_t* range_node = highlight_range_list->head;
 
-     check_visual_start(range_node, min, draw_color_list, syntax_defs, &in_visual);
-
-     int prepass_min = min - SEARCH_BACK_LINES;
-     if(prepass_min < 0) prepass_min = 0;
+     const CeBufferLineTokens_t* tokens = syntax_tokens_range(view->buffer, lexer, min, max, CE_SYNTAX_DRAW_LEX_LINES,
+                                                              private_tokens);
+     if(!tokens) return;
 
-     // pre-pass to check if we are in a multiline comment
-     for(int64_t y = prepass_min; y < min; y++){
-          char* line = view->buffer->lines[y];
-          int64_t line_len = ce_utf8_strlen(line);
-
-          for(int64_t x = 0; x < line_len; ++x){
-               char* str = ce_utf8_iterate_to(line, x);
-
-               switch(docstring){
-               default:
-                    if((match_len = match_python_docstring(str, &docstring))){
-                         x += match_len;
-                    }
-                    break;
-               case PYTHON_DOCSTRING_DOUBLE_QUOTE:
-                    if(strncmp(str, "\"\"\"", 3) == 0){
-                         docstring = PYTHON_DOCSTRING_NONE;
-                         x += 3;
-                    }else if(match_len == 0){
-                         docstring = PYTHON_DOCSTRING_NONE;
-                    }
-                    break;
-               case PYTHON_DOCSTRING_SINGLE_QUOTE:
-                    if(strncmp(str, "'''", 3) == 0){
-                         docstring = PYTHON_DOCSTRING_NONE;
-                         x += 3;
-                    }else if(match_len == 0){
-                         docstring = PYTHON_DOCSTRING_NONE;
-                    }
-                    break;
-               }
-          }
-     }
+     check_visual_start(range_node, min, draw_color_list, syntax_defs, &in_visual);
 
      for(int64_t y = min; y <= max; ++y){
           char* line = view->buffer->lines[y];
-          int64_t line_len = ce_utf8_strlen(line);
+          SyntaxCursor_t line_cursor = syntax_cursor_begin(line);
+          int64_t line_len = line_cursor.len;
           int64_t current_match_len = 1;
           CePoint_t match_point = {0, y};
+          const CeBufferLineTokens_t* line_tokens = tokens + (y - min);
+          int32_t token_index = 0;
 
-          if(docstring){
-               change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_STRING, match_point);
+          int32_t state = line_tokens->start_state;
+          if(state){
+               change_draw_color(draw_color_list, syntax_defs, lexer->rules[state - 1].color, match_point);
           }
 
           ce_syntax_highlight_visual(&range_node, &in_visual, match_point, draw_color_list, syntax_defs);
 
           if(in_visual && line_len == 0) change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_VISUAL, match_point);
 
-          for(int64_t x = 0; x < line_len; ++x){
-               char* str = ce_utf8_iterate_to(line, x);
+          for(; line_cursor.x < line_len; syntax_cursor_next(&line_cursor)){
+               int64_t x = line_cursor.x;
                match_point.x = x;
 
                ce_syntax_highlight_visual(&range_node, &in_visual, match_point, draw_color_list, syntax_defs);
 
                if(current_match_len <= 1){
-                    if(docstring){
-                         if(docstring == PYTHON_DOCSTRING_DOUBLE_QUOTE && strncmp(str, "\"\"\"", 3) == 0){
-                              docstring = PYTHON_DOCSTRING_NONE;
-                              match_len = 3;
-                         }else if(docstring == PYTHON_DOCSTRING_SINGLE_QUOTE && strncmp(str, "'''", 3) == 0){
-                              docstring = PYTHON_DOCSTRING_NONE;
-                              match_len = 3;
-                         }
+                    if(!view->buffer->no_trailing_whitespace && ((view->cursor.y != y) || (x > view->cursor.x)) &&
+                       (match_len = match_trailing_whitespace(&line_cursor))){
+                         change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_TRAILING_WHITESPACE, match_point);
+                         ce_draw_color_list_insert(draw_color_list, ce_syntax_def_get_fg(syntax_defs, CE_SYNTAX_COLOR_NORMAL, COLOR_DEFAULT),
+                                                   ce_syntax_def_get_bg(syntax_defs, CE_SYNTAX_COLOR_NORMAL, COLOR_DEFAULT),
+                                                   (CePoint_t){0, match_point.y + 1});
                     }else{
-                         if((match_len = match_c_type(str, line))){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_TYPE, match_point);
-                         }else if((match_len = match_python_keyword(str, line))){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_KEYWORD, match_point);
-                         }else if((match_len = match_python_control(str, line))){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_CONTROL, match_point);
-                         }else if((match_len = match_caps_var(str, line))){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_CAPS_VAR, match_point);
-                         }else if((match_len = match_python_comment(str))){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_COMMENT, match_point);
-                         }else if((match_len = match_python_docstring(str, &docstring))){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_STRING, match_point);
-                         }else if((match_len = match_python_string(str))){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_STRING, match_point);
-                         }else if((match_len = match_c_literal(str, line))){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_NUMBER_LITERAL, match_point);
-                         }else if(((view->cursor.y != y) || (x > view->cursor.x)) && (match_len = match_trailing_whitespace(str))){
-                              change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_TRAILING_WHITESPACE, match_point);
-                              ce_draw_color_list_insert(draw_color_list, ce_syntax_def_get_fg(syntax_defs, CE_SYNTAX_COLOR_NORMAL, COLOR_DEFAULT),
-                                                        ce_syntax_def_get_bg(syntax_defs, CE_SYNTAX_COLOR_NORMAL, COLOR_DEFAULT),
-                                                        (CePoint_t){0, match_point.y + 1});
+                         while(token_index < line_tokens->count && line_tokens->tokens[token_index].start < x) token_index++;
+                         match_len = 0;
+                         if(token_index < line_tokens->count && line_tokens->tokens[token_index].start == x){
+                              const CeBufferToken_t* token = line_tokens->tokens + token_index;
+                              match_len = token->len;
+                              change_draw_color(draw_color_list, syntax_defs, token->syntax_class, match_point);
                          }else if(!draw_color_list->tail || (draw_color_list->tail->fg != COLOR_DEFAULT || draw_color_list->tail->bg != COLOR_DEFAULT)){
                               change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_NORMAL, match_point);
                          }
@@ -1233,169 +1086,648 @@ void ce_syntax_highlight_python(CeView_t* view, CeRangeList_t* highlight_range_l
      }
 }
 
-static int64_t match_bash_keyword(const char* str, const char* beginning_of_line){
-     static const char* keywords [] = {
-          "if",
-          "then",
-          "else",
-          "elif",
-          "fi",
-          "case",
-          "esac",
-          "for",
-          "select",
-          "while",
-          "until",
-          "do",
-          "done",
-          "in",
-          "function",
-          "time",
-          "coproc",
-     };
-
-     static const int64_t keyword_count = sizeof(keywords) / sizeof(keywords[0]);
-
-     return match_words(str, beginning_of_line, keywords, keyword_count);
-}
-
-void ce_syntax_highlight_bash(CeView_t* view, CeRangeList_t* highlight_range_list, CeDrawColorList_t* draw_color_list,
-                              CeSyntaxDef_t* syntax_defs, void* user_data){
+static void syntax_highlight_lexer(CeView_t* view, CeRangeList_t* highlight_range_list, CeDrawColorList_t* draw_color_list,
+                                   CeSyntaxDef_t* syntax_defs, SyntaxLexer_t* lexer){
      if(!view->buffer) return;
      if(view->buffer->line_count <= 0) return;
-     int64_t min = view->scroll.y;
-     int64_t max = min + (view->rect.bottom - view->rect.top);
-     int64_t clamp_max = (view->buffer->line_count - 1);
-     if(clamp_max < 0) clamp_max = 0;
-     CE_CLAMP(min, 0, clamp_max);
-     CE_CLAMP(max, 0, clamp_max);
-     int64_t match_len = 0;
-     bool in_visual = false;
-     CeRangeNode_t* range_node = highlight_range_list->head;
-
-     check_visual_start(range_node, min, draw_color_list, syntax_defs, &in_visual);
-
-     for(int64_t y = min; y <= max; ++y){
-          char* line = view->buffer->lines[y];
-          int64_t line_len = ce_utf8_strlen(line);
-          int64_t current_match_len = 1;
-          CePoint_t match_point = {0, y};
+     CeBufferTokens_t private_tokens = {};
+     syntax_highlight_lexer_tokens(view, highlight_range_list, draw_color_list, syntax_defs, lexer, &private_tokens);
+     syntax_tokens_free(&private_tokens);
+}
 
-          ce_syntax_highlight_visual(&range_node, &in_visual, match_point, draw_color_list, syntax_defs);
+static const SyntaxKeyword_t c_keywords[] = {
+     SYNTAX_KEYWORD("S8", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("U8", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("do", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("if", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("F32", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("F64", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("S16", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("S32", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("S64", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("U16", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("U32", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("U64", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("for", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("int", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("auto", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("bool", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("case", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("char", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("else", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("enum", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("goto", CE_SYNTAX_COLOR_CONTROL),
+     SYNTAX_KEYWORD("long", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("true", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("void", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("break", CE_SYNTAX_COLOR_CONTROL),
+     SYNTAX_KEYWORD("const", CE_SYNTAX_COLOR_CONTROL),
+     SYNTAX_KEYWORD("false", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("float", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("short", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("union", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("while", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("double", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("extern", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("inline", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("return", CE_SYNTAX_COLOR_CONTROL),
+     SYNTAX_KEYWORD("signed", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("sizeof", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("static", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("struct", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("switch", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("typeof", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("default", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("typedef", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("__thread", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("continue", CE_SYNTAX_COLOR_CONTROL),
+     SYNTAX_KEYWORD("register", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("unsigned", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("volatile", CE_SYNTAX_COLOR_KEYWORD),
+};
+
+static const SyntaxKeyword_t cpp_keywords[] = {
+     SYNTAX_KEYWORD("S8", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("U8", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("do", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("if", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("Asm", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("F32", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("F64", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("S16", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("S32", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("S64", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("U16", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("U32", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("U64", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("for", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("int", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("new", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("try", CE_SYNTAX_COLOR_CONTROL),
+     SYNTAX_KEYWORD("auto", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("bool", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("case", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("char", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("else", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("enum", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("goto", CE_SYNTAX_COLOR_CONTROL),
+     SYNTAX_KEYWORD("long", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("this", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("true", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("void", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("break", CE_SYNTAX_COLOR_CONTROL),
+     SYNTAX_KEYWORD("catch", CE_SYNTAX_COLOR_CONTROL),
+     SYNTAX_KEYWORD("class", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("const", CE_SYNTAX_COLOR_CONTROL),
+     SYNTAX_KEYWORD("false", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("float", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("short", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("throw", CE_SYNTAX_COLOR_CONTROL),
+     SYNTAX_KEYWORD("union", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("using", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("while", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("delete", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("double", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("extern", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("friend", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("inline", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("public", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("return", CE_SYNTAX_COLOR_CONTROL),
+     SYNTAX_KEYWORD("signed", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("sizeof", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("static", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("struct", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("switch", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("typeid", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("default", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("mutable", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("nullptr", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("private", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("typedef", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("virtual", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("wchar_t", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("continue", CE_SYNTAX_COLOR_CONTROL),
+     SYNTAX_KEYWORD("operator", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("register", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("template", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("typename", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("unsigned", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("volatile", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("namespace", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("protected", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("const_cast", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("static_cast", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("dynamic_cast", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("reinterpret_cast", CE_SYNTAX_COLOR_KEYWORD),
+};
+
+static const SyntaxKeyword_t java_keywords[] = {
+     SYNTAX_KEYWORD("do", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("if", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("for", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("int", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("new", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("try", CE_SYNTAX_COLOR_CONTROL),
+     SYNTAX_KEYWORD("byte", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("case", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("char", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("else", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("enum", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("goto", CE_SYNTAX_COLOR_CONTROL),
+     SYNTAX_KEYWORD("long", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("this", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("void", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("break", CE_SYNTAX_COLOR_CONTROL),
+     SYNTAX_KEYWORD("catch", CE_SYNTAX_COLOR_CONTROL),
+     SYNTAX_KEYWORD("class", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("const", CE_SYNTAX_COLOR_CONTROL),
+     SYNTAX_KEYWORD("final", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("float", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("raise", CE_SYNTAX_COLOR_CONTROL),
+     SYNTAX_KEYWORD("short", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("super", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("throw", CE_SYNTAX_COLOR_CONTROL),
+     SYNTAX_KEYWORD("while", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("yield", CE_SYNTAX_COLOR_CONTROL),
+     SYNTAX_KEYWORD("assert", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("double", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("except", CE_SYNTAX_COLOR_CONTROL),
+     SYNTAX_KEYWORD("import", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("native", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("public", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("return", CE_SYNTAX_COLOR_CONTROL),
+     SYNTAX_KEYWORD("static", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("switch", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("throws", CE_SYNTAX_COLOR_CONTROL),
+     SYNTAX_KEYWORD("boolean", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("default", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("extends", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("finally", CE_SYNTAX_COLOR_CONTROL),
+     SYNTAX_KEYWORD("package", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("private", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("abstract", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("continue", CE_SYNTAX_COLOR_CONTROL),
+     SYNTAX_KEYWORD("strictfp", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("volatile", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("interface", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("protected", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("transient", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("implements", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("instanceof", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("synchronized", CE_SYNTAX_COLOR_KEYWORD),
+};
+
+static const SyntaxKeyword_t python_keywords[] = {
+     SYNTAX_KEYWORD("S8", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("U8", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("as", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("if", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("in", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("is", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("or", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("F32", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("F64", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("S16", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("S32", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("S64", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("U16", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("U32", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("U64", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("and", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("def", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("del", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("for", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("int", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("not", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("try", CE_SYNTAX_COLOR_CONTROL),
+     SYNTAX_KEYWORD("bool", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("char", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("elif", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("else", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("exec", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("from", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("long", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("pass", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("self", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("void", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("with", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("break", CE_SYNTAX_COLOR_CONTROL),
+     SYNTAX_KEYWORD("class", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("float", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("print", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("raise", CE_SYNTAX_COLOR_CONTROL),
+     SYNTAX_KEYWORD("short", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("while", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("yield", CE_SYNTAX_COLOR_CONTROL),
+     SYNTAX_KEYWORD("assert", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("double", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("except", CE_SYNTAX_COLOR_CONTROL),
+     SYNTAX_KEYWORD("global", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("import", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("lambda", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("return", CE_SYNTAX_COLOR_CONTROL),
+     SYNTAX_KEYWORD("signed", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("finally", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("continue", CE_SYNTAX_COLOR_CONTROL),
+     SYNTAX_KEYWORD("unsigned", CE_SYNTAX_COLOR_TYPE),
+};
+
+static const SyntaxKeyword_t bash_keywords[] = {
+     SYNTAX_KEYWORD("do", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("fi", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("if", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("in", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("for", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("case", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("done", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("elif", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("else", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("esac", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("then", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("time", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("until", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("while", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("coproc", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("select", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("function", CE_SYNTAX_COLOR_KEYWORD),
+};
+
+static const SyntaxKeyword_t config_keywords[] = {
+     SYNTAX_KEYWORD("true", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("false", CE_SYNTAX_COLOR_KEYWORD),
+};
+
+static const SyntaxKeyword_t rust_keywords[] = {
+     SYNTAX_KEYWORD("as", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("fn", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("i8", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("if", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("in", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("u8", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("Box", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("Vec", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("dyn", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("f32", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("f64", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("for", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("i16", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("i32", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("i64", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("let", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("mod", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("mut", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("pub", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("ref", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("str", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("u16", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("u32", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("u64", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("use", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("Self", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("bool", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("char", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("else", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("enum", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("i128", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("impl", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("loop", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("move", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("self", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("true", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("type", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("u128", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("async", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("await", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("break", CE_SYNTAX_COLOR_CONTROL),
+     SYNTAX_KEYWORD("const", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("crate", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("false", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("isize", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("match", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("super", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("trait", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("usize", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("where", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("while", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("Option", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("Result", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("String", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("extern", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("return", CE_SYNTAX_COLOR_CONTROL),
+     SYNTAX_KEYWORD("static", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("struct", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("unsafe", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("continue", CE_SYNTAX_COLOR_CONTROL),
+};
+
+static const SyntaxKeyword_t go_keywords[] = {
+     SYNTAX_KEYWORD("go", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("if", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("for", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("int", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("map", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("nil", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("var", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("bool", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("byte", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("case", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("chan", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("else", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("func", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("goto", CE_SYNTAX_COLOR_CONTROL),
+     SYNTAX_KEYWORD("int8", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("iota", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("rune", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("true", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("type", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("uint", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("break", CE_SYNTAX_COLOR_CONTROL),
+     SYNTAX_KEYWORD("const", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("defer", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("error", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("false", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("int16", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("int32", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("int64", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("range", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("uint8", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("import", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("return", CE_SYNTAX_COLOR_CONTROL),
+     SYNTAX_KEYWORD("select", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("string", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("struct", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("switch", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("uint16", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("uint32", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("uint64", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("default", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("float32", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("float64", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("package", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("uintptr", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("continue", CE_SYNTAX_COLOR_CONTROL),
+     SYNTAX_KEYWORD("complex64", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("interface", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("complex128", CE_SYNTAX_COLOR_TYPE),
+     SYNTAX_KEYWORD("fallthrough", CE_SYNTAX_COLOR_CONTROL),
+};
+
+static const SyntaxKeyword_t json_keywords[] = {
+     SYNTAX_KEYWORD("null", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("true", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("false", CE_SYNTAX_COLOR_KEYWORD),
+};
+
+static const SyntaxKeyword_t yaml_keywords[] = {
+     SYNTAX_KEYWORD("No", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("On", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("no", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("on", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("Off", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("Yes", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("off", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("yes", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("NULL", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("Null", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("TRUE", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("True", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("null", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("true", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("FALSE", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("False", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("false", CE_SYNTAX_COLOR_KEYWORD),
+};
+
+static const SyntaxKeyword_t makefile_keywords[] = {
+     SYNTAX_KEYWORD("else", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("ifeq", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("endef", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("endif", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("ifdef", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("ifneq", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("vpath", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("define", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("export", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("ifndef", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("include", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("override", CE_SYNTAX_COLOR_KEYWORD),
+     SYNTAX_KEYWORD("unexport", CE_SYNTAX_COLOR_KEYWORD),
+};
+
+static const SyntaxRule_t c_rules[] = {
+     {SYNTAX_RULE_LINE, "//", .color = CE_SYNTAX_COLOR_COMMENT},
+     {SYNTAX_RULE_REGION, "\"", "\"", '\\', .color = CE_SYNTAX_COLOR_STRING},
+     {SYNTAX_RULE_CHAR_LITERAL, "'", .color = CE_SYNTAX_COLOR_CHAR_LITERAL},
+     {SYNTAX_RULE_PREPROC, "#", .color = CE_SYNTAX_COLOR_PREPROCESSOR},
+     {SYNTAX_RULE_REGION, "/*", "*/", .multi_line = true, .color = CE_SYNTAX_COLOR_COMMENT},
+};
+
+static const SyntaxRule_t java_rules[] = {
+     {SYNTAX_RULE_LINE, "//", .color = CE_SYNTAX_COLOR_COMMENT},
+     {SYNTAX_RULE_REGION, "\"", "\"", '\\', .color = CE_SYNTAX_COLOR_STRING},
+     {SYNTAX_RULE_CHAR_LITERAL, "'", .color = CE_SYNTAX_COLOR_CHAR_LITERAL},
+     {SYNTAX_RULE_REGION, "/*", "*/", .multi_line = true, .color = CE_SYNTAX_COLOR_COMMENT},
+};
+
+static const SyntaxRule_t python_rules[] = {
+     {SYNTAX_RULE_LINE, "#", .color = CE_SYNTAX_COLOR_COMMENT},
+     {SYNTAX_RULE_REGION, "\"\"\"", "\"\"\"", .multi_line = true, .color = CE_SYNTAX_COLOR_STRING},
+     {SYNTAX_RULE_REGION, "'''", "'''", .multi_line = true, .color = CE_SYNTAX_COLOR_STRING},
+     {SYNTAX_RULE_REGION, "\"", "\"", '\\', .color = CE_SYNTAX_COLOR_STRING},
+     {SYNTAX_RULE_REGION, "'", "'", '\\', .color = CE_SYNTAX_COLOR_STRING},
+};
+
+static const SyntaxRule_t bash_rules[] = {
+     {SYNTAX_RULE_LINE, "#", .color = CE_SYNTAX_COLOR_COMMENT},
+     {SYNTAX_RULE_REGION, "\"", "\"", '\\', .color = CE_SYNTAX_COLOR_STRING},
+     {SYNTAX_RULE_REGION, "'", "'", .color = CE_SYNTAX_COLOR_STRING},
+};
+
+static const SyntaxRule_t rust_rules[] = {
+     {SYNTAX_RULE_LINE, "//", .color = CE_SYNTAX_COLOR_COMMENT},
+     {SYNTAX_RULE_REGION, "\"", "\"", '\\', .color = CE_SYNTAX_COLOR_STRING},
+     {SYNTAX_RULE_CHAR_LITERAL, "'", .color = CE_SYNTAX_COLOR_CHAR_LITERAL},
+     {SYNTAX_RULE_PREPROC, "#", .color = CE_SYNTAX_COLOR_PREPROCESSOR},
+     {SYNTAX_RULE_REGION, "/*", "*/", .multi_line = true, .color = CE_SYNTAX_COLOR_COMMENT},
+};
+
+static const SyntaxRule_t go_rules[] = {
+     {SYNTAX_RULE_LINE, "//", .color = CE_SYNTAX_COLOR_COMMENT},
+     {SYNTAX_RULE_REGION, "\"", "\"", '\\', .color = CE_SYNTAX_COLOR_STRING},
+     {SYNTAX_RULE_REGION, "`", "`", .multi_line = true, .color = CE_SYNTAX_COLOR_STRING},
+     {SYNTAX_RULE_CHAR_LITERAL, "'", .color = CE_SYNTAX_COLOR_CHAR_LITERAL},
+     {SYNTAX_RULE_REGION, "/*", "*/", .multi_line = true, .color = CE_SYNTAX_COLOR_COMMENT},
+};
+
+static const SyntaxRule_t json_rules[] = {
+     {SYNTAX_RULE_REGION, "\"", "\"", '\\', .color = CE_SYNTAX_COLOR_STRING},
+};
+
+static const SyntaxRule_t yaml_rules[] = {
+     {SYNTAX_RULE_LINE, "#", .color = CE_SYNTAX_COLOR_COMMENT},
+     {SYNTAX_RULE_REGION, "\"", "\"", '\\', .color = CE_SYNTAX_COLOR_STRING},
+     {SYNTAX_RULE_REGION, "'", "'", .color = CE_SYNTAX_COLOR_STRING},
+};
+
+static const SyntaxRule_t markdown_rules[] = {
+     {SYNTAX_RULE_LINE, "#", .line_start_only = true, .color = CE_SYNTAX_COLOR_KEYWORD},
+     {SYNTAX_RULE_LINE, ">", .line_start_only = true, .color = CE_SYNTAX_COLOR_COMMENT},
+     {SYNTAX_RULE_REGION, "```", "```", .multi_line = true, .color = CE_SYNTAX_COLOR_STRING},
+     {SYNTAX_RULE_REGION, "`", "`", .color = CE_SYNTAX_COLOR_STRING},
+     {SYNTAX_RULE_REGION, "**", "**", .color = CE_SYNTAX_COLOR_CONTROL},
+};
+
+static const SyntaxRule_t makefile_rules[] = {
+     {SYNTAX_RULE_LINE, "#", .color = CE_SYNTAX_COLOR_COMMENT},
+     {SYNTAX_RULE_REGION, "$(", ")", .color = CE_SYNTAX_COLOR_CAPS_VAR},
+     {SYNTAX_RULE_REGION, "${", "}", .color = CE_SYNTAX_COLOR_CAPS_VAR},
+     {SYNTAX_RULE_REGION, "\"", "\"", '\\', .color = CE_SYNTAX_COLOR_STRING},
+     {SYNTAX_RULE_REGION, "'", "'", .color = CE_SYNTAX_COLOR_STRING},
+};
+
+static SyntaxLexer_t g_c_lexer = {SYNTAX_LEXER(c_rules, c_keywords), .type_suffix = true, .caps_vars = true, .numbers = true};
+static SyntaxLexer_t g_cpp_lexer = {SYNTAX_LEXER(c_rules, cpp_keywords), .type_suffix = true, .caps_vars = true, .numbers = true};
+static SyntaxLexer_t g_java_lexer = {SYNTAX_LEXER(java_rules, java_keywords), .caps_vars = true, .numbers = true};
+static SyntaxLexer_t g_python_lexer = {SYNTAX_LEXER(python_rules, python_keywords), .type_suffix = true, .caps_vars = true, .numbers = true};
+static SyntaxLexer_t g_bash_lexer = {SYNTAX_LEXER(bash_rules, bash_keywords), .caps_vars = true, .numbers = true};
+static SyntaxLexer_t g_config_lexer = {SYNTAX_LEXER(bash_rules, config_keywords), .caps_vars = true, .numbers = true};
+static SyntaxLexer_t g_rust_lexer = {SYNTAX_LEXER(rust_rules, rust_keywords), .caps_vars = true, .numbers = true};
+static SyntaxLexer_t g_go_lexer = {SYNTAX_LEXER(go_rules, go_keywords), .numbers = true};
+static SyntaxLexer_t g_json_lexer = {SYNTAX_LEXER(json_rules, json_keywords), .numbers = true};
+static SyntaxLexer_t g_yaml_lexer = {SYNTAX_LEXER(yaml_rules, yaml_keywords), .numbers = true};
+static SyntaxLexer_t g_markdown_lexer = {.rules = markdown_rules, .rule_count = SYNTAX_ARRAY_COUNT(markdown_rules)};
+static SyntaxLexer_t g_makefile_lexer = {SYNTAX_LEXER(makefile_rules, makefile_keywords), .caps_vars = true};
 
-          if(in_visual && line_len == 0) change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_VISUAL, match_point);
-
-          for(int64_t x = 0; x < line_len; ++x){
-               char* str = ce_utf8_iterate_to(line, x);
-               match_point.x = x;
-
-               ce_syntax_highlight_visual(&range_node, &in_visual, match_point, draw_color_list, syntax_defs);
+void ce_syntax_highlight_c(CeView_t* view, CeRangeList_t* highlight_range_list, CeDrawColorList_t* draw_color_list,
+                           CeSyntaxDef_t* syntax_defs, void* user_data){
+     syntax_highlight_lexer(view, highlight_range_list, draw_color_list, syntax_defs, &g_c_lexer);
+}
 
-               if(current_match_len <= 1){
-                    if((match_len = match_bash_keyword(str, line))){
-                         change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_KEYWORD, match_point);
-                    }else if((match_len = match_caps_var(str, line))){
-                         change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_CAPS_VAR, match_point);
-                    }else if((match_len = match_python_comment(str))){
-                         change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_COMMENT, match_point);
-                    }else if((match_len = match_python_string(str))){
-                         change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_STRING, match_point);
-                    }else if((match_len = match_c_literal(str, line))){
-                         change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_NUMBER_LITERAL, match_point);
-                    }else if(((view->cursor.y != y) || (x > view->cursor.x)) && (match_len = match_trailing_whitespace(str))){
-                         change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_TRAILING_WHITESPACE, match_point);
-                         ce_draw_color_list_insert(draw_color_list, ce_syntax_def_get_fg(syntax_defs, CE_SYNTAX_COLOR_NORMAL, COLOR_DEFAULT),
-                                                   ce_syntax_def_get_bg(syntax_defs, CE_SYNTAX_COLOR_NORMAL, COLOR_DEFAULT),
-                                                   (CePoint_t){0, match_point.y + 1});
-                    }else if(!draw_color_list->tail || (draw_color_list->tail->fg != COLOR_DEFAULT || draw_color_list->tail->bg != COLOR_DEFAULT)){
-                         change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_NORMAL, match_point);
-                    }
+void ce_syntax_highlight_cpp(CeView_t* view, CeRangeList_t* highlight_range_list, CeDrawColorList_t* draw_color_list,
+                             CeSyntaxDef_t* syntax_defs, void* user_data){
+     syntax_highlight_lexer(view, highlight_range_list, draw_color_list, syntax_defs, &g_cpp_lexer);
+}
 
-                    if(match_len) current_match_len = match_len;
-               }else{
-                    current_match_len--;
-               }
+void ce_syntax_highlight_java(CeView_t* view, CeRangeList_t* highlight_range_list, CeDrawColorList_t* draw_color_list,
+                              CeSyntaxDef_t* syntax_defs, void* user_data){
+     syntax_highlight_lexer(view, highlight_range_list, draw_color_list, syntax_defs, &g_java_lexer);
+}
 
-               if(in_visual) change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_VISUAL, match_point);
-          }
+void ce_syntax_highlight_python(CeView_t* view, CeRangeList_t* highlight_range_list, CeDrawColorList_t* draw_color_list,
+                                CeSyntaxDef_t* syntax_defs, void* user_data){
+     syntax_highlight_lexer(view, highlight_range_list, draw_color_list, syntax_defs, &g_python_lexer);
+}
 
-          check_visual_mode_end(range_node, &in_visual, match_point.y, line_len, draw_color_list);
-     }
+void ce_syntax_highlight_bash(CeView_t* view, CeRangeList_t* highlight_range_list, CeDrawColorList_t* draw_color_list,
+                              CeSyntaxDef_t* syntax_defs, void* user_data){
+     syntax_highlight_lexer(view, highlight_range_list, draw_color_list, syntax_defs, &g_bash_lexer);
 }
 
-static int64_t match_config_keyword(const char* str, const char* beginning_of_line){
-     static const char* keywords [] = {
-          "true",
-          "false",
-     };
+void ce_syntax_highlight_config(CeView_t* view, CeRangeList_t* highlight_range_list, CeDrawColorList_t* draw_color_list,
+                                CeSyntaxDef_t* syntax_defs, void* user_data){
+     syntax_highlight_lexer(view, highlight_range_list, draw_color_list, syntax_defs, &g_config_lexer);
+}
 
-     static const int64_t keyword_count = sizeof(keywords) / sizeof(keywords[0]);
+void ce_syntax_highlight_rust(CeView_t* view, CeRangeList_t* highlight_range_list, CeDrawColorList_t* draw_color_list,
+                              CeSyntaxDef_t* syntax_defs, void* user_data){
+     syntax_highlight_lexer(view, highlight_range_list, draw_color_list, syntax_defs, &g_rust_lexer);
+}
 
-     return match_words(str, beginning_of_line, keywords, keyword_count);
+void ce_syntax_highlight_go(CeView_t* view, CeRangeList_t* highlight_range_list, CeDrawColorList_t* draw_color_list,
+                            CeSyntaxDef_t* syntax_defs, void* user_data){
+     syntax_highlight_lexer(view, highlight_range_list, draw_color_list, syntax_defs, &g_go_lexer);
 }
 
-void ce_syntax_highlight_config(CeView_t* view, CeRangeList_t* highlight_range_list, CeDrawColorList_t* draw_color_list,
-                                CeSyntaxDef_t* syntax_defs, void* user_data){
-     if(!view->buffer) return;
-     if(view->buffer->line_count <= 0) return;
-     int64_t min = view->scroll.y;
-     int64_t max = min + (view->rect.bottom - view->rect.top);
-     int64_t clamp_max = (view->buffer->line_count - 1);
-     if(clamp_max < 0) clamp_max = 0;
-     CE_CLAMP(min, 0, clamp_max);
-     CE_CLAMP(max, 0, clamp_max);
-     int64_t match_len = 0;
-     bool in_visual = false;
-     CeRangeNode_t* range_node = highlight_range_list->head;
+void ce_syntax_highlight_json(CeView_t* view, CeRangeList_t* highlight_range_list, CeDrawColorList_t* draw_color_list,
+                              CeSyntaxDef_t* syntax_defs, void* user_data){
+     syntax_highlight_lexer(view, highlight_range_list, draw_color_list, syntax_defs, &g_json_lexer);
+}
 
-     check_visual_start(range_node, min, draw_color_list, syntax_defs, &in_visual);
+void ce_syntax_highlight_yaml(CeView_t* view, CeRangeList_t* highlight_range_list, CeDrawColorList_t* draw_color_list,
+                              CeSyntaxDef_t* syntax_defs, void* user_data){
+     syntax_highlight_lexer(view, highlight_range_list, draw_color_list, syntax_defs, &g_yaml_lexer);
+}
 
-     for(int64_t y = min; y <= max; ++y){
-          char* line = view->buffer->lines[y];
-          int64_t line_len = ce_utf8_strlen(line);
-          int64_t current_match_len = 1;
-          CePoint_t match_point = {0, y};
+void ce_syntax_highlight_markdown(CeView_t* view, CeRangeList_t* highlight_range_list, CeDrawColorList_t* draw_color_list,
+                                  CeSyntaxDef_t* syntax_defs, void* user_data){
+     syntax_highlight_lexer(view, highlight_range_list, draw_color_list, syntax_defs, &g_markdown_lexer);
+}
 
-          ce_syntax_highlight_visual(&range_node, &in_visual, match_point, draw_color_list, syntax_defs);
+void ce_syntax_highlight_makefile(CeView_t* view, CeRangeList_t* highlight_range_list, CeDrawColorList_t* draw_color_list,
+                                  CeSyntaxDef_t* syntax_defs, void* user_data){
+     syntax_highlight_lexer(view, highlight_range_list, draw_color_list, syntax_defs, &g_makefile_lexer);
+}
 
-          if(in_visual && line_len == 0) change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_VISUAL, match_point);
+CeSyntaxCacheStats_t ce_syntax_cache_stats(){
+     pthread_mutex_lock(&g_span_cache_lock);
+     CeSyntaxCacheStats_t stats = g_span_cache.stats;
+     stats.entries = g_span_cache.count;
+     pthread_mutex_unlock(&g_span_cache_lock);
+     stats.capacity = SYNTAX_SPAN_CACHE_SIZE;
+     return stats;
+}
 
-          for(int64_t x = 0; x < line_len; ++x){
-               char* str = ce_utf8_iterate_to(line, x); // TODO: decode rather than iterating to each time
-               match_point.x = x;
+static SyntaxLexer_t* syntax_lexer_for(CeSyntaxHighlightFunc_t* highlight_func){
+     static const struct{
+          CeSyntaxHighlightFunc_t* highlight_func;
+          SyntaxLexer_t* lexer;
+     }lexers[] = {
+          {ce_syntax_highlight_c, &g_c_lexer},
+          {ce_syntax_highlight_cpp, &g_cpp_lexer},
+          {ce_syntax_highlight_java, &g_java_lexer},
+          {ce_syntax_highlight_python, &g_python_lexer},
+          {ce_syntax_highlight_bash, &g_bash_lexer},
+          {ce_syntax_highlight_config, &g_config_lexer},
+          {ce_syntax_highlight_rust, &g_rust_lexer},
+          {ce_syntax_highlight_go, &g_go_lexer},
+          {ce_syntax_highlight_json, &g_json_lexer},
+          {ce_syntax_highlight_yaml, &g_yaml_lexer},
+          {ce_syntax_highlight_markdown, &g_markdown_lexer},
+          {ce_syntax_highlight_makefile, &g_makefile_lexer},
+     };
 
-               ce_syntax_highlight_visual(&range_node, &in_visual, match_point, draw_color_list, syntax_defs);
+     for(size_t i = 0; i < SYNTAX_ARRAY_COUNT(lexers); i++){
+          if(lexers[i].highlight_func == highlight_func) return lexers[i].lexer;
+     }
+     return NULL;
+}
 
-               if(current_match_len <= 1){
-                    if((match_len = match_config_keyword(str, line))){
-                         change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_KEYWORD, match_point);
-                    }else if((match_len = match_caps_var(str, line))){
-                         change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_CAPS_VAR, match_point);
-                    }else if((match_len = match_python_comment(str))){
-                         change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_COMMENT, match_point);
-                    }else if((match_len = match_python_string(str))){
-                         change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_STRING, match_point);
-                    }else if((match_len = match_c_literal(str, line))){
-                         change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_NUMBER_LITERAL, match_point);
-                    }else if(((view->cursor.y != y) || (x > view->cursor.x)) && (match_len = match_trailing_whitespace(str))){
-                         change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_TRAILING_WHITESPACE, match_point);
-                         ce_draw_color_list_insert(draw_color_list, ce_syntax_def_get_fg(syntax_defs, CE_SYNTAX_COLOR_NORMAL, COLOR_DEFAULT),
-                                                   ce_syntax_def_get_bg(syntax_defs, CE_SYNTAX_COLOR_NORMAL, COLOR_DEFAULT),
-                                                   (CePoint_t){0, match_point.y + 1});
-                    }else if(!draw_color_list->tail || (draw_color_list->tail->fg != COLOR_DEFAULT || draw_color_list->tail->bg != COLOR_DEFAULT)){
-                         change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_NORMAL, match_point);
-                    }
+int64_t ce_syntax_tokenize(CeBuffer_t* buffer, CeSyntaxHighlightFunc_t* highlight_func, int64_t max_lines){
+     SyntaxLexer_t* lexer = syntax_lexer_for(highlight_func);
+     if(!lexer || buffer->line_count <= 0 || buffer->no_token_cache) return 0;
+     return syntax_tokens_update(buffer, &buffer->tokens, lexer, buffer->line_count - 1, max_lines);
+}
 
-                    if(match_len) current_match_len = match_len;
-               }else{
-                    current_match_len--;
-               }
+bool ce_syntax_token_at(CeBuffer_t* buffer, CeSyntaxHighlightFunc_t* highlight_func, CePoint_t point, CeSyntaxColor_t* syntax_class){
+     SyntaxLexer_t* lexer = syntax_lexer_for(highlight_func);
+     if(!lexer) return false;
+     if(point.y < 0 || point.y >= buffer->line_count) return false;
+     CeBufferTokens_t private_tokens = {};
+     const CeBufferLineTokens_t* line_tokens = syntax_tokens_range(buffer, lexer, point.y, point.y, INT64_MAX, &private_tokens);
+     if(!line_tokens){
+          syntax_tokens_free(&private_tokens);
+          return false;
+     }
 
-               if(in_visual) change_draw_color(draw_color_list, syntax_defs, CE_SYNTAX_COLOR_VISUAL, match_point);
+     // binary search for the last token starting at or before the point
+     int32_t low = 0;
+     int32_t high = line_tokens->count;
+     while(low < high){
+          int32_t middle = low + (high - low) / 2;
+          if(line_tokens->tokens[middle].start <= point.x){
+               low = middle + 1;
+          }else{
+               high = middle;
           }
+     }
 
-          check_visual_mode_end(range_node, &in_visual, match_point.y, line_len, draw_color_list);
+     *syntax_class = CE_SYNTAX_COLOR_NORMAL;
+     if(low > 0){
+          const CeBufferToken_t* token = line_tokens->tokens + (low - 1);
+          if(point.x < token->start + token->len) *syntax_class = token->syntax_class;
      }
+     syntax_tokens_free(&private_tokens);
+     return true;
 }
 
 void ce_syntax_highlight_diff(CeView_t* view, CeRangeList_t* highlight_range_list, CeDrawColorList_t* draw_color_list,
@@ -3,6 +3,8 @@
 #include "ce.h"
 
 #define CE_SYNTAX_USE_CURRENT_COLOR -2
+#define CE_SYNTAX_LOOK_BACK_LINES 1024 // lexed above a view when there are no tokens to start from
+#define CE_SYNTAX_DRAW_LEX_LINES 8192 // most lines highlighting a view lexes into the buffer's tokens, the rest are lexed while idle
 
 typedef enum{
      CE_SYNTAX_COLOR_NORMAL,
@@ -43,9 +45,14 @@ typedef struct CeDrawColorNode_t{
      struct CeDrawColorNode_t* next;
 }CeDrawColorNode_t;
 
+// nodes live in one growable array that is kept around and reused by clearing the list, head, tail and next are kept
+// pointing into the array so the list can still be walked like a linked list
 typedef struct{
      CeDrawColorNode_t* head;
      CeDrawColorNode_t* tail;
+     CeDrawColorNode_t* nodes;
+     int64_t count;
+     int64_t capacity;
 }CeDrawColorList_t;
 
 typedef struct CeRangeNode_t{
@@ -53,31 +60,54 @@ typedef struct CeRangeNode_t{
      struct CeRangeNode_t* next;
 }CeRangeNode_t;
 
+// stored the same way as CeDrawColorList_t
 typedef struct{
      CeRangeNode_t* head;
      CeRangeNode_t* tail;
+     CeRangeNode_t* nodes;
+     int64_t count;
+     int64_t capacity;
 }CeRangeList_t;
 
+#define CE_COLOR_PAIR_MAX 256 // COLOR_PAIR() only has room for 8 bits of pair id
+#define CE_COLOR_DEF_HASH_SIZE 512 // power of 2, at least twice CE_COLOR_PAIR_MAX so probes stay short
+
 typedef struct{
      int fg;
      int bg;
+     uint64_t last_used;
 }CeColorPair_t;
 
+// maps fg/bg combinations to curses color pairs, evicting the least recently used pair when we run out
 typedef struct{
      int32_t count;
-     int32_t current;
-     CeColorPair_t pairs[256]; // NOTE: this is what COLOR_PAIRS was for me (which is for some reason not const?)
+     int32_t capacity;
+     uint64_t uses;
+     int16_t hash_table[CE_COLOR_DEF_HASH_SIZE]; // pair ids, 0 means empty
+     CeColorPair_t pairs[CE_COLOR_PAIR_MAX];      // indexed by pair id, pair 0 is reserved by curses
+     int64_t evictions;
+     CeColorPair_t last_evicted; // anything drawn with this combination no longer has the right colors
 }CeColorDefs_t;
 
+typedef struct{
+     int64_t hits;
+     int64_t misses;
+     int64_t evictions;
+     int64_t entries;
+     int64_t capacity;
+}CeSyntaxCacheStats_t;
+
 typedef void CeSyntaxHighlightFunc_t(CeView_t*, CeRangeList_t*, CeDrawColorList_t*, CeSyntaxDef_t*, void*);
 
 int ce_syntax_def_get_fg(CeSyntaxDef_t* syntax_defs, CeSyntaxColor_t syntax_color, int current_fg);
 int ce_syntax_def_get_bg(CeSyntaxDef_t* syntax_defs, CeSyntaxColor_t syntax_color, int current_bg);
 
 bool ce_draw_color_list_insert(CeDrawColorList_t* list, int fg, int bg, CePoint_t point);
+void ce_draw_color_list_clear(CeDrawColorList_t* list);
 void ce_draw_color_list_free(CeDrawColorList_t* list);
 bool ce_range_list_insert(CeRangeList_t* list, CePoint_t start, CePoint_t end);
 bool ce_range_list_insert_sorted(CeRangeList_t* list, CePoint_t start, CePoint_t end);
+void ce_range_list_clear(CeRangeList_t* list);
 void ce_range_list_free(CeRangeList_t* list);
 int ce_draw_color_list_last_fg_color(CeDrawColorList_t* draw_color_list);
 int ce_draw_color_list_last_bg_color(CeDrawColorList_t* draw_color_list);
@@ -95,10 +125,33 @@ void ce_syntax_highlight_bash(CeView_t* view, CeRangeList_t* highlight_range_lis
                               CeSyntaxDef_t* syntax_defs, void* user_data);
 void ce_syntax_highlight_config(CeView_t* view, CeRangeList_t* highlight_range_list, CeDrawColorList_t* draw_color_list,
                                 CeSyntaxDef_t* syntax_defs, void* user_data);
+void ce_syntax_highlight_rust(CeView_t* view, CeRangeList_t* highlight_range_list, CeDrawColorList_t* draw_color_list,
+                              CeSyntaxDef_t* syntax_defs, void* user_data);
+void ce_syntax_highlight_go(CeView_t* view, CeRangeList_t* highlight_range_list, CeDrawColorList_t* draw_color_list,
+                            CeSyntaxDef_t* syntax_defs, void* user_data);
+void ce_syntax_highlight_json(CeView_t* view, CeRangeList_t* highlight_range_list, CeDrawColorList_t* draw_color_list,
+                              CeSyntaxDef_t* syntax_defs, void* user_data);
+void ce_syntax_highlight_yaml(CeView_t* view, CeRangeList_t* highlight_range_list, CeDrawColorList_t* draw_color_list,
+                              CeSyntaxDef_t* syntax_defs, void* user_data);
+void ce_syntax_highlight_markdown(CeView_t* view, CeRangeList_t* highlight_range_list, CeDrawColorList_t* draw_color_list,
+                                  CeSyntaxDef_t* syntax_defs, void* user_data);
+void ce_syntax_highlight_makefile(CeView_t* view, CeRangeList_t* highlight_range_list, CeDrawColorList_t* draw_color_list,
+                                  CeSyntaxDef_t* syntax_defs, void* user_data);
 void ce_syntax_highlight_diff(CeView_t* view, CeRangeList_t* highlight_range_list, CeDrawColorList_t* draw_color_list,
                               CeSyntaxDef_t* syntax_defs, void* user_data);
 void ce_syntax_highlight_plain(CeView_t* view, CeRangeList_t* highlight_range_list, CeDrawColorList_t* draw_color_list,
                                CeSyntaxDef_t* syntax_defs, void* user_data);
 
+// lexes up to max_lines more lines of the buffer into its token cache, returns how many lines were lexed, 0 once the
+// cache is up to date or if the highlighter doesn't tokenize
+int64_t ce_syntax_tokenize(CeBuffer_t* buffer, CeSyntaxHighlightFunc_t* highlight_func, int64_t max_lines);
+
+// looks up the class of the token under the point, lexing up to its line if needed, returns false if the highlighter
+// doesn't tokenize
+bool ce_syntax_token_at(CeBuffer_t* buffer, CeSyntaxHighlightFunc_t* highlight_func, CePoint_t point, CeSyntaxColor_t* syntax_class);
+
+// how often lexing a line was skipped because the same line in the same state was lexed recently
+CeSyntaxCacheStats_t ce_syntax_cache_stats();
+
 void ce_syntax_highlight_visual(CeRangeNode_t** range_node, bool* in_visual, CePoint_t point, CeDrawColorList_t* draw_color_list,
                                 CeSyntaxDef_t* syntax_defs);
@@ -25,6 +25,10 @@
 #include <pty.h>
 #include <pwd.h>
 #include <signal.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/epoll.h>
+#include <time.h>
 
 #define ELEM_COUNT(static_array) (sizeof(static_array) / sizeof(static_array[0]))
 #define DEFAULT(a, value) (a = (a == 0) ? value : a)
@@ -56,8 +60,434 @@ static bool is_controller(CeRune_t rune){
      return false;
 }
 
+// only clears what the next sequence reads before it writes, the buffer is just kept for logging
 static void csi_reset(CeTerminalCSIEscape_t* csi){
-     memset(csi, 0, sizeof(*csi));
+     memset(csi->arguments, 0, sizeof(csi->arguments));
+     csi->buffer_length = 0;
+     csi->buffer[0] = 0;
+     csi->private = 0;
+     csi->argument_count = 0;
+     csi->intermediate_count = 0;
+     csi->mode[0] = 0;
+     csi->mode[1] = 0;
+}
+
+static void csi_buffer_add(CeTerminalCSIEscape_t* csi, CeRune_t rune){
+     if(csi->buffer_length < CE_TERMINAL_ESCAPE_BUFFER_SIZE - 1) csi->buffer[csi->buffer_length++] = rune;
+}
+
+static bool terminal_glyphs_equal(const CeTerminalGlyph_t* a, const CeTerminalGlyph_t* b){
+     return a->attributes == b->attributes && a->foreground == b->foreground && a->background == b->background;
+}
+
+static bool terminal_line_reserve(CeTerminalLine_t* line, int32_t count){
+     if(count <= line->capacity) return true;
+     int32_t new_capacity = line->capacity ? line->capacity * 2 : 4;
+     while(new_capacity < count) new_capacity *= 2;
+     CeTerminalSpan_t* new_spans = realloc(line->spans, new_capacity * sizeof(*new_spans));
+     if(!new_spans) return false;
+     line->spans = new_spans;
+     line->capacity = new_capacity;
+     return true;
+}
+
+static void terminal_line_free(CeTerminalLine_t* line){
+     free(line->cells);
+     free(line->spans);
+     if(line->copy){
+          free(line->copy->text);
+          free(line->copy->spans);
+          free(line->copy);
+     }
+     memset(line, 0, sizeof(*line));
+}
+
+static bool terminal_line_init(CeTerminalLine_t* line, int32_t columns, CeTerminalGlyph_t glyph){
+     line->cells = malloc(columns * sizeof(*line->cells));
+     line->copy = calloc(1, sizeof(*line->copy));
+     if(line->copy) line->copy->text = malloc((columns + 1) * CE_UTF8_SIZE);
+     if(!line->cells || !line->copy || !line->copy->text || !terminal_line_reserve(line, 1)){
+          terminal_line_free(line);
+          return false;
+     }
+     line->copy->text_columns = columns;
+
+     for(int32_t x = 0; x < columns; x++) line->cells[x] = ' ';
+     line->columns = columns;
+     line->copy->text[0] = 0;
+     line->spans[0] = (CeTerminalSpan_t){0, columns, glyph};
+     line->count = 1;
+     line->wrapped = false;
+     line->dirty = true;
+     return true;
+}
+
+// returns the index of the span containing x
+static int32_t terminal_line_find(const CeTerminalLine_t* line, int32_t x){
+     int32_t low = 0;
+     int32_t high = line->count - 1;
+     while(low < high){
+          int32_t middle = low + ((high - low) + 1) / 2;
+          if(line->spans[middle].start <= x){
+               low = middle;
+          }else{
+               high = middle - 1;
+          }
+     }
+     return low;
+}
+
+// makes sure a span starts at x and returns its index, the span count if x is the end of the line or -1 if we ran out of memory
+static int32_t terminal_line_split(CeTerminalLine_t* line, int32_t x){
+     if(line->count == 0) return 0;
+     int32_t index = terminal_line_find(line, x);
+     CeTerminalSpan_t* span = line->spans + index;
+     if(span->start == x) return index;
+     if(x >= span->start + span->len) return index + 1;
+     if(!terminal_line_reserve(line, line->count + 1)) return -1;
+
+     span = line->spans + index;
+     memmove(span + 2, span + 1, (line->count - (index + 1)) * sizeof(*span));
+     span[1] = (CeTerminalSpan_t){x, (span->start + span->len) - x, span->glyph};
+     span->len = x - span->start;
+     line->count++;
+     return index + 1;
+}
+
+// joins the span at the index with the one before it if they look the same
+static void terminal_line_merge(CeTerminalLine_t* line, int32_t index){
+     if(index <= 0 || index >= line->count) return;
+     CeTerminalSpan_t* span = line->spans + index;
+     if(!terminal_glyphs_equal(&span[-1].glyph, &span->glyph)) return;
+     span[-1].len += span->len;
+     memmove(span, span + 1, (line->count - (index + 1)) * sizeof(*span));
+     line->count--;
+}
+
+static void terminal_line_remove_spans(CeTerminalLine_t* line, int32_t first, int32_t end){
+     if(end <= first) return;
+     memmove(line->spans + first, line->spans + end, (line->count - end) * sizeof(*line->spans));
+     line->count -= (end - first);
+}
+
+static void terminal_line_truncate(CeTerminalLine_t* line, int32_t columns){
+     while(line->count > 0 && line->spans[line->count - 1].start >= columns) line->count--;
+     if(line->count == 0) return;
+     CeTerminalSpan_t* last = line->spans + (line->count - 1);
+     if(last->start + last->len > columns) last->len = columns - last->start;
+}
+
+// sets the cells from x up to, but not including, end_x to the glyph
+static void terminal_line_set(CeTerminalLine_t* line, int32_t x, int32_t end_x, CeTerminalGlyph_t glyph){
+     if(x >= end_x || line->count == 0) return;
+
+     // printing text usually either doesn't change the attributes or continues the run before it
+     int32_t index = terminal_line_find(line, x);
+     CeTerminalSpan_t* span = line->spans + index;
+     if(end_x <= span->start + span->len && terminal_glyphs_equal(&span->glyph, &glyph)) return;
+     if(end_x == x + 1 && span->start == x && span->len > 1 && index > 0 && terminal_glyphs_equal(&span[-1].glyph, &glyph)){
+          span[-1].len++;
+          span->start++;
+          span->len--;
+          return;
+     }
+
+     int32_t first = terminal_line_split(line, x);
+     if(first < 0) return;
+     int32_t end = terminal_line_split(line, end_x);
+     if(end < 0) return;
+
+     line->spans[first] = (CeTerminalSpan_t){x, end_x - x, glyph};
+     terminal_line_remove_spans(line, first + 1, end);
+     terminal_line_merge(line, first + 1);
+     terminal_line_merge(line, first);
+}
+
+// shifts the cells at x over by n, the cells shifted passed the last column are dropped
+static void terminal_line_insert(CeTerminalLine_t* line, int32_t x, int32_t n, int32_t columns, CeTerminalGlyph_t glyph){
+     if(n <= 0) return;
+     int32_t index = terminal_line_split(line, x);
+     if(index < 0 || !terminal_line_reserve(line, line->count + 1)) return;
+
+     for(int32_t i = index; i < line->count; i++){
+          line->spans[i].start += n;
+     }
+     memmove(line->spans + index + 1, line->spans + index, (line->count - index) * sizeof(*line->spans));
+     line->spans[index] = (CeTerminalSpan_t){x, n, glyph};
+     line->count++;
+
+     terminal_line_truncate(line, columns);
+     terminal_line_merge(line, index + 1);
+     terminal_line_merge(line, index);
+}
+
+// removes n cells at x and shifts the rest of the line back, the end of the line is filled with the glyph
+static void terminal_line_delete(CeTerminalLine_t* line, int32_t x, int32_t n, int32_t columns, CeTerminalGlyph_t glyph){
+     if(n <= 0) return;
+     if(x + n > columns) n = columns - x;
+     int32_t first = terminal_line_split(line, x);
+     if(first < 0) return;
+     int32_t end = terminal_line_split(line, x + n);
+     if(end < 0 || !terminal_line_reserve(line, line->count + 1)) return;
+
+     terminal_line_remove_spans(line, first, end);
+     for(int32_t i = first; i < line->count; i++){
+          line->spans[i].start -= n;
+     }
+     line->spans[line->count++] = (CeTerminalSpan_t){columns - n, n, glyph};
+
+     terminal_line_merge(line, line->count - 1);
+     terminal_line_merge(line, first);
+}
+
+static void terminal_line_fill(CeTerminalLine_t* line, int32_t x, int32_t end_x, CeRune_t rune){
+     for(int32_t i = x; i < end_x; i++) line->cells[i] = rune;
+     line->dirty = true;
+}
+
+// the tty thread resizes lines as they scroll onto the screen, so the copy is left alone and grows the next time the line
+// is copied
+static void terminal_line_resize(CeTerminalLine_t* line, int32_t new_columns, CeTerminalGlyph_t glyph){
+     int32_t columns = line->columns;
+     CeRune_t* new_cells = realloc(line->cells, new_columns * sizeof(*new_cells));
+     if(!new_cells) return;
+     line->cells = new_cells;
+     line->columns = new_columns;
+     if(new_columns > columns) terminal_line_fill(line, columns, new_columns, ' ');
+     line->dirty = true;
+
+     if(new_columns < columns){
+          terminal_line_truncate(line, new_columns);
+     }else if(new_columns > columns){
+          if(!terminal_line_reserve(line, line->count + 1)) return;
+          line->spans[line->count++] = (CeTerminalSpan_t){columns, new_columns - columns, glyph};
+          terminal_line_merge(line, line->count - 1);
+     }
+}
+
+// y counts from the oldest line in the scroll back
+static CeTerminalLine_t* terminal_line(CeTerminal_t* terminal, int64_t y){
+     return terminal->screen.lines + ((terminal->screen.head + y) % terminal->screen.capacity);
+}
+
+static bool terminal_screen_grow(CeTerminal_t* terminal, CeTerminalScreen_t* screen, int64_t count){
+     CeTerminalGlyph_t blank = {0, COLOR_DEFAULT, COLOR_DEFAULT};
+     if(count > screen->capacity) count = screen->capacity;
+     while(screen->count < count){
+          CeTerminalLine_t* line = screen->lines + ((screen->head + screen->count) % screen->capacity);
+          if(!terminal_line_init(line, terminal->columns, blank)) return false;
+          screen->count++;
+     }
+     return true;
+}
+
+// nothing else opens the file, so it is unlinked as soon as it is created and goes away with us
+static void terminal_archive_init(CeTerminalArchive_t* archive, int64_t max_line_count){
+     archive->file_descriptor = -1;
+     archive->max_line_count = max_line_count;
+     if(max_line_count <= 0) return;
+
+     const char* home = getenv("HOME");
+     if(home){
+          char path[PATH_MAX];
+          snprintf(path, sizeof(path), "%s/.ce/terminal_XXXXXX", home);
+          archive->file_descriptor = mkstemp(path);
+          if(archive->file_descriptor >= 0) unlink(path);
+     }
+
+     if(archive->file_descriptor < 0){
+          ce_log("%s() failed to create a scroll back file in ~/.ce, keeping it in memory\n", __FUNCTION__);
+     }
+}
+
+static void terminal_archive_drop_block(CeTerminalArchive_t* archive, CeTerminalArchiveBlock_t* block){
+     if(block->offset >= 0){
+          fallocate(archive->file_descriptor, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, block->offset, block->size);
+     }
+     munmap(block->text, block->size);
+}
+
+static void terminal_archive_free(CeTerminalArchive_t* archive){
+     for(int64_t b = 0; b < archive->block_count + archive->spare_count; b++){
+          terminal_archive_drop_block(archive, archive->blocks + b);
+     }
+     if(archive->file_descriptor >= 0) close(archive->file_descriptor);
+     free(archive->blocks);
+     free(archive->lines);
+     memset(archive, 0, sizeof(*archive));
+     archive->file_descriptor = -1;
+}
+
+// returns the newest block with at least len bytes left in it, mapping a new one if we need to
+static CeTerminalArchiveBlock_t* terminal_archive_block(CeTerminalArchive_t* archive, int64_t len){
+     if(archive->block_count){
+          CeTerminalArchiveBlock_t* block = archive->blocks + (archive->block_count - 1);
+          if(block->size - block->used >= len) return block;
+     }
+
+     if(archive->spare_count){
+          CeTerminalArchiveBlock_t* block = archive->blocks + archive->block_count;
+          if(block->size >= len){
+               archive->spare_count--;
+               archive->block_count++;
+               return block;
+          }
+
+          // the lines got wider than the spare blocks, so they aren't any use to us anymore
+          for(int64_t b = 0; b < archive->spare_count; b++) terminal_archive_drop_block(archive, block + b);
+          archive->spare_count = 0;
+     }
+
+     if(archive->block_count == archive->block_capacity){
+          int64_t new_capacity = archive->block_capacity ? archive->block_capacity * 2 : 16;
+          CeTerminalArchiveBlock_t* new_blocks = realloc(archive->blocks, new_capacity * sizeof(*new_blocks));
+          if(!new_blocks) return NULL;
+          archive->blocks = new_blocks;
+          archive->block_capacity = new_capacity;
+     }
+
+     CeTerminalArchiveBlock_t block = {NULL, -1, CE_TERMINAL_ARCHIVE_BLOCK_SIZE, 0, 0};
+     while(block.size < len) block.size += CE_TERMINAL_ARCHIVE_BLOCK_SIZE;
+
+     // allocate the disk space up front, writing to a mapped hole on a full disk would get us a SIGBUS
+     void* text = MAP_FAILED;
+     if(archive->file_descriptor >= 0 && posix_fallocate(archive->file_descriptor, archive->file_size, block.size) == 0){
+          text = mmap(NULL, block.size, PROT_READ | PROT_WRITE, MAP_SHARED, archive->file_descriptor, archive->file_size);
+          if(text != MAP_FAILED){
+               block.offset = archive->file_size;
+               archive->file_size += block.size;
+          }
+     }
+     if(text == MAP_FAILED) text = mmap(NULL, block.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+     if(text == MAP_FAILED){
+          ce_log("%s() mmap() failed: '%s'\n", __FUNCTION__, strerror(errno));
+          return NULL;
+     }
+
+     block.text = text;
+     archive->blocks[archive->block_count] = block;
+     return archive->blocks + archive->block_count++;
+}
+
+// keeps the line's text without its trailing blanks. wrapped lines are joined with the lines they wrap onto, so the
+// archive doesn't depend on the terminal's width. returns true if a whole line was added
+static bool terminal_archive_line(CeTerminalArchive_t* archive, const CeTerminalLine_t* line){
+     if(archive->max_line_count <= 0) return false;
+
+     if(archive->line_count == archive->line_capacity){
+          int64_t new_capacity = archive->line_capacity ? archive->line_capacity * 2 : 1024;
+          char** new_lines = realloc(archive->lines, new_capacity * sizeof(*new_lines));
+          if(!new_lines) return false;
+          archive->lines = new_lines;
+          archive->line_capacity = new_capacity;
+     }
+
+     // very long lines are split up rather than copied into every new block they outgrow
+     bool wrapped = line->wrapped && archive->pending < CE_TERMINAL_ARCHIVE_BLOCK_SIZE / 2;
+     int32_t end = line->columns;
+     if(!line->wrapped){
+          while(end > 0 && line->cells[end - 1] == ' ') end--;
+     }
+
+     int64_t previous = archive->block_count - 1;
+     CeTerminalArchiveBlock_t* block = terminal_archive_block(archive, archive->pending + (int64_t)(end) * CE_UTF8_SIZE + 1);
+     if(!block) return false;
+     if(archive->pending && block != archive->blocks + previous){
+          memcpy(block->text, archive->blocks[previous].text + archive->blocks[previous].used, archive->pending);
+     }
+
+     char* text = block->text + block->used;
+     char* itr = text + archive->pending;
+     for(int32_t x = 0; x < end; x++){
+          if(line->cells[x] < 0x80){
+               *itr++ = line->cells[x];
+               continue;
+          }
+          int64_t written = 0;
+          ce_utf8_encode(line->cells[x], itr, CE_UTF8_SIZE, &written);
+          itr += written;
+     }
+
+     if(wrapped){
+          archive->pending = itr - text;
+          return false;
+     }
+
+     *itr = 0;
+     archive->pending = 0;
+     block->used += (itr - text) + 1;
+     block->line_count++;
+     archive->lines[archive->line_count++] = text;
+     return true;
+}
+
+// drops the oldest blocks once we have more lines than we keep, returns how many lines went with them
+static int64_t terminal_archive_trim(CeTerminalArchive_t* archive){
+     int64_t dropped_lines = 0;
+     while(archive->block_count > 1 && archive->line_count - dropped_lines - archive->blocks[0].line_count >= archive->max_line_count){
+          CeTerminalArchiveBlock_t block = archive->blocks[0];
+          dropped_lines += block.line_count;
+          block.used = 0;
+          block.line_count = 0;
+          archive->block_count--;
+          archive->spare_count++;
+          memmove(archive->blocks, archive->blocks + 1, (archive->block_count + archive->spare_count - 1) * sizeof(block));
+          archive->blocks[archive->block_count + archive->spare_count - 1] = block;
+     }
+     if(!dropped_lines) return 0;
+
+     archive->line_count -= dropped_lines;
+     memmove(archive->lines, archive->lines + dropped_lines, archive->line_count * sizeof(*archive->lines));
+     return dropped_lines;
+}
+
+static bool terminal_screen_alloc(CeTerminal_t* terminal, CeTerminalScreen_t* screen, int64_t capacity){
+     screen->lines = calloc(capacity, sizeof(*screen->lines));
+     if(!screen->lines) return false;
+     screen->head = 0;
+     screen->count = 0;
+     screen->capacity = capacity;
+     return terminal_screen_grow(terminal, screen, terminal->rows);
+}
+
+static void terminal_screen_free(CeTerminalScreen_t* screen){
+     for(int64_t i = 0; i < screen->count; i++){
+          terminal_line_free(screen->lines + ((screen->head + i) % screen->capacity));
+     }
+     free(screen->lines);
+     memset(screen, 0, sizeof(*screen));
+}
+
+// moves the lines into a ring with a different capacity, the oldest ones are freed if they don't fit
+static bool terminal_screen_set_capacity(CeTerminalScreen_t* screen, int64_t capacity){
+     CeTerminalLine_t* lines = calloc(capacity, sizeof(*lines));
+     if(!lines) return false;
+
+     int64_t dropped = (screen->count > capacity) ? screen->count - capacity : 0;
+     for(int64_t i = 0; i < screen->count; i++){
+          CeTerminalLine_t* line = screen->lines + ((screen->head + i) % screen->capacity);
+          if(i < dropped) terminal_line_free(line);
+          else lines[i - dropped] = *line;
+     }
+
+     free(screen->lines);
+     screen->lines = lines;
+     screen->head = 0;
+     screen->count -= dropped;
+     screen->capacity = capacity;
+     return true;
+}
+
+static int64_t terminal_seconds(){
+     struct timespec now;
+     clock_gettime(CLOCK_MONOTONIC, &now);
+     return now.tv_sec;
+}
+
+static int64_t terminal_nanoseconds(){
+     struct timespec now;
+     clock_gettime(CLOCK_MONOTONIC, &now);
+     return (int64_t)(now.tv_sec) * 1000000000 + now.tv_nsec;
 }
 
 static void terminal_clear_region(CeTerminal_t* terminal, int left, int top, int right, int bottom){
@@ -78,37 +508,19 @@ static void terminal_clear_region(CeTerminal_t* terminal, int left, int top, int
      CE_CLAMP(right, 0, terminal->columns - 1);
      CE_CLAMP(top, -terminal->start_line, terminal->rows - 1);
      CE_CLAMP(bottom, -terminal->start_line, terminal->rows - 1);
-     int width = (right - left) + 1;
+     CeTerminalGlyph_t blank = {0, terminal->cursor.attributes.foreground, terminal->cursor.attributes.background};
 
      for(int y = top + terminal->start_line; y <= bottom + terminal->start_line; ++y){
-          for(int x = left; x <= right; ++x){
-               CeTerminalGlyph_t* glyph = terminal->lines[y] + x;
-               glyph->foreground = terminal->cursor.attributes.foreground;
-               glyph->background = terminal->cursor.attributes.background;
-               glyph->attributes = 0;
-          }
-
-          char* start = ce_utf8_iterate_to(terminal->buffer->lines[y], left);
-          char* end = ce_utf8_iterate_to(terminal->buffer->lines[y], right);
-          assert(ce_utf8_strlen(terminal->buffer->lines[y]) != -1);
-          int64_t length = (end - start) + 1;
-          if(length > width){
-               char* shift_src = end;
-               char* shift_dst = start + width;
-               int64_t shift_len = strlen(shift_src) + 1; // include null terminator
-               memmove(shift_dst, shift_src, shift_len);
-               memset(start, ' ', width);
-               shift_dst[shift_len - 1] = 0;
-               assert(ce_utf8_strlen(terminal->buffer->lines[y]) != -1);
-          }else{
-               memset(start, ' ', width);
-          }
+          CeTerminalLine_t* line = terminal_line(terminal, y);
+          if(line->columns != terminal->columns) terminal_line_resize(line, terminal->columns, blank);
+          terminal_line_set(line, left, right + 1, blank);
+          terminal_line_fill(line, left, right + 1, ' ');
+          if(right == terminal->columns - 1) line->wrapped = false;
      }
 }
 
 static void terminal_scroll_down(CeTerminal_t* terminal, int original, int n){
-     CeTerminalGlyph_t* temp_line;
-     char* temp_buffer_line;
+     CeTerminalLine_t temp_line;
 
      CE_CLAMP(n, 0, terminal->bottom - original + 1);
 
@@ -118,29 +530,38 @@ static void terminal_scroll_down(CeTerminal_t* terminal, int original, int n){
           int cur = terminal->start_line + i;
           int next = terminal->start_line + (i - n);
 
-          temp_line = terminal->lines[cur];
-          terminal->lines[cur] = terminal->lines[next];
-          terminal->lines[next] = temp_line;
-
-          temp_buffer_line = terminal->buffer->lines[cur];
-          terminal->buffer->lines[cur] = terminal->buffer->lines[next];
-          terminal->buffer->lines[next] = temp_buffer_line;
+          temp_line = *terminal_line(terminal, cur);
+          *terminal_line(terminal, cur) = *terminal_line(terminal, next);
+          *terminal_line(terminal, next) = temp_line;
      }
 
-     // update the last goto destination based on scrolling
-     CeAppBufferData_t* buffer_data = terminal->buffer->app_data;
-     buffer_data->last_goto_destination += n;
-     if(buffer_data->last_goto_destination >= terminal->buffer->line_count){
-          buffer_data->last_goto_destination = terminal->buffer->line_count - 1;
-     }
+     terminal->scrolled += n;
 }
 
 static void terminal_scroll_up(CeTerminal_t* terminal, int original, int n){
-     CeTerminalGlyph_t* temp_line = NULL;
-     char* temp_buffer_line = NULL;
+     CeTerminalLine_t temp_line;
 
      CE_CLAMP(n, 0, terminal->bottom - original + 1);
 
+     // scrolling everything, so add lines to the end of the scroll back until it is full, then reuse the oldest ones
+     if(original == -terminal->start_line && terminal->bottom == terminal->rows - 1){
+          CeTerminalScreen_t* screen = &terminal->screen;
+          int64_t count = screen->count;
+          terminal_screen_grow(terminal, screen, count + n);
+          int64_t reused = n - (screen->count - count);
+          int64_t archived = 0;
+          if(!(terminal->mode & CE_TERMINAL_MODE_ALTSCREEN)){
+               for(int64_t i = 0; i < reused; i++){
+                    if(terminal_archive_line(&terminal->archive, terminal_line(terminal, i))) archived++;
+               }
+          }
+          screen->head = (screen->head + reused) % screen->capacity;
+          terminal->start_line = screen->count - terminal->rows;
+          terminal_clear_region(terminal, 0, terminal->rows - n, terminal->columns - 1, terminal->rows - 1);
+          terminal->scrolled -= reused - archived;
+          return;
+     }
+
      // clear the original line plus the scroll
      terminal_clear_region(terminal, 0, original, terminal->columns - 1, original + n - 1);
 
@@ -150,21 +571,12 @@ static void terminal_scroll_up(CeTerminal_t* terminal, int original, int n){
           int cur = terminal->start_line + i;
           int next = terminal->start_line + (i + n);
 
-          temp_line = terminal->lines[cur];
-          terminal->lines[cur] = terminal->lines[next];
-          terminal->lines[next] = temp_line;
-
-          temp_buffer_line = terminal->buffer->lines[cur];
-          terminal->buffer->lines[cur] = terminal->buffer->lines[next];
-          terminal->buffer->lines[next] = temp_buffer_line;
+          temp_line = *terminal_line(terminal, cur);
+          *terminal_line(terminal, cur) = *terminal_line(terminal, next);
+          *terminal_line(terminal, next) = temp_line;
      }
 
-     // update the last goto destination based on scrolling
-     CeAppBufferData_t* buffer_data = terminal->buffer->app_data;
-     buffer_data->last_goto_destination -= n;
-     if(buffer_data->last_goto_destination < 0){
-          buffer_data->last_goto_destination = 0;
-     }
+     terminal->scrolled -= n;
 }
 
 static void terminal_set_scroll(CeTerminal_t* terminal, int top, int bottom){
@@ -188,30 +600,18 @@ static void terminal_insert_blank_line(CeTerminal_t* terminal, int n){
 }
 
 static void terminal_insert_blank(CeTerminal_t* terminal, int n){
-     int dst, src, size;
-     CeTerminalGlyph_t* line;
+     int dst, src;
 
      CE_CLAMP(n, 0, terminal->columns - terminal->cursor.x);
      int cursor_line = terminal->cursor.y + terminal->start_line;
 
      dst = terminal->cursor.x + n;
      src = terminal->cursor.x;
-     size = terminal->columns - dst;
-     line = terminal->lines[cursor_line];
-
-     memmove(&line[dst], &line[src], size * sizeof(*line));
-
-     // figure out our start and end
-     char* line_src = ce_utf8_iterate_to(terminal->buffer->lines[cursor_line], src);
-     assert(ce_utf8_strlen(terminal->buffer->lines[cursor_line]) != -1);
 
-     // shift over line
-     memmove(line_src + n, line_src, strlen(line_src) + 1);
-
-     // overwrite what we shifted over with spaces
-     memset(line_src, ' ', n);
-
-     assert(ce_utf8_strlen(terminal->buffer->lines[cursor_line]) != -1);
+     CeTerminalGlyph_t blank = {0, terminal->cursor.attributes.foreground, terminal->cursor.attributes.background};
+     CeTerminalLine_t* line = terminal_line(terminal, cursor_line);
+     terminal_line_insert(line, src, n, terminal->columns, blank);
+     memmove(line->cells + dst, line->cells + src, (terminal->columns - dst) * sizeof(*line->cells));
 
      terminal_clear_region(terminal, src, terminal->cursor.y, dst - 1, terminal->cursor.y);
 }
@@ -274,24 +674,10 @@ static void terminal_put_newline(CeTerminal_t* terminal, bool first_column){
 static void terminal_set_glyph(CeTerminal_t* terminal, CeRune_t rune, CeTerminalGlyph_t* attributes, int x, int y){
      assert(x >= 0 && x < terminal->columns);
      assert(y >= 0 && y < terminal->rows);
-     y += terminal->start_line;
-     assert(ce_utf8_strlen(terminal->buffer->lines[y]) != -1);
-     terminal->lines[y][x] = *attributes;
-     char* str = ce_utf8_iterate_to(terminal->buffer->lines[y], x);
-     assert(str);
-     int64_t rune_len = ce_utf8_rune_len(rune);
-     int64_t replacing_len = 0;
-     ce_utf8_decode(str, &replacing_len);
-
-     // shift over line if necessary
-     if(rune_len != replacing_len){
-          char* dst = str + rune_len;
-          char* src = str + replacing_len;
-          memmove(dst, src, strlen(src) + 1); // include null terminator
-     }
-
-     ce_utf8_encode(rune, str, rune_len, &rune_len);
-     assert(ce_utf8_strlen(terminal->buffer->lines[y]) != -1);
+     CeTerminalLine_t* line = terminal_line(terminal, y + terminal->start_line);
+     terminal_line_set(line, x, x + 1, *attributes);
+     line->cells[x] = rune;
+     line->dirty = true;
 }
 
 static void terminal_cursor_save(CeTerminal_t* terminal){
@@ -306,10 +692,20 @@ static void terminal_cursor_load(CeTerminal_t* terminal){
 }
 
 static void terminal_swap_screen(CeTerminal_t* terminal){
-     CeTerminalGlyph_t** tmp_lines = terminal->lines;
+     if(terminal->mode & CE_TERMINAL_MODE_ALTSCREEN){
+          terminal->alternate_screen_left = terminal_seconds();
+     }else if(!terminal->alternate_screen.lines &&
+              !terminal_screen_alloc(terminal, &terminal->alternate_screen, terminal->rows)){
+          terminal_screen_free(&terminal->alternate_screen);
+          ce_log("%s() failed to allocate the alternate screen\n", __FUNCTION__);
+          return;
+     }
 
-     terminal->lines = terminal->alternate_lines;
-     terminal->alternate_lines = tmp_lines;
+     CeTerminalScreen_t tmp_screen = terminal->screen;
+
+     terminal->screen = terminal->alternate_screen;
+     terminal->alternate_screen = tmp_screen;
+     terminal->start_line = terminal->screen.count - terminal->rows;
 
      if(terminal->buffer == terminal->lines_buffer){
           terminal->buffer = terminal->alternate_lines_buffer;
@@ -327,29 +723,18 @@ static void terminal_delete_line(CeTerminal_t* terminal, int n){
 }
 
 static void terminal_delete_char(CeTerminal_t* terminal, int n){
-     int dst, src, size;
-     CeTerminalGlyph_t* line;
+     int dst, src;
 
      CE_CLAMP(n, 0, terminal->columns - terminal->cursor.x);
      int cursor_line = terminal->cursor.y + terminal->start_line;
 
      dst = terminal->cursor.x;
      src = terminal->cursor.x + n;
-     size = terminal->columns - src;
-     line = terminal->lines[cursor_line];
-
-     memmove(line + dst, line + src, size * sizeof(*line));
 
-     // figure out our start and end
-     char* line_dst = ce_utf8_iterate_to(terminal->buffer->lines[cursor_line], dst);
-     char* line_src = ce_utf8_iterate_to(terminal->buffer->lines[cursor_line], src);
-     assert(ce_utf8_strlen(terminal->buffer->lines[cursor_line]) != -1);
-
-     int64_t line_move_len = strlen(line_src);
-     memmove(line_dst, line_src, line_move_len);
-     memset(line_dst + line_move_len, ' ', n);
-     line_dst[line_move_len + n] = 0;
-     assert(ce_utf8_strlen(terminal->buffer->lines[cursor_line]) != -1);
+     CeTerminalGlyph_t blank = {0, terminal->cursor.attributes.foreground, terminal->cursor.attributes.background};
+     CeTerminalLine_t* line = terminal_line(terminal, cursor_line);
+     terminal_line_delete(line, dst, n, terminal->columns, blank);
+     memmove(line->cells + dst, line->cells + src, (terminal->columns - src) * sizeof(*line->cells));
 
      terminal_clear_region(terminal, terminal->columns - n, terminal->cursor.y, terminal->columns - 1, terminal->cursor.y);
 }
@@ -396,14 +781,17 @@ static void str_parse(CeTerminal_t* terminal){
 }
 
 static void str_sequence(CeTerminal_t* terminal, CeRune_t rune){
-     memset(&terminal->str_escape, 0, sizeof(terminal->str_escape));
+     CeTerminalSTREscape_t* str = &terminal->str_escape;
 
+     // the 8 bit controls stand in for ESC and a letter
      switch(rune){
      default:
           break;
      case 0x90:
           rune = 'P';
-          terminal->escape_state |= CE_TERMINAL_ESCAPE_STATE_DCS;
+          break;
+     case 0x98:
+          rune = 'X';
           break;
      case 0x9f:
           rune = '_';
@@ -416,14 +804,21 @@ static void str_sequence(CeTerminal_t* terminal, CeRune_t rune){
           break;
      }
 
-     terminal->str_escape.type = rune;
-     terminal->escape_state |= CE_TERMINAL_ESCAPE_STATE_STR;
+     str->type = rune;
+     str->buffer_length = 0;
+     str->argument_count = 0;
+}
+
+static void str_put(CeTerminal_t* terminal, CeRune_t rune){
+     CeTerminalSTREscape_t* str = &terminal->str_escape;
+     if(str->buffer_length + 1 >= (CE_TERMINAL_ESCAPE_BUFFER_SIZE - 1)) return;
+     str->buffer[str->buffer_length] = rune;
+     str->buffer_length++;
 }
 
 static void str_handle(CeTerminal_t* terminal){
      CeTerminalSTREscape_t* str = &terminal->str_escape;
 
-     terminal->escape_state &= ~(CE_TERMINAL_ESCAPE_STATE_STR_END | CE_TERMINAL_ESCAPE_STATE_STR);
      str_parse(terminal);
      int argument_count = str->argument_count;
      int param = argument_count ? atoi(str->arguments[0]) : 0;
@@ -449,7 +844,6 @@ static void str_handle(CeTerminal_t* terminal){
      case 'k':
           break;
      case 'P':
-          terminal->mode |= CE_TERMINAL_ESCAPE_STATE_DCS;
           break;
      case '_':
           break;
@@ -480,15 +874,7 @@ static void terminal_control_code(CeTerminal_t* terminal, CeRune_t rune){
           terminal_put_newline(terminal, terminal->mode & CE_TERMINAL_MODE_CRLF);
           return;
      case '\a': // BEL
-          if(terminal->escape_state & CE_TERMINAL_ESCAPE_STATE_STR_END){
-               str_handle(terminal);
-          }
           break;
-     case '\033': // ESC
-          csi_reset(&terminal->csi_escape);
-          terminal->escape_state &= ~(CE_TERMINAL_ESCAPE_STATE_CSI | CE_TERMINAL_ESCAPE_STATE_ALTCHARSET | CE_TERMINAL_ESCAPE_STATE_TEST);
-          terminal->escape_state |= CE_TERMINAL_ESCAPE_STATE_START;
-          return;
      case '\016': // SO
      case '\017': // SI
           // TODO
@@ -534,24 +920,12 @@ static void terminal_control_code(CeTerminal_t* terminal, CeRune_t rune){
      case 0x95: // MW
      case 0x96: // SPA
      case 0x97: // EPA
-     case 0x98: // SOS
      case 0x99: // SGCI
           break;
      case 0x9a: // DECID
           tty_write(terminal->file_descriptor, CE_TERMINAL_VT_IDENTIFIER, sizeof(CE_TERMINAL_VT_IDENTIFIER) - 1);
           break;
-     case 0x9b: // CSI
-     case 0x9c: // ST
-          break;
-     case 0x90: // DCS
-     case 0x9d: // OSC
-     case 0x9e: // PM
-     case 0x9f: // APC
-          str_sequence(terminal, rune);
-          return;
      }
-
-     terminal->escape_state &= ~(CE_TERMINAL_ESCAPE_STATE_STR_END | CE_TERMINAL_ESCAPE_STATE_STR);
 }
 
 static void terminal_set_mode(CeTerminal_t* terminal, bool set){
@@ -676,6 +1050,28 @@ static void terminal_set_mode(CeTerminal_t* terminal, bool set){
      }
 }
 
+// parses '5;index' or '2;r;g;b' after a 38 or 48, advancing the index passed the arguments used
+static bool terminal_extended_color(CeTerminalCSIEscape_t* csi, uint32_t* index, int32_t* color){
+     uint32_t i = *index;
+     if(i + 2 < csi->argument_count && csi->arguments[i + 1] == 5){
+          if(csi->arguments[i + 2] < 0 || csi->arguments[i + 2] > 255) return false;
+          *color = csi->arguments[i + 2];
+          *index = i + 2;
+          return true;
+     }
+
+     if(i + 4 < csi->argument_count && csi->arguments[i + 1] == 2){
+          for(uint32_t c = i + 2; c <= i + 4; c++){
+               if(csi->arguments[c] < 0 || csi->arguments[c] > 255) return false;
+          }
+          *color = CE_COLOR_RGB(csi->arguments[i + 2], csi->arguments[i + 3], csi->arguments[i + 4]);
+          *index = i + 4;
+          return true;
+     }
+
+     return false;
+}
+
 static void terminal_set_attributes(CeTerminal_t* terminal){
      CeTerminalCSIEscape_t* csi = &terminal->csi_escape;
 
@@ -764,8 +1160,11 @@ static void terminal_set_attributes(CeTerminal_t* terminal){
           case 37:
                terminal->cursor.attributes.foreground = COLOR_WHITE;
                break;
-          case 38: // TODO: reserved fg color
-               break;
+          case 38:
+          {
+               int32_t color;
+               if(terminal_extended_color(csi, &i, &color)) terminal->cursor.attributes.foreground = color;
+          } break;
           case 39:
                terminal->cursor.attributes.foreground = COLOR_DEFAULT;
                break;
@@ -793,8 +1192,11 @@ static void terminal_set_attributes(CeTerminal_t* terminal){
           case 47:
                terminal->cursor.attributes.background = COLOR_WHITE;
                break;
-          case 48: // TODO: reserved bg color
-               break;
+          case 48:
+          {
+               int32_t color;
+               if(terminal_extended_color(csi, &i, &color)) terminal->cursor.attributes.background = color;
+          } break;
           case 49:
                terminal->cursor.attributes.background = COLOR_DEFAULT;
                break;
@@ -850,40 +1252,6 @@ static void terminal_set_attributes(CeTerminal_t* terminal){
      }
 }
 
-static void csi_parse(CeTerminalCSIEscape_t* csi){
-     char* str = csi->buffer;
-     char* end = NULL;
-     long int value = 0;
-
-     csi->argument_count = 0;
-
-     if(*str == '?'){
-          csi->private = 1;
-          str++;
-     }
-
-     csi->buffer[csi->buffer_length] = 0;
-     while(str < (csi->buffer + csi->buffer_length)){
-          end = NULL;
-          value = strtol(str, &end, 10);
-
-          if(end == str) value = 0;
-          else if(value == LONG_MAX || value == LONG_MIN) value = -1;
-
-          csi->arguments[csi->argument_count] = value;
-          csi->argument_count++;
-
-          str = end;
-
-          if(*str != ';' || csi->argument_count == CE_TERMINAL_ESCAPE_ARGUMENT_SIZE) break;
-
-          str++;
-     }
-
-     csi->mode[0] = *str++;
-     csi->mode[1] = (str < (csi->buffer + csi->buffer_length)) ? *str : 0;
-}
-
 static void csi_handle(CeTerminal_t* terminal){
      CeTerminalCSIEscape_t* csi = &terminal->csi_escape;
 
@@ -1077,61 +1445,42 @@ static void terminal_reset(CeTerminal_t* terminal){
      for(int i = CE_TERMINAL_TAB_SPACES; i < terminal->columns; ++i) terminal->tabs[i] = 1;
      terminal->top = 0;
      terminal->bottom = terminal->rows - 1;
+     if(terminal->mode & CE_TERMINAL_MODE_ALTSCREEN) terminal_swap_screen(terminal);
      terminal->mode = CE_TERMINAL_MODE_WRAP | CE_TERMINAL_MODE_UTF8;
 
      //TODO: clear character translation table
      terminal->charset = 0;
-     terminal->escape_state = 0;
+     terminal->parser_state = CE_TERMINAL_PARSER_STATE_GROUND;
 
-     terminal_move_cursor_to(terminal, 0, 0);
-     terminal_cursor_save(terminal);
-     terminal_clear_region(terminal, 0, -terminal->start_line, terminal->columns - 1, terminal->rows - 1);
-     terminal_swap_screen(terminal);
+     // the screens are cleared with the cursor's colors, so reset them first
+     terminal->cursor.attributes.attributes = CE_TERMINAL_GLYPH_ATTRIBUTE_NONE;
+     terminal->cursor.attributes.foreground = COLOR_DEFAULT;
+     terminal->cursor.attributes.background = COLOR_DEFAULT;
 
      terminal_move_cursor_to(terminal, 0, 0);
-     terminal_cursor_save(terminal);
+     terminal->save_cursor[0] = terminal->cursor;
+     terminal->save_cursor[1] = terminal->cursor;
      terminal_clear_region(terminal, 0, -terminal->start_line, terminal->columns - 1, terminal->rows - 1);
-     terminal_swap_screen(terminal);
 
-     terminal->cursor.attributes.attributes = CE_TERMINAL_GLYPH_ATTRIBUTE_NONE;
-     terminal->cursor.attributes.foreground = COLOR_DEFAULT;
-     terminal->cursor.attributes.background = COLOR_DEFAULT;
+     // an alternate screen that isn't allocated yet starts out clear
+     if(terminal->alternate_screen.lines){
+          terminal_swap_screen(terminal);
+          terminal_clear_region(terminal, 0, -terminal->start_line, terminal->columns - 1, terminal->rows - 1);
+          terminal_swap_screen(terminal);
+     }
+
      terminal->cursor.state = CE_TERMINAL_CURSOR_STATE_DEFAULT;
      terminal->cursor.x = 0;
      terminal->cursor.y = 0;
 }
 
-static bool esc_handle(CeTerminal_t* terminal, CeRune_t rune){
+static void esc_handle(CeTerminal_t* terminal, CeRune_t rune){
      switch(rune) {
-     case '[':
-          terminal->escape_state |= CE_TERMINAL_ESCAPE_STATE_CSI;
-          return false;
-     case '#':
-          terminal->escape_state |= CE_TERMINAL_ESCAPE_STATE_TEST;
-          return false;
-     case '%':
-          terminal->escape_state |= CE_TERMINAL_ESCAPE_STATE_UTF8;
-          return false;
-     case 'P': // DCS -- Device Control String
-     case '_': // APC -- Application Program Command
-     case '^': // PM -- Privacy Message
-     case ']': // OSC -- Operating System Command
-     case 'k': // old title set compatibility
-          str_sequence(terminal, rune);
-          return false;
      case 'n': // LS2 -- Locking shift 2
      case 'o': // LS3 -- Locking shift 3
           // TODO
           //term.charset = 2 + (ascii - 'n');
           break;
-     case '(': // GZD4 -- set primary charset G0
-     case ')': // G1D4 -- set secondary charset G1
-     case '*': // G2D4 -- set tertiary charset G2
-     case '+': // G3D4 -- set quaternary charset G3
-          // TODO
-          //term.icharset = ascii - '(';
-          //term.esc |= ESC_ALTCHARSET;
-          return false;
      case 'D': // IND -- Linefeed
           if(terminal->cursor.y == terminal->bottom){
                terminal_scroll_up(terminal, terminal->top, 1);
@@ -1173,174 +1522,613 @@ static bool esc_handle(CeTerminal_t* terminal, CeRune_t rune){
           terminal_cursor_load(terminal);
           break;
      case '\\': // ST -- String Terminator
-          if(terminal->escape_state & CE_TERMINAL_ESCAPE_STATE_STR_END) str_handle(terminal);
+          // the string was handled when the ESC ended it
           break;
      default:
-          ce_log("%s(): unknown sequence ESC 0x%02X '%c' in sequence: '%s'\n", __FUNCTION__, (unsigned char)rune,
-                 isprint(rune) ? rune : '.', terminal->csi_escape.buffer);
+          ce_log("%s(): unknown sequence ESC 0x%02X '%c'\n", __FUNCTION__, (unsigned char)rune, isprint(rune) ? rune : '.');
           break;
      }
+}
 
-     return true;
+static void esc_dispatch(CeTerminal_t* terminal, CeRune_t rune){
+     CeTerminalCSIEscape_t* csi = &terminal->csi_escape;
+     if(csi->intermediate_count == 0){
+          esc_handle(terminal, rune);
+          return;
+     }
+
+     switch(csi->intermediates[0]){
+     default:
+          ce_log("%s(): unknown sequence ESC '%c' '%c'\n", __FUNCTION__, csi->intermediates[0], isprint(rune) ? rune : '.');
+          break;
+     case '%': // select the character set
+          if(rune == 'G'){
+               terminal->mode |= CE_TERMINAL_MODE_UTF8;
+          }else if(rune == '@'){
+               terminal->mode &= ~CE_TERMINAL_MODE_UTF8;
+          }
+          break;
+     case '(': // GZD4 -- set primary charset G0
+     case ')': // G1D4 -- set secondary charset G1
+     case '*': // G2D4 -- set tertiary charset G2
+     case '+': // G3D4 -- set quaternary charset G3
+          // TODO
+          //term.icharset = ascii - '(';
+          break;
+     case '#': // DECALN and the double width and height lines
+          // TODO
+          break;
+     }
 }
 
-static void terminal_put(CeTerminal_t* terminal, CeRune_t rune){
-     char characters[CE_UTF8_SIZE];
-     int width = 1;
-     int64_t len = 0;
+static void csi_param(CeTerminalCSIEscape_t* csi, CeRune_t rune){
+     csi_buffer_add(csi, rune);
+     if(csi->argument_count >= CE_TERMINAL_ESCAPE_ARGUMENT_SIZE) return;
 
-     if(terminal->mode & CE_TERMINAL_MODE_UTF8){
-          ce_utf8_encode(rune, characters, CE_UTF8_SIZE, &len);
+     if(rune == ';'){
+          csi->argument_count++;
      }else{
-          characters[0] = rune;
-          width = 1;
+          int* argument = csi->arguments + csi->argument_count;
+          if(*argument < CE_TERMINAL_ESCAPE_ARGUMENT_MAX) *argument = (*argument * 10) + (rune - '0');
      }
+}
 
-     if(terminal->escape_state & CE_TERMINAL_ESCAPE_STATE_STR){
-          if(rune == '\a' || rune == 030 || rune == 032 || rune == 033 || is_controller_c1(rune)){
-               terminal->escape_state &= ~(CE_TERMINAL_ESCAPE_STATE_START | CE_TERMINAL_ESCAPE_STATE_STR |
-                                           CE_TERMINAL_ESCAPE_STATE_DCS);
-               if(terminal->mode & CE_TERMINAL_MODE_SIXEL){
-                    CHANGE_BIT(terminal->mode, 0, CE_TERMINAL_MODE_SIXEL);
-                    return;
-               }
+static void csi_collect(CeTerminalCSIEscape_t* csi, CeTerminalParserState_t state, CeRune_t rune){
+     csi_buffer_add(csi, rune);
+     if(rune == '?' && state == CE_TERMINAL_PARSER_STATE_CSI_ENTRY){
+          csi->private = 1;
+     }else if(csi->intermediate_count < CE_TERMINAL_ESCAPE_INTERMEDIATE_SIZE){
+          csi->intermediates[csi->intermediate_count] = rune;
+          csi->intermediate_count++;
+     }
+}
 
-               terminal->escape_state |= CE_TERMINAL_ESCAPE_STATE_STR_END;
-          }else{
-               if(terminal->mode & CE_TERMINAL_MODE_SIXEL){
-                    return;
-               }
+static void csi_dispatch(CeTerminal_t* terminal, CeRune_t rune){
+     CeTerminalCSIEscape_t* csi = &terminal->csi_escape;
+     csi_buffer_add(csi, rune);
+     csi->buffer[csi->buffer_length] = 0;
 
-               if(terminal->escape_state & CE_TERMINAL_ESCAPE_STATE_DCS && terminal->str_escape.buffer_length == 0 &&
-                  rune == 'q'){
-                    terminal->mode |= CE_TERMINAL_MODE_SIXEL;
-               }
+     // there is always at least one argument, even if it is empty
+     if(csi->argument_count < CE_TERMINAL_ESCAPE_ARGUMENT_SIZE) csi->argument_count++;
+     csi->mode[0] = rune;
 
-               if(terminal->str_escape.buffer_length + 1 >= (CE_TERMINAL_ESCAPE_BUFFER_SIZE - 1)){
-                    return;
-               }
+     // we don't handle any sequences with intermediates or private markers besides '?'
+     if(csi->intermediate_count > 0){
+          ce_log("unhandled csi: '%c' in sequence: '%s'\n", rune, csi->buffer);
+          return;
+     }
 
-               terminal->str_escape.buffer[terminal->str_escape.buffer_length] = rune;
-               terminal->str_escape.buffer_length++;
-               return;
-          }
+     csi_handle(terminal);
+}
+
+static void terminal_print(CeTerminal_t* terminal, CeRune_t rune){
+     int width = 1;
+
+     if(terminal->mode & CE_TERMINAL_MODE_WRAP && terminal->cursor.state & CE_TERMINAL_CURSOR_STATE_WRAPNEXT){
+          terminal_line(terminal, terminal->cursor.y + terminal->start_line)->wrapped = true;
+          terminal_put_newline(terminal, true);
      }
 
-     if(is_controller(rune)){
+     if(terminal->mode & CE_TERMINAL_MODE_INSERT && (terminal->cursor.x + width) < terminal->columns){
+          CeTerminalLine_t* line = terminal_line(terminal, terminal->cursor.y + terminal->start_line);
+          int32_t x = terminal->cursor.x;
+          terminal_line_insert(line, x, width, terminal->columns, terminal->cursor.attributes);
+          memmove(line->cells + x + width, line->cells + x, (terminal->columns - (x + width)) * sizeof(*line->cells));
+     }
+
+     if(terminal->cursor.x + width > terminal->columns){
+          terminal_put_newline(terminal, true);
+     }
+
+     terminal_set_glyph(terminal, rune, &terminal->cursor.attributes, terminal->cursor.x, terminal->cursor.y);
+
+     if(terminal->cursor.x + width < terminal->columns){
+          terminal_move_cursor_to(terminal, terminal->cursor.x + width, terminal->cursor.y);
+     }else{
+          terminal->cursor.state |= CE_TERMINAL_CURSOR_STATE_WRAPNEXT;
+     }
+}
+
+typedef enum{
+     CE_TERMINAL_PARSER_ACTION_NONE,
+     CE_TERMINAL_PARSER_ACTION_PRINT,
+     CE_TERMINAL_PARSER_ACTION_EXECUTE,
+     CE_TERMINAL_PARSER_ACTION_CLEAR,
+     CE_TERMINAL_PARSER_ACTION_COLLECT,
+     CE_TERMINAL_PARSER_ACTION_PARAM,
+     CE_TERMINAL_PARSER_ACTION_ESC_DISPATCH,
+     CE_TERMINAL_PARSER_ACTION_CSI_DISPATCH,
+     CE_TERMINAL_PARSER_ACTION_STRING_START,
+     CE_TERMINAL_PARSER_ACTION_STRING_PUT,
+}CeTerminalParserAction_t;
+
+// every rune below 0xA0 has its own column in the table, everything after shares the last one
+#define PARSER_RUNE_OTHER 0xA0
+#define TRANSITION(action, state) (uint8_t)((CE_TERMINAL_PARSER_ACTION_##action << 4) | CE_TERMINAL_PARSER_STATE_##state)
+
+// C0 controls are run in place, except for the ones every state handles the same way below
+#define PARSER_C0(action, state)                \
+     [0x00 ... 0x17] = TRANSITION(action, state), \
+     [0x19] = TRANSITION(action, state),          \
+     [0x1C ... 0x1F] = TRANSITION(action, state)
+
+// CAN, SUB, ESC and the C1 controls end whatever sequence they show up in
+#define PARSER_ANYWHERE                               \
+     [0x18] = TRANSITION(EXECUTE, GROUND),            \
+     [0x1A] = TRANSITION(EXECUTE, GROUND),            \
+     [0x1B] = TRANSITION(CLEAR, ESCAPE),              \
+     [0x80 ... 0x8F] = TRANSITION(EXECUTE, GROUND),   \
+     [0x90] = TRANSITION(STRING_START, STRING),       \
+     [0x91 ... 0x97] = TRANSITION(EXECUTE, GROUND),   \
+     [0x98] = TRANSITION(STRING_START, STRING),       \
+     [0x99 ... 0x9A] = TRANSITION(EXECUTE, GROUND),   \
+     [0x9B] = TRANSITION(CLEAR, CSI_ENTRY),           \
+     [0x9C] = TRANSITION(NONE, GROUND),               \
+     [0x9D ... 0x9F] = TRANSITION(STRING_START, STRING)
+
+static const uint8_t g_parser_transitions[CE_TERMINAL_PARSER_STATE_COUNT][PARSER_RUNE_OTHER + 1] = {
+     [CE_TERMINAL_PARSER_STATE_GROUND] = {
+          PARSER_C0(EXECUTE, GROUND),
+          [0x20 ... 0x7E] = TRANSITION(PRINT, GROUND),
+          [0x7F] = TRANSITION(NONE, GROUND),
+          [PARSER_RUNE_OTHER] = TRANSITION(PRINT, GROUND),
+          PARSER_ANYWHERE,
+     },
+     [CE_TERMINAL_PARSER_STATE_ESCAPE] = {
+          PARSER_C0(EXECUTE, ESCAPE),
+          [0x20 ... 0x2F] = TRANSITION(COLLECT, ESCAPE_INTERMEDIATE),
+          [0x30 ... 0x4F] = TRANSITION(ESC_DISPATCH, GROUND),
+          [0x50] = TRANSITION(STRING_START, STRING), // DCS
+          [0x51 ... 0x57] = TRANSITION(ESC_DISPATCH, GROUND),
+          [0x58] = TRANSITION(STRING_START, STRING), // SOS
+          [0x59 ... 0x5A] = TRANSITION(ESC_DISPATCH, GROUND),
+          [0x5B] = TRANSITION(NONE, CSI_ENTRY),
+          [0x5C] = TRANSITION(ESC_DISPATCH, GROUND),
+          [0x5D ... 0x5F] = TRANSITION(STRING_START, STRING), // OSC, PM and APC
+          [0x60 ... 0x6A] = TRANSITION(ESC_DISPATCH, GROUND),
+          [0x6B] = TRANSITION(STRING_START, STRING), // the old way to set the title
+          [0x6C ... 0x7E] = TRANSITION(ESC_DISPATCH, GROUND),
+          [0x7F] = TRANSITION(NONE, ESCAPE),
+          [PARSER_RUNE_OTHER] = TRANSITION(NONE, GROUND),
+          PARSER_ANYWHERE,
+     },
+     [CE_TERMINAL_PARSER_STATE_ESCAPE_INTERMEDIATE] = {
+          PARSER_C0(EXECUTE, ESCAPE_INTERMEDIATE),
+          [0x20 ... 0x2F] = TRANSITION(COLLECT, ESCAPE_INTERMEDIATE),
+          [0x30 ... 0x7E] = TRANSITION(ESC_DISPATCH, GROUND),
+          [0x7F] = TRANSITION(NONE, ESCAPE_INTERMEDIATE),
+          [PARSER_RUNE_OTHER] = TRANSITION(NONE, GROUND),
+          PARSER_ANYWHERE,
+     },
+     [CE_TERMINAL_PARSER_STATE_CSI_ENTRY] = {
+          PARSER_C0(EXECUTE, CSI_ENTRY),
+          [0x20 ... 0x2F] = TRANSITION(COLLECT, CSI_INTERMEDIATE),
+          [0x30 ... 0x39] = TRANSITION(PARAM, CSI_PARAM),
+          [0x3A] = TRANSITION(NONE, CSI_IGNORE),
+          [0x3B] = TRANSITION(PARAM, CSI_PARAM),
+          [0x3C ... 0x3F] = TRANSITION(COLLECT, CSI_PARAM),
+          [0x40 ... 0x7E] = TRANSITION(CSI_DISPATCH, GROUND),
+          [0x7F] = TRANSITION(NONE, CSI_ENTRY),
+          [PARSER_RUNE_OTHER] = TRANSITION(NONE, CSI_IGNORE),
+          PARSER_ANYWHERE,
+     },
+     [CE_TERMINAL_PARSER_STATE_CSI_PARAM] = {
+          PARSER_C0(EXECUTE, CSI_PARAM),
+          [0x20 ... 0x2F] = TRANSITION(COLLECT, CSI_INTERMEDIATE),
+          [0x30 ... 0x39] = TRANSITION(PARAM, CSI_PARAM),
+          [0x3A] = TRANSITION(NONE, CSI_IGNORE),
+          [0x3B] = TRANSITION(PARAM, CSI_PARAM),
+          [0x3C ... 0x3F] = TRANSITION(NONE, CSI_IGNORE),
+          [0x40 ... 0x7E] = TRANSITION(CSI_DISPATCH, GROUND),
+          [0x7F] = TRANSITION(NONE, CSI_PARAM),
+          [PARSER_RUNE_OTHER] = TRANSITION(NONE, CSI_IGNORE),
+          PARSER_ANYWHERE,
+     },
+     [CE_TERMINAL_PARSER_STATE_CSI_INTERMEDIATE] = {
+          PARSER_C0(EXECUTE, CSI_INTERMEDIATE),
+          [0x20 ... 0x2F] = TRANSITION(COLLECT, CSI_INTERMEDIATE),
+          [0x30 ... 0x3F] = TRANSITION(NONE, CSI_IGNORE),
+          [0x40 ... 0x7E] = TRANSITION(CSI_DISPATCH, GROUND),
+          [0x7F] = TRANSITION(NONE, CSI_INTERMEDIATE),
+          [PARSER_RUNE_OTHER] = TRANSITION(NONE, CSI_IGNORE),
+          PARSER_ANYWHERE,
+     },
+     [CE_TERMINAL_PARSER_STATE_CSI_IGNORE] = {
+          PARSER_C0(EXECUTE, CSI_IGNORE),
+          [0x20 ... 0x3F] = TRANSITION(NONE, CSI_IGNORE),
+          [0x40 ... 0x7E] = TRANSITION(NONE, GROUND),
+          [0x7F] = TRANSITION(NONE, CSI_IGNORE),
+          [PARSER_RUNE_OTHER] = TRANSITION(NONE, CSI_IGNORE),
+          PARSER_ANYWHERE,
+     },
+     [CE_TERMINAL_PARSER_STATE_STRING] = {
+          [0x00 ... 0x06] = TRANSITION(NONE, STRING),
+          [0x07] = TRANSITION(NONE, GROUND), // BEL ends strings like ST
+          [0x08 ... 0x17] = TRANSITION(NONE, STRING),
+          [0x19] = TRANSITION(NONE, STRING),
+          [0x1C ... 0x1F] = TRANSITION(NONE, STRING),
+          [0x20 ... 0x7F] = TRANSITION(STRING_PUT, STRING),
+          [PARSER_RUNE_OTHER] = TRANSITION(STRING_PUT, STRING),
+          PARSER_ANYWHERE,
+     },
+};
+
+static void terminal_put(CeTerminal_t* terminal, CeRune_t rune){
+     CeTerminalParserState_t state = terminal->parser_state;
+     uint8_t transition = g_parser_transitions[state][((uint32_t)(rune) < PARSER_RUNE_OTHER) ? rune : PARSER_RUNE_OTHER];
+     CeTerminalParserState_t next_state = transition & 0x0F;
+
+     // leaving a string is what ends it, however it ended
+     if(state == CE_TERMINAL_PARSER_STATE_STRING && next_state != CE_TERMINAL_PARSER_STATE_STRING) str_handle(terminal);
+
+     // set the state first, some actions reset the terminal which puts it back in the ground state
+     terminal->parser_state = next_state;
+
+     switch((CeTerminalParserAction_t)(transition >> 4)){
+     case CE_TERMINAL_PARSER_ACTION_NONE:
+          break;
+     case CE_TERMINAL_PARSER_ACTION_PRINT:
+          terminal_print(terminal, rune);
+          break;
+     case CE_TERMINAL_PARSER_ACTION_EXECUTE:
           terminal_control_code(terminal, rune);
-          return;
+          break;
+     case CE_TERMINAL_PARSER_ACTION_CLEAR:
+          csi_reset(&terminal->csi_escape);
+          break;
+     case CE_TERMINAL_PARSER_ACTION_COLLECT:
+          csi_collect(&terminal->csi_escape, state, rune);
+          break;
+     case CE_TERMINAL_PARSER_ACTION_PARAM:
+          csi_param(&terminal->csi_escape, rune);
+          break;
+     case CE_TERMINAL_PARSER_ACTION_ESC_DISPATCH:
+          esc_dispatch(terminal, rune);
+          break;
+     case CE_TERMINAL_PARSER_ACTION_CSI_DISPATCH:
+          csi_dispatch(terminal, rune);
+          break;
+     case CE_TERMINAL_PARSER_ACTION_STRING_START:
+          str_sequence(terminal, rune);
+          break;
+     case CE_TERMINAL_PARSER_ACTION_STRING_PUT:
+          str_put(terminal, rune);
+          break;
      }
+}
+
+static bool is_printable_ascii(char c){
+     return c >= 0x20 && c < 0x7f;
+}
 
-     if(terminal->escape_state & CE_TERMINAL_ESCAPE_STATE_START){
-          if(terminal->escape_state & CE_TERMINAL_ESCAPE_STATE_CSI){
-               CeTerminalCSIEscape_t* csi = &terminal->csi_escape;
-               csi->buffer[csi->buffer_length] = rune;
-               csi->buffer_length++;
+// how much of the start of bytes is printable ascii, checked 8 bytes at a time. a byte's high bit is set in below if it
+// is under 0x20 and in above if it is 0x7f or more, only whether any byte is set matters, the bytes after it are checked
+// one at a time
+static int64_t printable_ascii_length(const char* bytes, int64_t len){
+     const uint64_t ones = 0x0101010101010101ULL;
+     const uint64_t highs = 0x8080808080808080ULL;
+     int64_t i = 0;
+     for(; i + 8 <= len; i += 8){
+          uint64_t word;
+          memcpy(&word, bytes + i, sizeof(word));
+          uint64_t below = (word - ones * 0x20) & ~word & highs;
+          uint64_t above = ((word + ones) | word) & highs;
+          if(below | above) break;
+     }
+     while(i < len && is_printable_ascii(bytes[i])) i++;
+     return i;
+}
 
-               if(BETWEEN(rune, 0x40, 0x7E) || csi->buffer_length >= (CE_TERMINAL_ESCAPE_BUFFER_SIZE - 1)){
-                    terminal->escape_state = 0;
-                    csi_parse(csi);
-                    csi_handle(terminal);
-               }
+// decodes the rune at the start of bytes and returns how many bytes it used, or 0 if the sequence runs past the end.
+// sequences that are malformed, overlong, surrogates or past the last code point become the replacement character, a
+// sequence cut short by a byte that doesn't continue it only uses the bytes before that byte
+static int64_t terminal_utf8_decode(const char* bytes, int64_t len, CeRune_t* rune){
+     unsigned char lead = bytes[0];
+     int64_t length = 1;
+     CeRune_t min = 0;
+
+     if(lead < 0x80){
+          *rune = lead;
+          return 1;
+     }else if((lead & 0xE0) == 0xC0){
+          length = 2;
+          min = 0x80;
+          *rune = lead & 0x1F;
+     }else if((lead & 0xF0) == 0xE0){
+          length = 3;
+          min = 0x800;
+          *rune = lead & 0x0F;
+     }else if((lead & 0xF8) == 0xF0){
+          length = 4;
+          min = 0x10000;
+          *rune = lead & 0x07;
+     }else{
+          *rune = CE_TERMINAL_REPLACEMENT_RUNE;
+          return 1;
+     }
 
-               return;
-          }else if(terminal->escape_state & CE_TERMINAL_ESCAPE_STATE_UTF8){
-               if(rune == 'G'){
-                    terminal->mode |= CE_TERMINAL_MODE_UTF8;
-               }else if(rune == '@'){
-                    terminal->mode &= ~CE_TERMINAL_MODE_UTF8;
-               }
-          }else if(terminal->escape_state & CE_TERMINAL_ESCAPE_STATE_ALTCHARSET){
-               // TODO
-          }else if(terminal->escape_state & CE_TERMINAL_ESCAPE_STATE_TEST){
-               // TODO
-          }else{
-               if(!esc_handle(terminal, rune)) return;
+     for(int64_t i = 1; i < length; i++){
+          if(i >= len) return 0;
+          if((bytes[i] & 0xC0) != 0x80){
+               *rune = CE_TERMINAL_REPLACEMENT_RUNE;
+               return i;
           }
-
-          terminal->escape_state = 0;
-          return;
+          *rune = (*rune << 6) | (bytes[i] & 0x3F);
      }
 
-     CeTerminalGlyph_t* current_glyph = terminal->lines[terminal->cursor.y] + terminal->cursor.x;
+     if(*rune < min || *rune > 0x10FFFF || (*rune >= 0xD800 && *rune <= 0xDFFF)) *rune = CE_TERMINAL_REPLACEMENT_RUNE;
+     return length;
+}
+
+// writes printable ascii outside of any escape sequence, which is most of what programs print, straight into the line
+// instead of one rune at a time, stops at the end of the line and returns how many characters were written
+static int64_t terminal_put_ascii_run(CeTerminal_t* terminal, const char* run, int64_t len){
      if(terminal->mode & CE_TERMINAL_MODE_WRAP && terminal->cursor.state & CE_TERMINAL_CURSOR_STATE_WRAPNEXT){
-          current_glyph->attributes |= CE_TERMINAL_GLYPH_ATTRIBUTE_WRAP;
+          terminal_line(terminal, terminal->cursor.y + terminal->start_line)->wrapped = true;
           terminal_put_newline(terminal, true);
-          current_glyph = terminal->lines[terminal->cursor.y] + terminal->cursor.x;
      }
 
-     if(terminal->mode & CE_TERMINAL_MODE_INSERT && (terminal->cursor.x + width) < terminal->columns){
-          int size = (terminal->columns - terminal->cursor.x - width);
-          memmove(current_glyph + width, current_glyph, size * sizeof(*current_glyph));
+     // without wrapping, each character overwrites the last column
+     if(terminal->cursor.state & CE_TERMINAL_CURSOR_STATE_WRAPNEXT){
+          terminal_put(terminal, run[0]);
+          return 1;
+     }
+
+     int32_t x = terminal->cursor.x;
+     int64_t count = terminal->columns - x;
+     if(count > len) count = len;
+
+     CeTerminalLine_t* line = terminal_line(terminal, terminal->cursor.y + terminal->start_line);
+     for(int64_t i = 0; i < count; i++) line->cells[x + i] = (unsigned char)(run[i]);
+     line->dirty = true;
+     terminal_line_set(line, x, x + count, terminal->cursor.attributes);
+
+     if(x + count < terminal->columns){
+          terminal_move_cursor_to(terminal, x + count, terminal->cursor.y);
+     }else{
+          terminal_move_cursor_to(terminal, terminal->columns - 1, terminal->cursor.y);
+          terminal->cursor.state |= CE_TERMINAL_CURSOR_STATE_WRAPNEXT;
+     }
 
-          // TODO: compress with similar code above
-          char* line_src = ce_utf8_iterate_to(terminal->buffer->lines[terminal->cursor.y + terminal->start_line], terminal->cursor.x);
-          char* line_dst = line_src + width;
+     return count;
+}
 
-          assert(ce_utf8_strlen(terminal->buffer->lines[terminal->cursor.y + terminal->start_line]) != -1);
+// call with the lock held
+static void terminal_capture_close(CeTerminal_t* terminal){
+     if(!terminal->capture) return;
+     fclose(terminal->capture);
+     terminal->capture = NULL;
+}
 
-          int64_t line_move_len = strlen(line_src); // include null terminator
-          memmove(line_dst, line_src, line_move_len);
-          line_dst[line_move_len] = 0;
+// call with the lock held, the capture stops if it can't be written to
+static void terminal_capture_record(CeTerminal_t* terminal, CeTerminalCaptureRecordType_t type, const void* bytes, int64_t len){
+     do{
+          int32_t record_len = (len > INT32_MAX) ? INT32_MAX : len;
+          CeTerminalCaptureRecord_t record = {terminal_nanoseconds() - terminal->capture_start, type, record_len};
+          if(fwrite(&record, sizeof(record), 1, terminal->capture) != 1 ||
+             fwrite(bytes, 1, record_len, terminal->capture) != (size_t)(record_len)){
+               ce_log("%s() failed to write capture: %s\n", __FUNCTION__, strerror(errno));
+               terminal_capture_close(terminal);
+               return;
+          }
+          bytes = (const char*)(bytes) + record_len;
+          len -= record_len;
+     }while(len > 0);
+}
 
-          assert(ce_utf8_strlen(terminal->buffer->lines[terminal->cursor.y + terminal->start_line]) != -1);
+bool ce_terminal_capture_start(CeTerminal_t* terminal, const char* filepath){
+     FILE* file = fopen(filepath, "wb");
+     if(!file){
+          ce_log("%s() failed to open '%s': %s\n", __FUNCTION__, filepath, strerror(errno));
+          return false;
      }
 
-     assert(ce_utf8_strlen(terminal->buffer->lines[terminal->cursor.y + terminal->start_line]) != -1);
+     pthread_mutex_lock(&terminal->lock);
+     CeTerminalCaptureHeader_t header = {};
+     memcpy(header.magic, CE_TERMINAL_CAPTURE_MAGIC, sizeof(header.magic));
+     header.columns = terminal->columns;
+     header.rows = terminal->rows;
+     bool success = fwrite(&header, sizeof(header), 1, file) == 1;
+     if(success){
+          terminal_capture_close(terminal);
+          terminal->capture = file;
+          terminal->capture_start = terminal_nanoseconds();
+     }
+     pthread_mutex_unlock(&terminal->lock);
 
-     if(terminal->cursor.x + width > terminal->columns){
-          terminal_put_newline(terminal, true);
+     if(!success){
+          ce_log("%s() failed to write '%s': %s\n", __FUNCTION__, filepath, strerror(errno));
+          fclose(file);
      }
+     return success;
+}
 
-     assert(ce_utf8_strlen(terminal->buffer->lines[terminal->cursor.y + terminal->start_line]) != -1);
-     terminal_set_glyph(terminal, rune, &terminal->cursor.attributes, terminal->cursor.x, terminal->cursor.y);
-     assert(ce_utf8_strlen(terminal->buffer->lines[terminal->cursor.y + terminal->start_line]) != -1);
+void ce_terminal_capture_stop(CeTerminal_t* terminal){
+     pthread_mutex_lock(&terminal->lock);
+     terminal_capture_close(terminal);
+     pthread_mutex_unlock(&terminal->lock);
+}
 
-     if(terminal->cursor.x + width < terminal->columns){
-          terminal_move_cursor_to(terminal, terminal->cursor.x + width, terminal->cursor.y);
-     }else{
-          terminal->cursor.state |= CE_TERMINAL_CURSOR_STATE_WRAPNEXT;
+void ce_terminal_write_output(CeTerminal_t* terminal, const char* bytes, int64_t len){
+     CeRune_t decoded = CE_UTF8_INVALID;
+     int64_t i = 0;
+
+     pthread_mutex_lock(&terminal->lock);
+     if(terminal->capture) terminal_capture_record(terminal, CE_TERMINAL_CAPTURE_RECORD_OUTPUT, bytes, len);
+
+     // finish the sequence the last output ended in the middle of
+     if(terminal->utf8_pending_length > 0){
+          char sequence[CE_UTF8_SIZE];
+          int64_t pending_length = terminal->utf8_pending_length;
+          int64_t copied = CE_UTF8_SIZE - pending_length;
+          if(copied > len) copied = len;
+          memcpy(sequence, terminal->utf8_pending, pending_length);
+          memcpy(sequence + pending_length, bytes, copied);
+
+          int64_t decoded_length = terminal_utf8_decode(sequence, pending_length + copied, &decoded);
+          if(decoded_length == 0){
+               memcpy(terminal->utf8_pending + pending_length, bytes, copied);
+               terminal->utf8_pending_length += copied;
+               i = len;
+          }else{
+               terminal_put(terminal, decoded);
+               terminal->utf8_pending_length = 0;
+               i = decoded_length - pending_length;
+          }
+     }
+
+     while(i < len){
+          if(terminal->parser_state == CE_TERMINAL_PARSER_STATE_GROUND && !(terminal->mode & CE_TERMINAL_MODE_INSERT) &&
+             is_printable_ascii(bytes[i])){
+               int64_t run_len = printable_ascii_length(bytes + i, len - i);
+               while(run_len > 0){
+                    int64_t written = terminal_put_ascii_run(terminal, bytes + i, run_len);
+                    i += written;
+                    run_len -= written;
+               }
+               continue;
+          }
+
+          int64_t decoded_length = terminal_utf8_decode(bytes + i, len - i, &decoded);
+          if(decoded_length == 0){
+               terminal->utf8_pending_length = len - i;
+               memcpy(terminal->utf8_pending, bytes + i, terminal->utf8_pending_length);
+               break;
+          }
+          terminal_put(terminal, decoded);
+          i += decoded_length;
+     }
+
+     terminal->buffer->version++;
+     pthread_mutex_unlock(&terminal->lock);
+}
+
+// one thread reads every terminal's tty, it sleeps in epoll_wait() until one of them has output
+typedef struct{
+     pthread_mutex_t lock; // held while handling output, so a terminal isn't freed while we read it
+     pthread_t thread;
+     int epoll_file_descriptor; // -1 until the first terminal starts the thread
+     int64_t removed; // counts terminals we stopped reading, events waited on before then may point at freed terminals
+}CeTerminalReader_t;
+
+static CeTerminalReader_t g_terminal_reader = {PTHREAD_MUTEX_INITIALIZER, 0, -1, 0};
+
+// returns whether the terminal changed, reads are sized to how much the last one found, up to CE_TERMINAL_READ_MAX_SIZE
+static bool tty_read(CeTerminalReader_t* reader, CeTerminal_t* terminal, char* buffer){
+     ssize_t rc = read(terminal->file_descriptor, buffer, terminal->read_size);
+
+     if(rc < 0 && (errno == EINTR || errno == EAGAIN)) return false;
+     if(rc <= 0){
+          // the tty reports EIO once the shell exits
+          if(rc < 0 && errno != EIO){
+               ce_log("%s() failed to read from tty file descriptor: '%s'\n", __FUNCTION__, strerror(errno));
+          }
+          epoll_ctl(reader->epoll_file_descriptor, EPOLL_CTL_DEL, terminal->file_descriptor, NULL);
+          __atomic_store_n(&terminal->killed, true, __ATOMIC_RELEASE);
+          return true;
+     }
+
+     if(rc == terminal->read_size && terminal->read_size < CE_TERMINAL_READ_MAX_SIZE){
+          terminal->read_size *= 2;
+     }else if(rc < terminal->read_size / 4 && terminal->read_size > CE_TERMINAL_READ_MIN_SIZE){
+          terminal->read_size /= 2;
      }
+
+     ce_terminal_write_output(terminal, buffer, rc);
+     return true;
 }
 
 static void* tty_reader(void* data){
-     CeTerminal_t* terminal = (CeTerminal_t*)(data);
+     CeTerminalReader_t* reader = (CeTerminalReader_t*)(data);
+     struct epoll_event events[CE_TERMINAL_READER_EVENT_COUNT];
 
-     char buffer[BUFSIZ];
-     int buffer_length = 0;
-     CeRune_t decoded = CE_UTF8_INVALID;
-     int64_t decoded_length = 0;
+     char* buffer = malloc(CE_TERMINAL_READ_MAX_SIZE);
+     if(!buffer){
+          ce_log("%s() failed to allocate read buffer\n", __FUNCTION__);
+          return NULL;
+     }
 
+     pthread_mutex_lock(&reader->lock);
      while(true){
-          int rc = read(terminal->file_descriptor, buffer, ELEM_COUNT(buffer));
+          int64_t removed = reader->removed;
+          pthread_mutex_unlock(&reader->lock);
 
-          if(rc < 0){
-               ce_log("%s() failed to read from tty file descriptor: '%s'\n", __FUNCTION__, strerror(errno));
-               terminal->killed = true;
-               return NULL;
-          }else if(rc > 0){
-               buffer_length = rc;
-
-               for(int i = 0; i < buffer_length; ++i){
-                    decoded = ce_utf8_decode(buffer + i, &decoded_length);
-                    if(decoded == CE_UTF8_INVALID) break;
-                    terminal_put(terminal, decoded);
-                    i += (decoded_length - 1);
-               }
+          int event_count = epoll_wait(reader->epoll_file_descriptor, events, CE_TERMINAL_READER_EVENT_COUNT, -1);
 
-               rc = write(g_terminal_ready_fds[1], "1", 2);
-               if(rc < 0){
-                    ce_log("%s() write() to terminal ready fd failed: %s", __FUNCTION__, strerror(errno));
-                    return false;
-               }
+          pthread_mutex_lock(&reader->lock);
+          if(event_count < 0){
+               if(errno == EINTR) continue;
+               ce_log("%s() epoll_wait() failed: '%s'\n", __FUNCTION__, strerror(errno));
+               break;
           }
 
-          sleep(0);
+          // the events are level triggered, so if a terminal was freed we drop them all and the rest are reported again
+          if(reader->removed != removed) continue;
+
+          // the main loop clears ready_to_draw before it draws, so however many terminals changed it is woken once per frame
+          bool wake = false;
+          for(int i = 0; i < event_count; i++){
+               CeTerminal_t* terminal = events[i].data.ptr;
+               if(!tty_read(reader, terminal, buffer)) continue;
+               if(!__atomic_exchange_n(&terminal->ready_to_draw, true, __ATOMIC_ACQ_REL)) wake = true;
+          }
+
+          if(wake && write(g_terminal_ready_fds[1], "1", 1) < 0){
+               ce_log("%s() write() to terminal ready fd failed: %s", __FUNCTION__, strerror(errno));
+          }
      }
+     pthread_mutex_unlock(&reader->lock);
 
+     free(buffer);
      return NULL;
 }
 
+static bool tty_reader_add(CeTerminal_t* terminal){
+     CeTerminalReader_t* reader = &g_terminal_reader;
+     bool success = false;
+
+     pthread_mutex_lock(&reader->lock);
+     if(reader->epoll_file_descriptor < 0){
+          reader->epoll_file_descriptor = epoll_create1(EPOLL_CLOEXEC);
+          if(reader->epoll_file_descriptor < 0){
+               ce_log("epoll_create1() failed: '%s'\n", strerror(errno));
+          }else{
+               int rc = pthread_create(&reader->thread, NULL, tty_reader, reader);
+               if(rc != 0){
+                    ce_log("pthread_create() failed: '%s'\n", strerror(rc));
+                    close(reader->epoll_file_descriptor);
+                    reader->epoll_file_descriptor = -1;
+               }
+          }
+     }
+
+     if(reader->epoll_file_descriptor >= 0){
+          struct epoll_event event = {};
+          event.events = EPOLLIN;
+          event.data.ptr = terminal;
+          if(epoll_ctl(reader->epoll_file_descriptor, EPOLL_CTL_ADD, terminal->file_descriptor, &event) < 0){
+               ce_log("epoll_ctl() failed to add terminal: '%s'\n", strerror(errno));
+          }else{
+               success = true;
+          }
+     }
+     pthread_mutex_unlock(&reader->lock);
+     return success;
+}
+
+static void tty_reader_remove(CeTerminal_t* terminal){
+     CeTerminalReader_t* reader = &g_terminal_reader;
+
+     // once we have the lock the tty thread isn't reading, and it won't trust anything it waited on before now
+     pthread_mutex_lock(&reader->lock);
+     if(reader->epoll_file_descriptor >= 0){
+          // fails if the shell exited and the tty thread already removed it
+          epoll_ctl(reader->epoll_file_descriptor, EPOLL_CTL_DEL, terminal->file_descriptor, NULL);
+     }
+     reader->removed++;
+     pthread_mutex_unlock(&reader->lock);
+}
+
 static void handle_signal_child(int signal){
      ce_log("%s(%d)\n", __FUNCTION__, signal);
 }
@@ -1432,125 +2220,335 @@ static void terminal_echo(CeTerminal_t* terminal, CeRune_t rune){
      terminal_put(terminal, rune);
 }
 
-bool ce_terminal_init(CeTerminal_t* terminal, int64_t width, int64_t height, int64_t line_count, const char* buffer_name){
+// the lines of the buffer point at the copies of the terminal's lines, which are filled in when we take a snapshot
+static CeBuffer_t* terminal_buffer_alloc(int64_t line_count, const char* name){
+     CeBuffer_t* buffer = calloc(1, sizeof(*buffer));
+     if(!buffer || !ce_buffer_alloc(buffer, 1, name)) return NULL;
+     free(buffer->lines[0]);
+     buffer->line_count = 0;
+
+     char** lines = realloc(buffer->lines, line_count * sizeof(*lines));
+     if(!lines) return NULL;
+     buffer->lines = lines;
+     buffer->status = CE_BUFFER_STATUS_READONLY;
+     buffer->no_highlight_current_line = true;
+     buffer->no_line_numbers = true;
+     return buffer;
+}
+
+bool ce_terminal_init_headless(CeTerminal_t* terminal, int64_t width, int64_t height, int64_t line_count, int64_t archive_line_count,
+                               const char* buffer_name){
+     if(line_count < height) line_count = height;
      terminal->columns = width;
      terminal->rows = height;
      terminal->top = 0;
      terminal->bottom = height - 1;
      terminal->line_count = line_count;
-     terminal->start_line = line_count - height;
-
-     // allocate lines and alternate lines
-     terminal->lines = calloc(line_count, sizeof(*terminal->lines));
-     terminal->alternate_lines = calloc(line_count, sizeof(*terminal->alternate_lines));
-
-     // allocate buffers
-     terminal->lines_buffer = calloc(1, sizeof(*terminal->lines_buffer));
-     terminal->alternate_lines_buffer = calloc(1, sizeof(*terminal->alternate_lines_buffer));
-     ce_buffer_alloc(terminal->lines_buffer, line_count, buffer_name);
-     ce_buffer_alloc(terminal->alternate_lines_buffer, line_count, buffer_name);
-     terminal->lines_buffer->status = CE_BUFFER_STATUS_READONLY;
-     terminal->alternate_lines_buffer->status = CE_BUFFER_STATUS_READONLY;
-     terminal->lines_buffer->no_highlight_current_line = true;
-     terminal->alternate_lines_buffer->no_highlight_current_line = true;
-     terminal->lines_buffer->no_line_numbers = true;
-     terminal->alternate_lines_buffer->no_line_numbers = true;
-     terminal->buffer = terminal->lines_buffer;
-
-     for(int r = 0; r < line_count; ++r){
-          terminal->lines[r] = malloc(terminal->columns * sizeof(*terminal->lines[r]));
-          terminal->alternate_lines[r] = malloc(terminal->columns * sizeof(*terminal->alternate_lines[r]));
-
-          // default fg and bg
-          for(int g = 0; g < terminal->columns; ++g){
-               terminal->lines[r][g].foreground = -1;
-               terminal->lines[r][g].background = -1;
-          }
 
-          // alloc buffer lines, accounting for the fact that all characters could be in max UTF8 size
-          size_t bytes = (terminal->columns + 1) * CE_UTF8_SIZE;
-          terminal->lines_buffer->lines[r] = realloc(terminal->lines_buffer->lines[r], bytes);
-          terminal->alternate_lines_buffer->lines[r] = realloc(terminal->alternate_lines_buffer->lines[r], bytes);
+     // only the screen is allocated up front, the scroll back grows as output scrolls into it and the alternate
+     // screen waits until an application switches to it
+     if(!terminal_screen_alloc(terminal, &terminal->screen, line_count)) return false;
+     terminal->start_line = terminal->screen.count - height;
 
-          // set them to blank
-          memset(terminal->lines_buffer->lines[r], ' ', terminal->columns);
-          memset(terminal->alternate_lines_buffer->lines[r], ' ', terminal->columns);
+     terminal->lines_buffer = terminal_buffer_alloc(line_count, buffer_name);
+     terminal->alternate_lines_buffer = terminal_buffer_alloc(height, buffer_name);
+     if(!terminal->lines_buffer || !terminal->alternate_lines_buffer) return false;
+     terminal->buffer = terminal->lines_buffer;
+     terminal->lines_buffer_capacity = line_count;
+     terminal_archive_init(&terminal->archive, archive_line_count);
 
-          // null terminate end of current string to end of entire string
-          int64_t rest_of_the_bytes = bytes - terminal->columns;
-          memset(terminal->lines_buffer->lines[r] + terminal->columns, 0, rest_of_the_bytes);
-          memset(terminal->alternate_lines_buffer->lines[r] + terminal->columns, 0, rest_of_the_bytes);
-     }
+     terminal->snapshot.lines = calloc(line_count, sizeof(*terminal->snapshot.lines));
 
      terminal->tabs = calloc(terminal->columns, sizeof(*terminal->tabs));
      terminal_reset(terminal);
+     pthread_mutex_init(&terminal->lock, NULL);
+     ce_terminal_update_snapshot(terminal);
+     return true;
+}
+
+bool ce_terminal_init(CeTerminal_t* terminal, int64_t width, int64_t height, int64_t line_count, int64_t archive_line_count,
+                      const char* buffer_name){
+     if(!ce_terminal_init_headless(terminal, width, height, line_count, archive_line_count, buffer_name)) return false;
 
      if(!tty_create(terminal->rows, terminal->columns, &terminal->pid, &terminal->file_descriptor)){
           return false;
      }
 
-     int rc = pthread_create(&terminal->thread, NULL, tty_reader, terminal);
-     if(rc != 0){
-          ce_log("pthread_create() failed: '%s'\n", strerror(errno));
-          return false;
+     terminal->read_size = CE_TERMINAL_READ_MIN_SIZE;
+     return tty_reader_add(terminal);
+}
+
+// the screen's lines go in the buffer after the first lines, which are archived
+static void terminal_copy_lines(CeTerminal_t* terminal, CeTerminalScreen_t* screen, CeBuffer_t* buffer,
+                                CeTerminalLineCopy_t** copies, int64_t first){
+     buffer->line_count = first + screen->count;
+     for(int64_t y = 0; y < screen->count; y++){
+          CeTerminalLine_t* line = screen->lines + ((screen->head + y) % screen->capacity);
+          CeTerminalLineCopy_t* copy = line->copy;
+          if(line->dirty && line->columns > copy->text_columns){
+               char* new_text = realloc(copy->text, (line->columns + 1) * CE_UTF8_SIZE);
+               if(new_text){
+                    copy->text = new_text;
+                    copy->text_columns = line->columns;
+               }
+          }
+          buffer->lines[first + y] = copy->text;
+          if(copies) copies[y] = copy;
+          if(!line->dirty || line->columns > copy->text_columns) continue;
+
+          if(line->count > copy->capacity){
+               CeTerminalSpan_t* new_spans = realloc(copy->spans, line->count * sizeof(*new_spans));
+               if(!new_spans) continue;
+               copy->spans = new_spans;
+               copy->capacity = line->count;
+          }
+          memcpy(copy->spans, line->spans, line->count * sizeof(*line->spans));
+          copy->count = line->count;
+
+          char* itr = copy->text;
+          for(int32_t x = 0; x < line->columns; x++){
+               int64_t written = 0;
+               ce_utf8_encode(line->cells[x], itr, CE_UTF8_SIZE, &written);
+               itr += written;
+          }
+          *itr = 0;
+          line->dirty = false;
      }
+}
 
-     return true;
+// the tty thread only writes the cells, a line is copied here once for however many times it changed
+static void terminal_update_snapshot(CeTerminal_t* terminal){
+     // the archive only changes at the end between snapshots, unless blocks were dropped from the start
+     CeTerminalArchive_t* archive = &terminal->archive;
+     CeBuffer_t* buffer = terminal->lines_buffer;
+     int64_t dropped = terminal_archive_trim(archive);
+     int64_t kept = terminal->lines_buffer_archived - dropped;
+     if(kept < 0) kept = 0;
+     if(archive->line_count + terminal->line_count > terminal->lines_buffer_capacity){
+          int64_t new_capacity = terminal->lines_buffer_capacity * 2;
+          while(new_capacity < archive->line_count + terminal->line_count) new_capacity *= 2;
+          char** new_lines = realloc(buffer->lines, new_capacity * sizeof(*new_lines));
+          if(new_lines){
+               buffer->lines = new_lines;
+               terminal->lines_buffer_capacity = new_capacity;
+          }
+     }
+     memmove(buffer->lines, buffer->lines + (terminal->lines_buffer_archived - kept), kept * sizeof(*buffer->lines));
+     terminal->lines_buffer_archived = kept;
+     if(archive->line_count + terminal->line_count <= terminal->lines_buffer_capacity){
+          memcpy(buffer->lines + kept, archive->lines + kept, (archive->line_count - kept) * sizeof(*buffer->lines));
+          terminal->lines_buffer_archived = archive->line_count;
+     }
+     terminal->scrolled -= dropped;
+
+     bool alternate = terminal->mode & CE_TERMINAL_MODE_ALTSCREEN;
+     CeTerminalScreen_t* primary_screen = alternate ? &terminal->alternate_screen : &terminal->screen;
+     CeTerminalScreen_t* alternate_screen = alternate ? &terminal->screen : &terminal->alternate_screen;
+
+     // applications that use the alternate screen tend to come back to it soon, so we hold on to it for a while
+     if(!alternate && alternate_screen->lines &&
+        terminal_seconds() - terminal->alternate_screen_left >= CE_TERMINAL_ALTERNATE_SCREEN_KEEP_SECONDS){
+          terminal_screen_free(alternate_screen);
+     }
+
+     terminal_copy_lines(terminal, primary_screen, buffer, alternate ? NULL : terminal->snapshot.lines,
+                         terminal->lines_buffer_archived);
+     terminal_copy_lines(terminal, alternate_screen, terminal->alternate_lines_buffer,
+                         alternate ? terminal->snapshot.lines : NULL, 0);
+
+     terminal->snapshot.buffer = terminal->buffer;
+     terminal->snapshot.cursor = terminal->cursor;
+     terminal->snapshot.archived = alternate ? 0 : terminal->lines_buffer_archived;
+     terminal->snapshot.start_line = terminal->start_line + terminal->snapshot.archived;
+
+     // keep the last goto destination on the same output as it scrolls
+     CeAppBufferData_t* buffer_data = terminal->buffer->app_data;
+     if(buffer_data && terminal->scrolled){
+          buffer_data->last_goto_destination += terminal->scrolled;
+          CE_CLAMP(buffer_data->last_goto_destination, 0, terminal->buffer->line_count - 1);
+     }
+     terminal->scrolled = 0;
 }
 
-void ce_terminal_resize(CeTerminal_t* terminal, int64_t width, int64_t height){
-     // TODO: realloc lines
-     if(height > terminal->line_count){
+void ce_terminal_update_snapshot(CeTerminal_t* terminal){
+     pthread_mutex_lock(&terminal->lock);
+     terminal_update_snapshot(terminal);
+     pthread_mutex_unlock(&terminal->lock);
+}
 
+// adds a blank line to the end of the screen, once the screen is full its oldest line is archived and reused
+static CeTerminalLine_t* terminal_screen_append(CeTerminal_t* terminal, CeTerminalScreen_t* screen, bool primary){
+     CeTerminalGlyph_t blank = {0, COLOR_DEFAULT, COLOR_DEFAULT};
+     if(screen->count < screen->capacity){
+          if(!terminal_screen_grow(terminal, screen, screen->count + 1)) return NULL;
+          return screen->lines + ((screen->head + screen->count - 1) % screen->capacity);
      }
 
-     if(terminal->columns > width){
-          for(int64_t i = 0; i < terminal->line_count; i++){
-               terminal->lines[i] = realloc(terminal->lines[i], width * sizeof(*terminal->lines[0]));
-               terminal->alternate_lines[i] = realloc(terminal->alternate_lines[i], width * sizeof(*terminal->alternate_lines[0]));
+     CeTerminalLine_t* line = screen->lines + screen->head;
+     if(primary) terminal_archive_line(&terminal->archive, line);
+     screen->head = (screen->head + 1) % screen->capacity;
+     if(line->columns != terminal->columns) terminal_line_resize(line, terminal->columns, blank);
+     line->spans[0] = (CeTerminalSpan_t){0, terminal->columns, blank};
+     line->count = 1;
+     line->wrapped = false;
+     terminal_line_fill(line, 0, terminal->columns, ' ');
+     return line;
+}
 
-               // realloc buffer lines so they are smaller
-               size_t bytes = (width + 1) * CE_UTF8_SIZE;
-               terminal->lines_buffer->lines[i] = realloc(terminal->lines_buffer->lines[i], bytes);
-               terminal->alternate_lines_buffer->lines[i] = realloc(terminal->alternate_lines_buffer->lines[i], bytes);
+static bool terminal_glyph_is_blank(const CeTerminalGlyph_t* glyph){
+     return glyph->attributes == CE_TERMINAL_GLYPH_ATTRIBUTE_NONE && glyph->background == COLOR_DEFAULT;
+}
 
-               // find the end and null terminal it
-               char* end = ce_utf8_iterate_to(terminal->lines_buffer->lines[i], width);
-               if(end) *end = 0;
-               end = ce_utf8_iterate_to(terminal->alternate_lines_buffer->lines[i], width);
-               if(end) *end = 0;
+// rewraps the lines on the screen, and the lines above them that wrap onto it, to the terminal's new width. the rest of
+// the scroll back keeps the width it was written at until it is archived, where wrapped lines are joined back together
+static void terminal_reflow(CeTerminal_t* terminal, CeTerminalScreen_t* screen, bool primary, int64_t rows,
+                            CeTerminalCursor_t* cursor){
+     int64_t columns = terminal->columns;
+     int64_t first = screen->count - ((rows > terminal->rows) ? rows : terminal->rows);
+     if(first < 0) first = 0;
+     while(first > 0 && screen->lines[(screen->head + first - 1) % screen->capacity].wrapped) first--;
+     int64_t cursor_row = screen->count - rows + cursor->y;
+
+     int64_t cell_count = 0;
+     for(int64_t r = first; r < screen->count; r++) cell_count += screen->lines[(screen->head + r) % screen->capacity].columns;
+     CeRune_t* cells = malloc(cell_count * sizeof(*cells));
+     CeTerminalGlyph_t* glyphs = malloc(cell_count * sizeof(*glyphs));
+     int64_t* starts = malloc((screen->count - first) * sizeof(*starts));
+     int64_t* ends = malloc((screen->count - first) * sizeof(*ends));
+     if(!cells || !glyphs || !starts || !ends){
+          ce_log("%s() failed to allocate %ld cells\n", __FUNCTION__, cell_count);
+          goto cleanup;
+     }
+
+     // gather the lines' cells end to end, each unwrapped line ends a line we are going to rewrap
+     int64_t line_total = 0;
+     int64_t len = 0;
+     int64_t cursor_line = -1;
+     int64_t cursor_offset = 0;
+     bool wrapped = false;
+     for(int64_t r = first; r < screen->count; r++){
+          CeTerminalLine_t* line = screen->lines + ((screen->head + r) % screen->capacity);
+          if(!wrapped) starts[line_total] = len;
+          wrapped = line->wrapped && r + 1 < screen->count;
+          for(int32_t s = 0; s < line->count; s++){
+               for(int32_t x = line->spans[s].start; x < line->spans[s].start + line->spans[s].len; x++){
+                    glyphs[len + x] = line->spans[s].glyph;
+               }
+          }
+          memcpy(cells + len, line->cells, line->columns * sizeof(*cells));
+          if(r == cursor_row){
+               cursor_line = line_total;
+               cursor_offset = len + cursor->x - starts[line_total];
+               if(cursor->state & CE_TERMINAL_CURSOR_STATE_WRAPNEXT) cursor_offset++;
           }
-     }else if(terminal->columns < width){
-          int64_t diff = width - terminal->columns;
-          for(int64_t i = 0; i < terminal->line_count; i++){
-               terminal->lines[i] = realloc(terminal->lines[i], width * sizeof(*terminal->lines[0]));
-               terminal->alternate_lines[i] = realloc(terminal->alternate_lines[i], width * sizeof(*terminal->alternate_lines[0]));
-
-               memset(terminal->lines[i] + terminal->columns, 0, diff * sizeof(terminal->lines[i][0]));
-               memset(terminal->alternate_lines[i] + terminal->columns, 0, diff * sizeof(terminal->alternate_lines[i][0]));
-
-               // realloc buffer lines so they are smaller
-               size_t bytes = (width + 1) * CE_UTF8_SIZE;
-               terminal->lines_buffer->lines[i] = realloc(terminal->lines_buffer->lines[i], bytes);
-               terminal->alternate_lines_buffer->lines[i] = realloc(terminal->alternate_lines_buffer->lines[i], bytes);
-
-               // append spaces and null terminator with the new columns
-               char* end = ce_utf8_iterate_to_include_end(terminal->lines_buffer->lines[i], terminal->columns);
-               memset(end, ' ', diff);
-               end += diff;
-               *end = 0;
-
-               end = ce_utf8_iterate_to_include_end(terminal->alternate_lines_buffer->lines[i], terminal->columns);
-               memset(end, ' ', diff);
-               end += diff;
-               *end = 0;
+          len += line->columns;
+          terminal_line_free(line);
+          if(wrapped) continue;
+
+          int64_t end = len;
+          while(end > starts[line_total] && cells[end - 1] == ' ' && terminal_glyph_is_blank(glyphs + end - 1)) end--;
+          ends[line_total++] = end;
+     }
+     screen->count = first;
+
+     int64_t appended = 0;
+     int64_t cursor_appended = -1;
+     for(int64_t l = 0; l < line_total; l++){
+          int64_t length = ends[l] - starts[l];
+          int64_t row_count = (length > 0) ? (length + columns - 1) / columns : 1;
+          if(l == cursor_line && cursor_offset / columns + 1 > row_count) row_count = cursor_offset / columns + 1;
+          if(l == cursor_line) cursor_appended = appended + cursor_offset / columns;
+
+          for(int64_t i = 0; i < row_count; i++){
+               CeTerminalLine_t* line = terminal_screen_append(terminal, screen, primary);
+               if(!line) goto cleanup;
+               appended++;
+
+               int64_t from = starts[l] + i * columns;
+               int64_t n = ends[l] - from;
+               CE_CLAMP(n, 0, columns);
+               memcpy(line->cells, cells + from, n * sizeof(*cells));
+               for(int64_t x = 0; x < n;){
+                    int64_t end = x + 1;
+                    while(end < n && terminal_glyphs_equal(glyphs + from + end, glyphs + from + x)) end++;
+                    terminal_line_set(line, x, end, glyphs[from + x]);
+                    x = end;
+               }
+               line->wrapped = (i + 1 < row_count);
           }
      }
 
+     while(screen->count < terminal->rows && terminal_screen_append(terminal, screen, primary)) appended++;
+
+     // blank lines under the cursor go before any output is pushed up into the scroll back
+     int64_t below_cursor = appended - 1 - cursor_appended;
+     while(below_cursor > 0 && screen->count > terminal->rows){
+          CeTerminalLine_t* line = screen->lines + ((screen->head + screen->count - 1) % screen->capacity);
+          if(line->count != 1 || !terminal_glyph_is_blank(&line->spans[0].glyph)) break;
+          bool blank = true;
+          for(int32_t x = 0; x < line->columns && blank; x++) blank = (line->cells[x] == ' ');
+          if(!blank) break;
+          terminal_line_free(line);
+          screen->count--;
+          below_cursor--;
+     }
+
+     if(cursor_appended >= 0){
+          cursor->y = terminal->rows - 1 - below_cursor;
+          if(cursor->y < 0) cursor->y = 0;
+          cursor->x = cursor_offset % columns;
+          cursor->state &= ~CE_TERMINAL_CURSOR_STATE_WRAPNEXT;
+     }
+
+cleanup:
+     free(cells);
+     free(glyphs);
+     free(starts);
+     free(ends);
+}
+
+void ce_terminal_resize(CeTerminal_t* terminal, int64_t width, int64_t height){
+     pthread_mutex_lock(&terminal->lock);
+     if(terminal->capture){
+          int32_t size[2] = {width, height};
+          terminal_capture_record(terminal, CE_TERMINAL_CAPTURE_RECORD_RESIZE, size, sizeof(size));
+     }
+     CeTerminalGlyph_t blank = {0, COLOR_DEFAULT, COLOR_DEFAULT};
+     int64_t rows = terminal->rows;
+
+     int32_t* new_tabs = realloc(terminal->tabs, width * sizeof(*new_tabs));
+     if(new_tabs){
+          terminal->tabs = new_tabs;
+          for(int64_t i = terminal->columns; i < width; i++) terminal->tabs[i] = (i >= CE_TERMINAL_TAB_SPACES);
+     }
+
+     // the primary screen keeps at least a screen's worth of lines, the alternate screen keeps exactly that many
+     bool alternate = terminal->mode & CE_TERMINAL_MODE_ALTSCREEN;
+     CeTerminalScreen_t* primary_screen = alternate ? &terminal->alternate_screen : &terminal->screen;
+     CeTerminalScreen_t* alternate_screen = alternate ? &terminal->screen : &terminal->alternate_screen;
+     if(height > terminal->line_count && terminal_screen_set_capacity(primary_screen, height)){
+          terminal->line_count = height;
+          CeTerminalLineCopy_t** snapshot_lines = realloc(terminal->snapshot.lines, height * sizeof(*snapshot_lines));
+          if(snapshot_lines) terminal->snapshot.lines = snapshot_lines;
+     }
+     char** alternate_lines = realloc(terminal->alternate_lines_buffer->lines, height * sizeof(*alternate_lines));
+     if(alternate_lines) terminal->alternate_lines_buffer->lines = alternate_lines;
+
      terminal->columns = width;
      terminal->rows = height;
      terminal->bottom = terminal->top + (height - 1);
-     terminal->start_line = terminal->line_count - height;
+
+     // whatever is using the alternate screen redraws it, so its lines are just cut off or filled in
+     if(alternate_screen->lines){
+          if(alternate_screen->capacity != height) terminal_screen_set_capacity(alternate_screen, height);
+          for(int64_t i = 0; i < alternate_screen->count; i++){
+               terminal_line_resize(alternate_screen->lines + ((alternate_screen->head + i) % alternate_screen->capacity), width, blank);
+          }
+          terminal_screen_grow(terminal, alternate_screen, height);
+     }
+
+     terminal_reflow(terminal, primary_screen, true, rows, alternate ? &terminal->save_cursor[0] : &terminal->cursor);
+     terminal->start_line = terminal->screen.count - height;
 
      // clamp cursor onto terminal
      if(terminal->cursor.y >= height){
@@ -1560,6 +2558,11 @@ void ce_terminal_resize(CeTerminal_t* terminal, int64_t width, int64_t height){
      if(terminal->cursor.x >= width){
           terminal->cursor.x = width - 1;
      }
+     terminal_update_snapshot(terminal);
+     pthread_mutex_unlock(&terminal->lock);
+
+     // headless terminals don't have a shell to tell
+     if(terminal->pid <= 0) return;
 
      struct winsize window_size = {};
 
@@ -1572,32 +2575,34 @@ void ce_terminal_resize(CeTerminal_t* terminal, int64_t width, int64_t height){
 }
 
 void ce_terminal_free(CeTerminal_t* terminal){
-     pthread_cancel(terminal->thread);
-     pthread_join(terminal->thread, NULL);
-
-     for(int r = 0; r < terminal->line_count; ++r){
-          free(terminal->lines[r]);
+     // headless terminals don't have a shell for the tty thread to read from
+     if(terminal->pid > 0){
+          tty_reader_remove(terminal);
+          close(terminal->file_descriptor);
      }
-     free(terminal->lines);
-     terminal->lines = NULL;
+     terminal_capture_close(terminal);
 
-     for(int r = 0; r < terminal->line_count; ++r){
-          free(terminal->alternate_lines[r]);
-     }
-     free(terminal->alternate_lines);
-     terminal->alternate_lines = NULL;
+     terminal_screen_free(&terminal->screen);
+     terminal_screen_free(&terminal->alternate_screen);
 
+     terminal_archive_free(&terminal->archive);
      free(terminal->tabs);
      terminal->tabs = NULL;
+     free(terminal->snapshot.lines);
+     terminal->snapshot.lines = NULL;
+     pthread_mutex_destroy(&terminal->lock);
 
+     // the text of the buffers' lines was freed with the lines
      free(terminal->lines_buffer->app_data);
      terminal->lines_buffer->app_data = NULL;
+     terminal->lines_buffer->line_count = 0;
      ce_buffer_free(terminal->lines_buffer);
      free(terminal->lines_buffer);
      terminal->lines_buffer = NULL;
 
      free(terminal->alternate_lines_buffer->app_data);
      terminal->alternate_lines_buffer->app_data = NULL;
+     terminal->alternate_lines_buffer->line_count = 0;
      ce_buffer_free(terminal->alternate_lines_buffer);
      free(terminal->alternate_lines_buffer);
      terminal->alternate_lines_buffer = NULL;
@@ -1648,9 +2653,11 @@ bool ce_terminal_send_key(CeTerminal_t* terminal, CeRune_t key){
      }
 
      if(terminal->mode & CE_TERMINAL_MODE_ECHO){
+          pthread_mutex_lock(&terminal->lock);
           for(size_t i = 0; i < len; i++){
                terminal_echo(terminal, string[i]);
           }
+          pthread_mutex_unlock(&terminal->lock);
      }
 
      if(free_string) free(string);
@@ -21,8 +21,17 @@
 #define CE_TERMINAL_DEFAULT_SHELL "/bin/bash"
 #define CE_TERMINAL_ESCAPE_BUFFER_SIZE (128 * CE_UTF8_SIZE)
 #define CE_TERMINAL_ESCAPE_ARGUMENT_SIZE 16
+#define CE_TERMINAL_ESCAPE_ARGUMENT_MAX 100000000 // arguments stop growing here instead of overflowing
+#define CE_TERMINAL_ESCAPE_INTERMEDIATE_SIZE 2
 #define CE_TERMINAL_VT_IDENTIFIER "\033[?6c"
 #define CE_TERMINAL_TAB_SPACES 5 // TODO: use config_options
+#define CE_TERMINAL_ARCHIVE_BLOCK_SIZE (64 * 1024)
+#define CE_TERMINAL_ALTERNATE_SCREEN_KEEP_SECONDS 60 // how long the alternate screen stays allocated after we leave it
+#define CE_TERMINAL_READ_MIN_SIZE (4 * 1024)
+#define CE_TERMINAL_READ_MAX_SIZE (256 * 1024)
+#define CE_TERMINAL_READER_EVENT_COUNT 32
+#define CE_TERMINAL_REPLACEMENT_RUNE 0xFFFD // shown in place of output that isn't valid utf8
+#define CE_TERMINAL_CAPTURE_MAGIC "cetty\0\0\1" // the last byte is the version
 
 typedef enum{
      CE_TERMINAL_GLYPH_ATTRIBUTE_NONE       = 0,
@@ -78,16 +87,19 @@ typedef enum{
      CE_TERMINAL_MODE_MOUSE       = 1 << 23,
 }CeTerminalMode_t;
 
+// the states of a DEC compatible parser, after Paul Williams' diagram. we skip over every kind of control string, so DCS,
+// SOS, PM and APC share the state for OSC strings
 typedef enum{
-     CE_TERMINAL_ESCAPE_STATE_START      = 1 << 0,
-     CE_TERMINAL_ESCAPE_STATE_CSI        = 1 << 1,
-     CE_TERMINAL_ESCAPE_STATE_STR        = 1 << 2,
-     CE_TERMINAL_ESCAPE_STATE_ALTCHARSET = 1 << 3,
-     CE_TERMINAL_ESCAPE_STATE_STR_END    = 1 << 4,
-     CE_TERMINAL_ESCAPE_STATE_TEST       = 1 << 5,
-     CE_TERMINAL_ESCAPE_STATE_UTF8       = 1 << 6,
-     CE_TERMINAL_ESCAPE_STATE_DCS        = 1 << 7,
-}CeTerminalEscapeState_t;
+     CE_TERMINAL_PARSER_STATE_GROUND,
+     CE_TERMINAL_PARSER_STATE_ESCAPE,
+     CE_TERMINAL_PARSER_STATE_ESCAPE_INTERMEDIATE,
+     CE_TERMINAL_PARSER_STATE_CSI_ENTRY,
+     CE_TERMINAL_PARSER_STATE_CSI_PARAM,
+     CE_TERMINAL_PARSER_STATE_CSI_INTERMEDIATE,
+     CE_TERMINAL_PARSER_STATE_CSI_IGNORE,
+     CE_TERMINAL_PARSER_STATE_STRING,
+     CE_TERMINAL_PARSER_STATE_COUNT,
+}CeTerminalParserState_t;
 
 typedef struct{
      uint16_t attributes;
@@ -95,6 +107,68 @@ typedef struct{
      int32_t background;
 }CeTerminalGlyph_t;
 
+// a run of cells on a line that share attributes and colors
+typedef struct{
+     int32_t start;
+     int32_t len;
+     CeTerminalGlyph_t glyph;
+}CeTerminalSpan_t;
+
+// a line's text and attributes as of the last ce_terminal_update_snapshot(), only the main thread reads or writes them
+typedef struct{
+     char* text;
+     CeTerminalSpan_t* spans;
+     int32_t count;
+     int32_t capacity;
+     int32_t text_columns; // how many columns the text has room for
+}CeTerminalLineCopy_t;
+
+// the spans are in order and cover every column of the line
+typedef struct{
+     CeRune_t* cells; // one rune per column
+     int32_t columns; // the terminal's width when the line was last on screen, the scroll back isn't resized
+     CeTerminalSpan_t* spans;
+     int32_t count;
+     int32_t capacity;
+     bool wrapped; // the line continues on the next line
+     bool dirty; // the cells changed since the line was last copied
+     CeTerminalLineCopy_t* copy; // moves with the line when it scrolls
+}CeTerminalLine_t;
+
+// a ring of lines, scrolling the whole screen moves the head instead of every line. lines are allocated as output
+// reaches them, up to the capacity
+typedef struct{
+     CeTerminalLine_t* lines;
+     int64_t head; // the oldest line
+     int64_t count;
+     int64_t capacity; // the terminal's line count for the primary screen, the alternate screen doesn't scroll back
+}CeTerminalScreen_t;
+
+// a piece of the archive file mapped into memory, lines are appended to the newest block
+typedef struct{
+     char* text;
+     int64_t offset; // in the file, -1 if the block is anonymous memory
+     int64_t size;
+     int64_t used;
+     int64_t line_count;
+}CeTerminalArchiveBlock_t;
+
+// lines that scrolled out of the primary screen's ring, kept as plain text in a file under ~/.ce. the blocks are
+// mapped so the buffer's lines point straight into them, and the kernel decides which ones stay in memory
+typedef struct{
+     int file_descriptor; // -1 if the file couldn't be made, then new blocks are anonymous memory
+     int64_t file_size;
+     int64_t pending; // bytes after the newest block's used bytes, from wrapped lines waiting for the rest of their line
+     int64_t max_line_count; // older blocks are dropped past this, 0 turns the archive off
+     char** lines;
+     int64_t line_count;
+     int64_t line_capacity;
+     CeTerminalArchiveBlock_t* blocks; // oldest first
+     int64_t block_count;
+     int64_t spare_count; // dropped blocks after the others, they are reused before we map new ones
+     int64_t block_capacity;
+}CeTerminalArchive_t;
+
 typedef struct{
      CeTerminalGlyph_t attributes;
      int32_t x;
@@ -102,12 +176,23 @@ typedef struct{
      uint8_t state;
 }CeTerminalCursor_t;
 
+// what the main thread reads while the tty thread keeps writing, so a frame never sees half of a chunk of output
+typedef struct{
+     CeTerminalLineCopy_t** lines; // the current screen by row, after the archived lines
+     CeBuffer_t* buffer;
+     CeTerminalCursor_t cursor;
+     int64_t start_line;
+     int64_t archived; // lines at the start of the buffer that came from the archive, they have no attributes
+}CeTerminalSnapshot_t;
+
 typedef struct{
      char buffer[CE_TERMINAL_ESCAPE_BUFFER_SIZE];
      uint32_t buffer_length;
      char private;
      int arguments[CE_TERMINAL_ESCAPE_ARGUMENT_SIZE];
      uint32_t argument_count;
+     char intermediates[CE_TERMINAL_ESCAPE_INTERMEDIATE_SIZE]; // also private markers other than '?'
+     uint32_t intermediate_count;
      char mode[2];
 }CeTerminalCSIEscape_t;
 
@@ -119,23 +204,45 @@ typedef struct{
      uint32_t argument_count;
 }CeTerminalSTREscape_t;
 
+typedef enum{
+     CE_TERMINAL_CAPTURE_RECORD_OUTPUT, // followed by the bytes
+     CE_TERMINAL_CAPTURE_RECORD_RESIZE, // followed by the new columns and rows as int32_t
+}CeTerminalCaptureRecordType_t;
+
+// a capture file is this header and then records, in the byte order of the machine that made it
+typedef struct{
+     char magic[8];
+     int32_t columns;
+     int32_t rows;
+}CeTerminalCaptureHeader_t;
+
+typedef struct{
+     int64_t nanoseconds; // since the capture started
+     int32_t type;
+     int32_t length;
+}CeTerminalCaptureRecord_t;
+
 typedef struct{
      int file_descriptor;
      int32_t rows;
      int32_t columns;
-     int64_t line_count;
+     int64_t line_count; // the most lines the primary screen keeps, including the scroll back
      int64_t start_line;
-     CeTerminalGlyph_t** lines;
-     CeTerminalGlyph_t** alternate_lines;
+     CeTerminalScreen_t screen;
+     CeTerminalScreen_t alternate_screen; // no lines until an application switches to it
+     int64_t alternate_screen_left; // in monotonic seconds
      CeBuffer_t* buffer; // current buffer
      CeBuffer_t* lines_buffer;
      CeBuffer_t* alternate_lines_buffer;
+     int64_t lines_buffer_capacity; // only the main thread touches these two
+     int64_t lines_buffer_archived;
+     CeTerminalArchive_t archive;
      CeTerminalCursor_t cursor;
      CeTerminalCursor_t save_cursor[2];
      int32_t top;
      int32_t bottom;
      CeTerminalMode_t mode;
-     CeTerminalEscapeState_t escape_state;
+     CeTerminalParserState_t parser_state;
      char translation_table[4];
      int32_t charset;
      int32_t selected_charset;
@@ -143,15 +250,29 @@ typedef struct{
      int32_t* tabs;
      CeTerminalCSIEscape_t csi_escape;
      CeTerminalSTREscape_t str_escape;
+     char utf8_pending[CE_UTF8_SIZE]; // the start of a utf8 sequence the last output ended in the middle of
+     int32_t utf8_pending_length;
+     int64_t scrolled; // how far the lines moved down since the last snapshot
+     CeTerminalSnapshot_t snapshot;
      volatile bool ready_to_draw;
-     pthread_t thread;
+     pthread_mutex_t lock; // held while the lines are changed or copied, the tty thread holds it for each chunk of output
+     int64_t read_size; // only the tty thread touches this, it grows while reads fill it and shrinks when they don't
+     FILE* capture; // records the output and resizes while it isn't NULL, guarded by the lock
+     int64_t capture_start; // in monotonic nanoseconds
      pid_t pid;
      bool killed;
 }CeTerminal_t;
 
-bool ce_terminal_init(CeTerminal_t* terminal, int64_t width, int64_t height, int64_t line_count, const char* buffer_name);
+bool ce_terminal_init(CeTerminal_t* terminal, int64_t width, int64_t height, int64_t line_count, int64_t archive_line_count,
+                      const char* buffer_name);
+bool ce_terminal_init_headless(CeTerminal_t* terminal, int64_t width, int64_t height, int64_t line_count, int64_t archive_line_count,
+                               const char* buffer_name); // no shell, output comes from ce_terminal_write_output()
+void ce_terminal_write_output(CeTerminal_t* terminal, const char* bytes, int64_t len); // handles output as if the shell wrote it
+void ce_terminal_update_snapshot(CeTerminal_t* terminal); // copies the lines that changed, call before reading the buffers
 void ce_terminal_resize(CeTerminal_t* terminal, int64_t width, int64_t height);
 void ce_terminal_free(CeTerminal_t* terminal);
+bool ce_terminal_capture_start(CeTerminal_t* terminal, const char* filepath); // replaces a capture that is running
+void ce_terminal_capture_stop(CeTerminal_t* terminal);
 bool ce_terminal_send_key(CeTerminal_t* terminal, CeRune_t key);
 char* ce_terminal_get_current_directory(CeTerminal_t* terminal);
 
@@ -1277,9 +1277,19 @@ CeRange_t ce_vim_find_string_boundaries(CeBuffer_t* buffer, CePoint_t start, cha
      return range;
 }
 
-// TODO: handle multiline comments
 static bool point_in_string_or_comment(CeBuffer_t* buffer, CePoint_t point){
      if(!ce_buffer_contains_point(buffer, point)) return false;
+
+     // use the syntax highlighter's tokens when it has them, they know about multiline comments and strings
+     CeAppBufferData_t* buffer_data = buffer->app_data;
+     CeSyntaxColor_t syntax_class = CE_SYNTAX_COLOR_NORMAL;
+     if(buffer_data && ce_syntax_token_at(buffer, buffer_data->syntax_function, point, &syntax_class)){
+          return syntax_class == CE_SYNTAX_COLOR_STRING ||
+                 syntax_class == CE_SYNTAX_COLOR_CHAR_LITERAL ||
+                 syntax_class == CE_SYNTAX_COLOR_COMMENT;
+     }
+
+     // TODO: handle multiline comments
      CeRune_t in_string = 0;
      CeRune_t in_comment = 0;
      CeRune_t prev_rune = 0;
@@ -9,6 +9,7 @@
 #include <assert.h>
 #include <signal.h>
 #include <errno.h>
+#include <fcntl.h>
 
 #include "ce_app.h"
 #include "ce_commands.h"
@@ -22,6 +23,8 @@ int g_last_key = 0;
 // limit to 60 fps
 #define DRAW_USEC_LIMIT 16666
 
+#define IDLE_TOKENIZE_LINES 4096 // lexed each time the main loop wakes up with nothing to do
+
 void handle_sigint(int signal){
      // pass
 }
@@ -197,18 +200,574 @@ static void build_jump_list(CeBuffer_t* buffer, CeJumpList_t* jump_list){
      buffer->status = CE_BUFFER_STATUS_READONLY;
 }
 
-void draw_view(CeView_t* view, int64_t tab_width, CeLineNumber_t line_number, CeVisualLineDisplayType_t visual_line_display_type,
-               CeMultipleCursors_t* multiple_cursors, CeDrawColorList_t* draw_color_list, CeColorDefs_t* color_defs, CeSyntaxDef_t* syntax_defs){
+#define FNV_OFFSET_BASIS 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+static void build_syntax_info(CeBuffer_t* buffer, CeBufferNode_t* head){
+     ce_buffer_empty(buffer);
+     char line[256];
+     CeSyntaxCacheStats_t stats = ce_syntax_cache_stats();
+     int64_t lookups = stats.hits + stats.misses;
+     double hit_rate = lookups ? ((double)(stats.hits) * 100.0) / (double)(lookups) : 0.0;
+     snprintf(line, 256, "line span cache: %ld of %ld entries, %ld evictions", stats.entries, stats.capacity, stats.evictions);
+     buffer_append_on_new_line(buffer, line);
+     snprintf(line, 256, "hits %ld misses %ld hit rate %.1f%%", stats.hits, stats.misses, hit_rate);
+     buffer_append_on_new_line(buffer, line);
+     buffer_append_on_new_line(buffer, "");
+     buffer_append_on_new_line(buffer, "lexed lines:");
+
+     for(CeBufferNode_t* itr = head; itr; itr = itr->next){
+          if(itr->buffer == buffer || itr->buffer->tokens.count == 0) continue;
+          snprintf(line, 256, "  %ld / %ld %s", itr->buffer->tokens.valid_count, itr->buffer->tokens.count, itr->buffer->name);
+          buffer_append_on_new_line(buffer, line);
+     }
+
+     buffer->status = CE_BUFFER_STATUS_READONLY;
+}
+
+static uint64_t hash_bytes(uint64_t hash, const void* data, size_t size){
+     const uint8_t* bytes = data;
+     for(size_t i = 0; i < size; i++){
+          hash ^= bytes[i];
+          hash *= FNV_PRIME;
+     }
+     return hash;
+}
+
+static void draw_screen_resize(CeDrawScreen_t* screen, int64_t width, int64_t height){
+     int64_t cell_count = width * height;
+     screen->cells = realloc(screen->cells, cell_count * sizeof(*screen->cells));
+     screen->drawn_cells = realloc(screen->drawn_cells, cell_count * sizeof(*screen->drawn_cells));
+     screen->width = width;
+     screen->height = height;
+     screen->invalidated = true;
+}
+
+static void draw_screen_put(CeDrawScreen_t* screen, int64_t x, int64_t y, CeRune_t rune, int fg, int bg){
+     if(x < 0 || x >= screen->width || y < 0 || y >= screen->height) return;
+     CeDrawCell_t* cell = screen->cells + (y * screen->width) + x;
+     cell->rune = rune;
+     cell->fg = fg;
+     cell->bg = bg;
+}
+
+// returns the number of cells the rune takes up, nothing is drawn passed the right side
+static int64_t draw_screen_put_rune(CeDrawScreen_t* screen, int64_t x, int64_t y, int64_t right, CeRune_t rune, int fg, int bg){
+     // show control characters the same way curses does
+     if(rune < 32 || rune == 127){
+          if(x <= right) draw_screen_put(screen, x, y, '^', fg, bg);
+          if(x + 1 <= right) draw_screen_put(screen, x + 1, y, rune ^ 0x40, fg, bg);
+          return 2;
+     }
+
+     if(x <= right) draw_screen_put(screen, x, y, rune, fg, bg);
+     return 1;
+}
+
+// returns the x position after the string, stops drawing after reaching the right side
+static int64_t draw_screen_put_string(CeDrawScreen_t* screen, int64_t x, int64_t y, int64_t right, const char* string,
+                                      int fg, int bg){
+     int64_t rune_len = 0;
+     while(*string && x <= right){
+          CeRune_t rune = ce_utf8_decode(string, &rune_len);
+          if(rune == CE_UTF8_INVALID) break;
+          x += draw_screen_put_rune(screen, x, y, right, rune, fg, bg);
+          string += rune_len;
+     }
+     return x;
+}
+
+static void draw_screen_fill(CeDrawScreen_t* screen, int64_t left, int64_t right, int64_t y, int fg, int bg){
+     for(int64_t x = left; x <= right; x++){
+          draw_screen_put(screen, x, y, ' ', fg, bg);
+     }
+}
+
+#define DRAW_SCREEN_EVICTED_MAX 8
+
+// curses only knows about indexed colors, so pick the closest one for 24 bit colors
+static int curses_color(int color){
+     if(!CE_COLOR_IS_RGB(color)) return color;
+     int red = CE_COLOR_RED(color);
+     int green = CE_COLOR_GREEN(color);
+     int blue = CE_COLOR_BLUE(color);
+     if(COLORS >= 256){
+          // the 6x6x6 color cube in the xterm 256 color palette
+          return 16 + (36 * ((red * 5 + 127) / 255)) + (6 * ((green * 5 + 127) / 255)) + ((blue * 5 + 127) / 255);
+     }
+     int result = COLOR_BLACK;
+     if(red > 127) result |= COLOR_RED;
+     if(green > 127) result |= COLOR_GREEN;
+     if(blue > 127) result |= COLOR_BLUE;
+     return result;
+}
+
+static void draw_screen_invalidate_color(CeDrawScreen_t* screen, CeColorPair_t* pair){
+     int64_t cell_count = screen->width * screen->height;
+     for(int64_t i = 0; i < cell_count; i++){
+          CeDrawCell_t* cell = screen->drawn_cells + i;
+          if(curses_color(cell->fg) == pair->fg && curses_color(cell->bg) == pair->bg) cell->rune = CE_UTF8_INVALID;
+     }
+}
+
+// returns the number of color pairs that were evicted while drawing
+static int64_t draw_screen_flush_pass(CeDrawScreen_t* screen){
+     int64_t evictions = screen->color_defs.evictions;
+
+     for(int64_t y = 0; y < screen->height; y++){
+          CeDrawCell_t* row = screen->cells + (y * screen->width);
+          CeDrawCell_t* drawn_row = screen->drawn_cells + (y * screen->width);
+
+          int64_t first = 0;
+          while(first < screen->width && memcmp(row + first, drawn_row + first, sizeof(*row)) == 0) first++;
+          if(first == screen->width) continue;
+
+          int64_t last = screen->width - 1;
+          while(last > first && memcmp(row + last, drawn_row + last, sizeof(*row)) == 0) last--;
+
+          CeColorPair_t evicted[DRAW_SCREEN_EVICTED_MAX];
+          int64_t evicted_count = 0;
+
+          move(y, first);
+          for(int64_t x = first; x <= last; x++){
+               CeDrawCell_t* cell = row + x;
+               if(x == first || cell->fg != row[x - 1].fg || cell->bg != row[x - 1].bg){
+                    int64_t prev_evictions = screen->color_defs.evictions;
+                    int color_pair = ce_color_def_get(&screen->color_defs, curses_color(cell->fg), curses_color(cell->bg));
+                    if(screen->color_defs.evictions != prev_evictions){
+                         if(evicted_count < DRAW_SCREEN_EVICTED_MAX){
+                              evicted[evicted_count] = screen->color_defs.last_evicted;
+                         }
+                         evicted_count++;
+                    }
+                    attrset(COLOR_PAIR(color_pair));
+               }
+
+               if(cell->rune >= 0x80){
+                    char utf8_string[CE_UTF8_SIZE + 1];
+                    int64_t bytes_written = 0;
+                    ce_utf8_encode(cell->rune, utf8_string, CE_UTF8_SIZE, &bytes_written);
+                    utf8_string[bytes_written] = 0;
+                    addstr(utf8_string);
+               }else{
+                    addch(cell->rune);
+               }
+          }
+
+          memcpy(drawn_row + first, row + first, ((last - first) + 1) * sizeof(*row));
+          screen->rows_redrawn++;
+
+          // cells drawn with a pair that was just redefined will change color on the terminal, so they need to be sent again
+          if(evicted_count > DRAW_SCREEN_EVICTED_MAX){
+               int64_t cell_count = screen->width * screen->height;
+               for(int64_t i = 0; i < cell_count; i++) screen->drawn_cells[i].rune = CE_UTF8_INVALID;
+          }else{
+               for(int64_t i = 0; i < evicted_count; i++){
+                    draw_screen_invalidate_color(screen, evicted + i);
+               }
+          }
+     }
+
+     return screen->color_defs.evictions - evictions;
+}
+
+// send only the cells that changed since the last frame to curses
+static void curses_backend_flush(CeDrawScreen_t* screen, CePoint_t cursor){
+     // if there are more colors on screen than color pairs, give up after a few passes rather than thrashing
+     for(int64_t pass = 0; pass < 3; pass++){
+          if(draw_screen_flush_pass(screen) == 0) break;
+     }
+
+     move(cursor.y, cursor.x);
+     refresh();
+}
+
+static void curses_backend_clear(CeDrawScreen_t* screen){
+     clear();
+}
+
+static const CeDrawBackend_t g_curses_backend = {CE_DRAW_BACKEND_CURSES, "curses", curses_backend_clear, curses_backend_flush, NULL};
+
+#define DRAW_VT_COLOR_UNKNOWN -3
+#define DRAW_VT_REEMIT_MAX 4 // re-sending a few unchanged cells is shorter than moving the cursor over them
+
+static void vt_output_append(CeDrawVtOutput_t* output, const char* bytes, int64_t count){
+     if(output->count + count > output->capacity){
+          int64_t new_capacity = output->capacity ? output->capacity * 2 : BUFSIZ;
+          while(new_capacity < output->count + count) new_capacity *= 2;
+          char* new_bytes = realloc(output->bytes, new_capacity);
+          if(!new_bytes) return;
+          output->bytes = new_bytes;
+          output->capacity = new_capacity;
+     }
+     memcpy(output->bytes + output->count, bytes, count);
+     output->count += count;
+}
+
+static void vt_output_append_color(CeDrawVtOutput_t* output, int color, bool background){
+     char sgr[32];
+     int len = 0;
+     if(color < 0){
+          len = snprintf(sgr, sizeof(sgr), "%d", background ? 49 : 39);
+     }else if(CE_COLOR_IS_RGB(color)){
+          len = snprintf(sgr, sizeof(sgr), "%d;2;%d;%d;%d", background ? 48 : 38, CE_COLOR_RED(color),
+                         CE_COLOR_GREEN(color), CE_COLOR_BLUE(color));
+     }else if(color < 8){
+          len = snprintf(sgr, sizeof(sgr), "%d", (background ? 40 : 30) + color);
+     }else if(color < 16){
+          len = snprintf(sgr, sizeof(sgr), "%d", (background ? 100 : 90) + (color - 8));
+     }else{
+          len = snprintf(sgr, sizeof(sgr), "%d;5;%d", background ? 48 : 38, color);
+     }
+     vt_output_append(output, sgr, len);
+}
+
+static void vt_output_append_cell(CeDrawVtOutput_t* output, CeDrawCell_t* cell){
+     if(cell->fg != output->fg || cell->bg != output->bg){
+          vt_output_append(output, "\033[", 2);
+          if(cell->fg != output->fg) vt_output_append_color(output, cell->fg, false);
+          if(cell->fg != output->fg && cell->bg != output->bg) vt_output_append(output, ";", 1);
+          if(cell->bg != output->bg) vt_output_append_color(output, cell->bg, true);
+          vt_output_append(output, "m", 1);
+          output->fg = cell->fg;
+          output->bg = cell->bg;
+     }
+
+     if(cell->rune >= 0x80){
+          char utf8_string[CE_UTF8_SIZE];
+          int64_t bytes_written = 0;
+          ce_utf8_encode(cell->rune, utf8_string, CE_UTF8_SIZE, &bytes_written);
+          vt_output_append(output, utf8_string, bytes_written);
+     }else{
+          char ch = cell->rune;
+          vt_output_append(output, &ch, 1);
+     }
+
+     output->x++;
+}
+
+static void vt_output_move(CeDrawVtOutput_t* output, int64_t x, int64_t y){
+     char sequence[32];
+     int len = snprintf(sequence, sizeof(sequence), "\033[%ld;%ldH", y + 1, x + 1);
+     vt_output_append(output, sequence, len);
+     output->x = x;
+     output->y = y;
+}
+
+// returns how much was written, waits for the terminal to take more output rather than spinning when it is full
+static int64_t vt_write(const char* bytes, int64_t count){
+     int64_t written = 0;
+     while(written < count){
+          ssize_t rc = write(STDOUT_FILENO, bytes + written, count - written);
+          if(rc < 0){
+               if(errno == EINTR) continue;
+               if(errno == EAGAIN || errno == EWOULDBLOCK){
+                    struct pollfd poll_fd = {STDOUT_FILENO, POLLOUT, 0};
+                    if(poll(&poll_fd, 1, -1) >= 0 || errno == EINTR) continue;
+               }
+               ce_log("%s() write() failed: %s\n", __FUNCTION__, strerror(errno));
+               break;
+          }
+          written += rc;
+     }
+     return written;
+}
+
+// build all the escape sequences for the frame, then send them in one go
+static void vt_backend_flush(CeDrawScreen_t* screen, CePoint_t cursor){
+     // nothing is drawn through curses, but it only notices the terminal was resized when it updates
+     refresh();
+
+     CeDrawVtOutput_t* output = &screen->vt_output;
+     output->count = 0;
+
+     // the terminal clamps the cursor when we move it off screen (like when we are behind on a resize), so start each
+     // frame by moving it explicitly
+     output->x = -1;
+     output->y = -1;
+
+     vt_output_append(output, "\033[?25l", 6);
+
+     for(int64_t y = 0; y < screen->height; y++){
+          CeDrawCell_t* row = screen->cells + (y * screen->width);
+          CeDrawCell_t* drawn_row = screen->drawn_cells + (y * screen->width);
+          bool row_changed = false;
+
+          for(int64_t x = 0; x < screen->width; x++){
+               if(memcmp(row + x, drawn_row + x, sizeof(*row)) == 0) continue;
+
+               if(output->y != y || output->x < 0 || output->x > x){
+                    vt_output_move(output, x, y);
+               }else if(output->x < x){
+                    bool reemit = (x - output->x) <= DRAW_VT_REEMIT_MAX;
+                    for(int64_t i = output->x; reemit && i < x; i++){
+                         if(row[i].fg != output->fg || row[i].bg != output->bg) reemit = false;
+                    }
+
+                    if(reemit){
+                         while(output->x < x) vt_output_append_cell(output, row + output->x);
+                    }else{
+                         char sequence[32];
+                         int len = snprintf(sequence, sizeof(sequence), "\033[%ldC", x - output->x);
+                         vt_output_append(output, sequence, len);
+                         output->x = x;
+                    }
+               }
+
+               vt_output_append_cell(output, row + x);
+               drawn_row[x] = row[x];
+               row_changed = true;
+
+               // we don't know whether the terminal has wrapped after writing the last column
+               if(output->x >= screen->width) output->x = -1;
+          }
+
+          if(row_changed) screen->rows_redrawn++;
+     }
+
+     if(output->count == 6 && cursor.x == output->cursor.x && cursor.y == output->cursor.y){
+          // nothing changed
+          output->count = 0;
+     }else{
+          vt_output_move(output, cursor.x, cursor.y);
+          vt_output_append(output, "\033[?25h", 6);
+          output->cursor = cursor;
+     }
+
+     int64_t written = vt_write(output->bytes, output->count);
+     screen->bytes_written = written;
+     screen->total_bytes_written += written;
+}
+
+static void vt_backend_clear(CeDrawScreen_t* screen){
+     // let curses clear the terminal so it agrees with us about what is on it, after this it won't draw anything
+     clear();
+     refresh();
+
+     screen->vt_output.fg = DRAW_VT_COLOR_UNKNOWN;
+     screen->vt_output.bg = DRAW_VT_COLOR_UNKNOWN;
+     screen->vt_output.x = -1;
+     screen->vt_output.y = -1;
+     screen->vt_output.cursor = (CePoint_t){-1, -1};
+}
+
+// leave the terminal with default attributes and a visible cursor for whatever draws next, curses or the shell
+static void vt_backend_stop(CeDrawScreen_t* screen){
+     const char* reset = "\033[0m\033[?25h";
+     vt_write(reset, strlen(reset));
+     screen->vt_output.fg = DRAW_VT_COLOR_UNKNOWN;
+     screen->vt_output.bg = DRAW_VT_COLOR_UNKNOWN;
+}
+
+static const CeDrawBackend_t g_vt_backend = {CE_DRAW_BACKEND_VT, "vt", vt_backend_clear, vt_backend_flush, vt_backend_stop};
+
+static CeDrawViewJob_t* draw_screen_add_view_job(CeDrawScreen_t* screen, CeLayout_t* layout){
+     if(screen->view_job_count >= screen->view_job_capacity){
+          int64_t new_capacity = screen->view_job_capacity ? screen->view_job_capacity * 2 : 8;
+          CeDrawViewJob_t* new_jobs = realloc(screen->view_jobs, new_capacity * sizeof(*new_jobs));
+          if(!new_jobs) return NULL;
+          memset(new_jobs + screen->view_job_capacity, 0, (new_capacity - screen->view_job_capacity) * sizeof(*new_jobs));
+          screen->view_jobs = new_jobs;
+          int64_t* new_buffer_jobs = realloc(screen->buffer_jobs, new_capacity * sizeof(*new_buffer_jobs));
+          if(!new_buffer_jobs) return NULL;
+          screen->buffer_jobs = new_buffer_jobs;
+          screen->view_job_capacity = new_capacity;
+     }
+
+     CeDrawViewJob_t* job = screen->view_jobs + screen->view_job_count++;
+     job->layout = layout;
+     job->syntax_function = NULL;
+     job->needs_redraw = false;
+     job->next_same_buffer = -1;
+     ce_draw_color_list_clear(&job->draw_color_list);
+     ce_range_list_clear(&job->range_list);
+     return job;
+}
+
+static CeDrawViewJob_t* draw_screen_find_view_job(CeDrawScreen_t* screen, CeLayout_t* layout){
+     for(int64_t i = 0; i < screen->view_job_count; i++){
+          if(screen->view_jobs[i].layout == layout) return screen->view_jobs + i;
+     }
+     return NULL;
+}
+
+// only buffers the main thread alone writes are handed to the highlight pool
+static bool view_job_for_pool(CeDrawViewJob_t* job){
+     return job->needs_redraw && job->syntax_function && !job->layout->view.buffer->no_token_cache;
+}
+
+// links the views that show the same buffer, returns how many buffers have views for the highlight pool
+static int64_t chain_view_jobs_by_buffer(CeDrawScreen_t* screen){
+     int64_t buffer_job_count = 0;
+     for(int64_t i = 0; i < screen->view_job_count; i++){
+          CeDrawViewJob_t* job = screen->view_jobs + i;
+          if(!view_job_for_pool(job)) continue;
+
+          int64_t last_same_buffer = -1;
+          for(int64_t j = 0; j < i; j++){
+               CeDrawViewJob_t* other = screen->view_jobs + j;
+               if(view_job_for_pool(other) && other->layout->view.buffer == job->layout->view.buffer){
+                    last_same_buffer = j;
+               }
+          }
+
+          if(last_same_buffer >= 0){
+               screen->view_jobs[last_same_buffer].next_same_buffer = i;
+          }else{
+               screen->buffer_jobs[buffer_job_count++] = i;
+          }
+     }
+     return buffer_job_count;
+}
+
+static void highlight_view_jobs(CeDrawViewJob_t* jobs, int64_t first, CeSyntaxDef_t* syntax_defs){
+     for(int64_t i = first; i >= 0; i = jobs[i].next_same_buffer){
+          CeDrawViewJob_t* job = jobs + i;
+          job->syntax_function(&job->layout->view, &job->range_list, &job->draw_color_list, syntax_defs,
+                               job->layout->view.buffer->syntax_data);
+     }
+}
+
+static void highlight_pool_run_jobs(CeHighlightPool_t* pool){
+     int64_t index;
+     while((index = __atomic_fetch_add(&pool->next_buffer_job, 1, __ATOMIC_ACQ_REL)) < pool->buffer_job_count){
+          highlight_view_jobs(pool->jobs, pool->buffer_jobs[index], pool->syntax_defs);
+     }
+}
+
+static void* highlight_pool_thread(void* data){
+     CeHighlightPool_t* pool = data;
+     int64_t generation = 0;
+
+     pthread_mutex_lock(&pool->lock);
+     while(true){
+          while(!pool->quit && pool->generation == generation) pthread_cond_wait(&pool->work_ready, &pool->lock);
+          if(pool->quit) break;
+          generation = pool->generation;
+          pthread_mutex_unlock(&pool->lock);
+
+          highlight_pool_run_jobs(pool);
+
+          pthread_mutex_lock(&pool->lock);
+          pool->threads_working--;
+          if(pool->threads_working == 0) pthread_cond_signal(&pool->work_done);
+     }
+     pthread_mutex_unlock(&pool->lock);
+     return NULL;
+}
+
+static void highlight_pool_start(CeHighlightPool_t* pool, int64_t thread_count){
+     pthread_mutex_init(&pool->lock, NULL);
+     pthread_cond_init(&pool->work_ready, NULL);
+     pthread_cond_init(&pool->work_done, NULL);
+     if(thread_count <= 0) return;
+
+     pool->threads = calloc(thread_count, sizeof(*pool->threads));
+     if(!pool->threads) return;
+
+     for(int64_t i = 0; i < thread_count; i++){
+          int rc = pthread_create(pool->threads + i, NULL, highlight_pool_thread, pool);
+          if(rc != 0){
+               ce_log("pthread_create() failed: '%s'\n", strerror(rc));
+               break;
+          }
+          pool->thread_count++;
+     }
+}
+
+static void highlight_pool_stop(CeHighlightPool_t* pool){
+     pthread_mutex_lock(&pool->lock);
+     pool->quit = true;
+     pthread_cond_broadcast(&pool->work_ready);
+     pthread_mutex_unlock(&pool->lock);
+
+     for(int64_t i = 0; i < pool->thread_count; i++){
+          pthread_join(pool->threads[i], NULL);
+     }
+     free(pool->threads);
+     pool->threads = NULL;
+     pool->thread_count = 0;
+
+     pthread_cond_destroy(&pool->work_done);
+     pthread_cond_destroy(&pool->work_ready);
+     pthread_mutex_destroy(&pool->lock);
+}
+
+// each buffer's views are highlighted by whichever thread gets to them first, including this one, returns once every view
+// is highlighted, buffers another thread writes (like the shell command buffer) are left out of the jobs so the ones the
+// pool reads can only change on the main thread, which is waiting here
+static void highlight_pool_highlight(CeHighlightPool_t* pool, CeDrawViewJob_t* jobs, int64_t* buffer_jobs,
+                                     int64_t buffer_job_count, CeSyntaxDef_t* syntax_defs){
+     if(pool->thread_count == 0 || buffer_job_count < 2){
+          for(int64_t i = 0; i < buffer_job_count; i++){
+               highlight_view_jobs(jobs, buffer_jobs[i], syntax_defs);
+          }
+          return;
+     }
+
+     pthread_mutex_lock(&pool->lock);
+     pool->jobs = jobs;
+     pool->buffer_jobs = buffer_jobs;
+     pool->buffer_job_count = buffer_job_count;
+     pool->next_buffer_job = 0;
+     pool->syntax_defs = syntax_defs;
+     pool->threads_working = pool->thread_count;
+     pool->generation++;
+     pthread_cond_broadcast(&pool->work_ready);
+     pthread_mutex_unlock(&pool->lock);
+
+     highlight_pool_run_jobs(pool);
+
+     pthread_mutex_lock(&pool->lock);
+     while(pool->threads_working > 0) pthread_cond_wait(&pool->work_done, &pool->lock);
+     pthread_mutex_unlock(&pool->lock);
+}
+
+static bool view_needs_redraw(CeViewDrawState_t* state, CeView_t* view, CeSyntaxHighlightFunc_t* syntax_function,
+                              uint64_t highlight_hash, CeDrawScreen_t* screen){
+     bool redraw = (screen->redraw_all ||
+                    state->frame != (screen->frame - 1) ||
+                    state->buffer != view->buffer ||
+                    state->buffer_version != view->buffer->version ||
+                    state->syntax_function != syntax_function ||
+                    memcmp(&state->rect, &view->rect, sizeof(state->rect)) != 0 ||
+                    !ce_points_equal(state->scroll, view->scroll) ||
+                    !ce_points_equal(state->cursor, view->cursor) ||
+                    state->highlight_hash != highlight_hash);
+
+     state->buffer = view->buffer;
+     state->buffer_version = view->buffer->version;
+     state->syntax_function = syntax_function;
+     state->rect = view->rect;
+     state->scroll = view->scroll;
+     state->cursor = view->cursor;
+     state->highlight_hash = highlight_hash;
+     state->frame = screen->frame;
+     return redraw;
+}
+
+static uint64_t hash_highlights(CeRangeList_t* range_list, CeMultipleCursors_t* multiple_cursors){
+     uint64_t hash = FNV_OFFSET_BASIS;
+     for(CeRangeNode_t* itr = range_list->head; itr; itr = itr->next){
+          hash = hash_bytes(hash, &itr->range, sizeof(itr->range));
+     }
+
+     if(multiple_cursors){
+          hash = hash_bytes(hash, &multiple_cursors->active, sizeof(multiple_cursors->active));
+          hash = hash_bytes(hash, multiple_cursors->cursors, multiple_cursors->count * sizeof(*multiple_cursors->cursors));
+     }
+     return hash;
+}
+
+void draw_view(CeDrawScreen_t* screen, CeView_t* view, int64_t tab_width, CeLineNumber_t line_number,
+               CeVisualLineDisplayType_t visual_line_display_type, CeMultipleCursors_t* multiple_cursors,
+               CeDrawColorList_t* draw_color_list, CeSyntaxDef_t* syntax_defs){
      int64_t view_width = ce_view_width(view);
      int64_t view_height = ce_view_height(view);
      int64_t row_min = view->scroll.y;
      int64_t col_min = view->scroll.x;
      int64_t col_max = col_min + view_width;
 
-     char tab_str[tab_width + 1];
-     memset(tab_str, ' ', tab_width);
-     tab_str[tab_width] = 0;
-
      CeDrawColorNode_t* draw_color_node = draw_color_list->head;
 
      // figure out how wide the line number margin needs to be
@@ -232,8 +791,8 @@ void draw_view(CeView_t* view, int64_t tab_width, CeLineNumber_t line_number, Ce
                int64_t line_index = y + row_min;
                CeRune_t rune = 1;
                int64_t real_y = y + view->scroll.y;
-
-               move(view->rect.top + y, view->rect.left);
+               int64_t screen_x = view->rect.left;
+               int64_t screen_y = view->rect.top + y;
 
                if(!view->buffer->no_line_numbers && line_number){
                     int fg = COLOR_DEFAULT;
@@ -244,29 +803,41 @@ void draw_view(CeView_t* view, int64_t tab_width, CeLineNumber_t line_number, Ce
                     }
                     fg = ce_syntax_def_get_fg(syntax_defs, CE_SYNTAX_COLOR_LINE_NUMBER, fg);
                     bg = ce_syntax_def_get_bg(syntax_defs, CE_SYNTAX_COLOR_LINE_NUMBER, bg);
-                    int change_color_pair = ce_color_def_get(color_defs, fg, bg);
-                    attron(COLOR_PAIR(change_color_pair));
                     int value = real_y + 1;
                     if(line_number == CE_LINE_NUMBER_RELATIVE || (line_number == CE_LINE_NUMBER_ABSOLUTE_AND_RELATIVE && view->cursor.y != real_y)){
                          value = abs((int)(view->cursor.y - real_y));
                     }
-                    printw("%*d ", line_number_size, value);
+                    char line_number_string[32];
+                    snprintf(line_number_string, 32, "%*d ", line_number_size, value);
+                    screen_x = draw_screen_put_string(screen, screen_x, screen_y, view->rect.right, line_number_string, fg, bg);
                }
 
-               standend();
+               int draw_fg = COLOR_DEFAULT;
+               int draw_bg = COLOR_DEFAULT;
                if(!view->buffer->no_highlight_current_line && real_y == view->cursor.y){
-                    int bg = ce_syntax_def_get_bg(syntax_defs, CE_SYNTAX_COLOR_CURRENT_LINE, COLOR_DEFAULT);
-                    int change_color_pair = ce_color_def_get(color_defs, COLOR_DEFAULT, bg);
-                    attron(COLOR_PAIR(change_color_pair));
+                    draw_bg = ce_syntax_def_get_bg(syntax_defs, CE_SYNTAX_COLOR_CURRENT_LINE, COLOR_DEFAULT);
                }else if(draw_color_node && ce_point_after((CePoint_t){index, y + view->scroll.y}, draw_color_node->point)){
-                    int change_color_pair = ce_color_def_get(color_defs, draw_color_node->fg, draw_color_node->bg);
-                    attron(COLOR_PAIR(change_color_pair));
+                    draw_fg = draw_color_node->fg;
+                    draw_bg = draw_color_node->bg;
                }
 
                if(line_index < view->buffer->line_count){
                     const char* line = view->buffer->lines[y + row_min];
 
                     while(rune > 0){
+                         // nothing past the right edge is visible, so don't walk the rest of very long lines, but
+                         // skip the colors they would have used so the next line starts from the right node
+                         if(x > col_max){
+                              while(draw_color_node && draw_color_node->point.y <= real_y){
+                                   last_bg = draw_color_node->bg;
+                                   if(!view->buffer->no_highlight_current_line && last_bg == COLOR_DEFAULT && real_y == view->cursor.y){
+                                        last_bg = ce_syntax_def_get_bg(syntax_defs, CE_SYNTAX_COLOR_CURRENT_LINE, last_bg);
+                                   }
+                                   last_fg = draw_color_node->fg;
+                                   draw_color_node = draw_color_node->next;
+                              }
+                              break;
+                         }
                          rune = ce_utf8_decode(line, &rune_len);
 
                          // check if we need to move to the next color
@@ -276,8 +847,8 @@ void draw_view(CeView_t* view, int64_t tab_width, CeLineNumber_t line_number, Ce
                                    bg = ce_syntax_def_get_bg(syntax_defs, CE_SYNTAX_COLOR_CURRENT_LINE, bg);
                               }
 
-                              int change_color_pair = ce_color_def_get(color_defs, draw_color_node->fg, bg);
-                              attron(COLOR_PAIR(change_color_pair));
+                              draw_fg = draw_color_node->fg;
+                              draw_bg = bg;
                               last_bg = bg;
                               last_fg = draw_color_node->fg;
                               draw_color_node = draw_color_node->next;
@@ -286,20 +857,20 @@ void draw_view(CeView_t* view, int64_t tab_width, CeLineNumber_t line_number, Ce
                          if(x >= col_min &&
                             x <= col_max &&
                             rune > 0){
-                              bool showed_one_of_the_multiple_cursors = false;
+                              int rune_fg = draw_fg;
+                              int rune_bg = draw_bg;
 
                               if(multiple_cursors){
                                    for(int64_t m = 0; m < multiple_cursors->count; m++){
                                         if(real_y == multiple_cursors->cursors[m].y && x == multiple_cursors->cursors[m].x){
-                                             int new_bg = 0;
                                              if(multiple_cursors->active){
-                                                  new_bg = ce_syntax_def_get_bg(syntax_defs, CE_SYNTAX_COLOR_MULTIPLE_CURSOR_ACTIVE, last_bg);
+                                                  rune_bg = ce_syntax_def_get_bg(syntax_defs, CE_SYNTAX_COLOR_MULTIPLE_CURSOR_ACTIVE, last_bg);
                                              }else{
-                                                  new_bg = ce_syntax_def_get_bg(syntax_defs, CE_SYNTAX_COLOR_MULTIPLE_CURSOR_INACTIVE, last_bg);
+                                                  rune_bg = ce_syntax_def_get_bg(syntax_defs, CE_SYNTAX_COLOR_MULTIPLE_CURSOR_INACTIVE, last_bg);
                                              }
-                                             int change_color_pair = ce_color_def_get(color_defs, last_fg, new_bg);
-                                             attron(COLOR_PAIR(change_color_pair));
-                                             showed_one_of_the_multiple_cursors = true;
+                                             rune_fg = last_fg;
+                                             draw_fg = last_fg;
+                                             draw_bg = last_bg;
                                              break;
                                         }
                                    }
@@ -307,23 +878,13 @@ void draw_view(CeView_t* view, int64_t tab_width, CeLineNumber_t line_number, Ce
 
                               if(rune == CE_TAB){
                                    x += tab_width;
-                                   addstr(tab_str);
-                              }else if(rune >= 0x80){
-                                   char utf8_string[CE_UTF8_SIZE + 1];
-                                   int64_t bytes_written = 0;
-                                   ce_utf8_encode(rune, utf8_string, CE_UTF8_SIZE, &bytes_written);
-                                   utf8_string[bytes_written] = 0;
-                                   addstr(utf8_string);
-                                   x++;
+                                   for(int64_t t = 0; t < tab_width; t++){
+                                        screen_x += draw_screen_put_rune(screen, screen_x, screen_y, view->rect.right, ' ', rune_fg, rune_bg);
+                                   }
                               }else{
-                                   addch(rune);
+                                   screen_x += draw_screen_put_rune(screen, screen_x, screen_y, view->rect.right, rune, rune_fg, rune_bg);
                                    x++;
                               }
-
-                              if(showed_one_of_the_multiple_cursors){
-                                   int change_color_pair = ce_color_def_get(color_defs, last_fg, last_bg);
-                                   attron(COLOR_PAIR(change_color_pair));
-                              }
                          }else if(rune == CE_TAB){
                               x += tab_width;
                          }else{
@@ -333,48 +894,36 @@ void draw_view(CeView_t* view, int64_t tab_width, CeLineNumber_t line_number, Ce
                          line += rune_len;
                          index++;
                     }
-
-                    x--;
                }
 
-               if(x < col_min) x = col_min;
                switch(visual_line_display_type){
                default:
-                    break;
                case CE_VISUAL_LINE_DISPLAY_TYPE_FULL_LINE:
-                    for(; x <= col_max; x++) addch(' ');
                     break;
                case CE_VISUAL_LINE_DISPLAY_TYPE_INCLUDE_NEWLINE:
-                    addch(' ');
-                    x++;
+                    screen_x += draw_screen_put_rune(screen, screen_x, screen_y, view->rect.right, ' ', draw_fg, draw_bg);
                // intentional fall through
                case CE_VISUAL_LINE_DISPLAY_TYPE_EXCLUDE_NEWLINE:
-                    standend();
+                    draw_fg = COLOR_DEFAULT;
+                    draw_bg = COLOR_DEFAULT;
                     if(!view->buffer->no_highlight_current_line && real_y == view->cursor.y){
-                         int bg = ce_syntax_def_get_bg(syntax_defs, CE_SYNTAX_COLOR_CURRENT_LINE, COLOR_DEFAULT);
-                         int change_color_pair = ce_color_def_get(color_defs, COLOR_DEFAULT, bg);
-                         attron(COLOR_PAIR(change_color_pair));
+                         draw_bg = ce_syntax_def_get_bg(syntax_defs, CE_SYNTAX_COLOR_CURRENT_LINE, COLOR_DEFAULT);
                     }
-                    for(; x <= col_max; x++) addch(' ');
                     break;
                }
+
+               // the rest of the row is blank
+               draw_screen_fill(screen, screen_x, view->rect.right, screen_y, draw_fg, draw_bg);
           }
-     }else{
-          standend();
      }
 }
 
-void draw_view_status(CeView_t* view, CeVim_t* vim, CeMacros_t* macros, CeMultipleCursors_t* multiple_cursors,
-                      CeColorDefs_t* color_defs, int64_t height_offset, int ui_fg_color, int ui_bg_color){
+void draw_view_status(CeDrawScreen_t* screen, CeView_t* view, CeVim_t* vim, CeMacros_t* macros, CeMultipleCursors_t* multiple_cursors,
+                      int64_t height_offset, int ui_fg_color, int ui_bg_color){
      // create bottom bar bg
      int64_t bottom = view->rect.bottom + height_offset;
-     int color_pair = ce_color_def_get(color_defs, ui_fg_color, ui_bg_color);
-     attron(COLOR_PAIR(color_pair));
-     int64_t width = (view->rect.right - view->rect.left) + 1;
-     move(bottom, view->rect.left);
-     for(int64_t i = 0; i < width; ++i){
-          addch(' ');
-     }
+     int64_t right = view->rect.right;
+     draw_screen_fill(screen, view->rect.left, right, bottom, ui_fg_color, ui_bg_color);
 
      // set the mode line
      int vim_mode_fg = ui_fg_color;
@@ -411,68 +960,69 @@ void draw_view_status(CeView_t* view, CeVim_t* vim, CeMacros_t* macros, CeMultip
           }
      }
 
+     int64_t x = view->rect.left + 1;
      if(vim_mode_string){
-          color_pair = ce_color_def_get(color_defs, vim_mode_fg, ui_bg_color);
-          attron(COLOR_PAIR(color_pair));
-          mvprintw(bottom, view->rect.left + 1, "%s", vim_mode_string);
-
-          color_pair = ce_color_def_get(color_defs, ui_fg_color, ui_bg_color);
-          attron(COLOR_PAIR(color_pair));
-          printw(" %s", view->buffer->name);
-     }else{
-          color_pair = ce_color_def_get(color_defs, ui_fg_color, ui_bg_color);
-          attron(COLOR_PAIR(color_pair));
-          mvprintw(bottom, view->rect.left + 1, "%s", view->buffer->name);
+          x = draw_screen_put_string(screen, x, bottom, right, vim_mode_string, vim_mode_fg, ui_bg_color);
+          x = draw_screen_put_string(screen, x, bottom, right, " ", ui_fg_color, ui_bg_color);
      }
 
+     x = draw_screen_put_string(screen, x, bottom, right, view->buffer->name, ui_fg_color, ui_bg_color);
+
      const char* status_str = buffer_status_get_str(view->buffer->status);
-     if(status_str) printw(status_str);
+     if(status_str) x = draw_screen_put_string(screen, x, bottom, right, status_str, ui_fg_color, ui_bg_color);
+
+     CeAppBufferData_t* buffer_data = view->buffer->app_data;
+     if(buffer_data && buffer_data->large_file){
+          x = draw_screen_put_string(screen, x, bottom, right, " LARGE FILE", COLOR_RED, ui_bg_color);
+     }
 
      if(vim_mode_string && ce_macros_is_recording(macros)){
-          printw(" RECORDING %c", macros->recording);
+          char recording_string[16];
+          snprintf(recording_string, 16, " RECORDING %c", macros->recording);
+          x = draw_screen_put_string(screen, x, bottom, right, recording_string, ui_fg_color, ui_bg_color);
      }
 
 #ifdef ENABLE_DEBUG_KEY_PRESS_INFO
-     if(vim_mode_string) printw(" %s %d ", keyname(g_last_key), g_last_key);
+     if(vim_mode_string){
+          char key_string[64];
+          snprintf(key_string, 64, " %s %d ", keyname(g_last_key), g_last_key);
+          x = draw_screen_put_string(screen, x, bottom, right, key_string, ui_fg_color, ui_bg_color);
+     }
 #endif
 
      char cursor_pos_string[32];
      int64_t cursor_pos_string_len = snprintf(cursor_pos_string, 32, "%ld, %ld", view->cursor.x + 1, view->cursor.y + 1);
-     mvprintw(bottom, view->rect.right - (cursor_pos_string_len + 1), "%s", cursor_pos_string);
+     draw_screen_put_string(screen, right - (cursor_pos_string_len + 1), bottom, right, cursor_pos_string, ui_fg_color, ui_bg_color);
 
      if(multiple_cursors && multiple_cursors->count){
-          if(multiple_cursors->active){
-               color_pair = ce_color_def_get(color_defs, COLOR_GREEN, ui_bg_color);
-          }else{
-               color_pair = ce_color_def_get(color_defs, COLOR_RED, ui_bg_color);
-          }
-
-          attron(COLOR_PAIR(color_pair));
-
+          int multiple_cursor_fg = multiple_cursors->active ? COLOR_GREEN : COLOR_RED;
           int64_t multiple_cursor_string_len = snprintf(cursor_pos_string, 32, "(%ld)", multiple_cursors->count);
-          mvprintw(bottom, view->rect.right - (cursor_pos_string_len + 1) - (multiple_cursor_string_len + 1), "%s", cursor_pos_string);
+          draw_screen_put_string(screen, right - (cursor_pos_string_len + 1) - (multiple_cursor_string_len + 1), bottom, right,
+                                 cursor_pos_string, multiple_cursor_fg, ui_bg_color);
      }
 }
 
-void draw_layout(CeLayout_t* layout, CeVim_t* vim, CeVimVisualData_t* visual, CeMacros_t* macros, CeTerminalList_t* terminal_list,
-                 CeBuffer_t* input_buffer, CeColorDefs_t* color_defs, int64_t tab_width, CeLineNumber_t line_number,
-                 CeVisualLineDisplayType_t visual_line_display_type, CeMultipleCursors_t* multiple_cursors,
-                 CeLayout_t* current, CeSyntaxDef_t* syntax_defs, int64_t terminal_width, bool highlight_search,
-                 int ui_fg_color, int ui_bg_color){
+// works out what to highlight in each view and whether it needs to be redrawn, the highlighting itself happens after
+// every view has been visited so the views can be highlighted at the same time
+static void collect_view_jobs(CeLayout_t* layout, CeVim_t* vim, CeVimVisualData_t* visual, CeTerminalList_t* terminal_list,
+                              CeBuffer_t* input_buffer, CeDrawScreen_t* screen, CeMultipleCursors_t* multiple_cursors,
+                              CeLayout_t* current, bool highlight_search){
      switch(layout->type){
      default:
           break;
      case CE_LAYOUT_TYPE_VIEW:
      {
-          CeDrawColorList_t draw_color_list = {};
+          CeDrawViewJob_t* job = draw_screen_add_view_job(screen, layout);
+          if(!job) break;
+          CeRangeList_t* range_list = &job->range_list;
           CeAppBufferData_t* buffer_data = layout->view.buffer->app_data;
+          CeAppViewData_t* view_data = layout->view.user_data;
 
           // update which terminal buffer we are viewing
           CeTerminal_t* terminal = ce_buffer_in_terminal_list(layout->view.buffer, terminal_list);
-          if(terminal) layout->view.buffer = terminal->buffer;
+          if(terminal) layout->view.buffer = terminal->snapshot.buffer;
 
           if(buffer_data->syntax_function){
-               CeRangeList_t range_list = {};
                // add to the highlight range list only if this is the current view
                if(layout == current){
                     switch(vim->mode){
@@ -482,13 +1032,13 @@ void draw_layout(CeLayout_t* layout, CeVim_t* vim, CeVimVisualData_t* visual, Ce
                     {
                          CeRange_t range = {visual->point, layout->view.cursor};
                          ce_range_sort(&range);
-                         ce_range_list_insert(&range_list, range.start, range.end);
+                         ce_range_list_insert(range_list, range.start, range.end);
 
                          if(multiple_cursors && multiple_cursors->active){
                               for(int64_t i = 0; i < multiple_cursors->count; i++){
                                    range = (CeRange_t){multiple_cursors->visuals[i].point, multiple_cursors->cursors[i]};
                                    ce_range_sort(&range);
-                                   ce_range_list_insert_sorted(&range_list, range.start, range.end);
+                                   ce_range_list_insert_sorted(range_list, range.start, range.end);
                               }
                          }
                     } break;
@@ -498,7 +1048,7 @@ void draw_layout(CeLayout_t* layout, CeVim_t* vim, CeVimVisualData_t* visual, Ce
                          ce_range_sort(&range);
                          range.start.x = 0;
                          range.end.x = ce_utf8_last_index(layout->view.buffer->lines[range.end.y]) + 1;
-                         ce_range_list_insert(&range_list, range.start, range.end);
+                         ce_range_list_insert(range_list, range.start, range.end);
 
                          if(multiple_cursors && multiple_cursors->active){
                               for(int64_t i = 0; i < multiple_cursors->count; i++){
@@ -506,7 +1056,7 @@ void draw_layout(CeLayout_t* layout, CeVim_t* vim, CeVimVisualData_t* visual, Ce
                                    ce_range_sort(&range);
                                    range.start.x = 0;
                                    range.end.x = ce_utf8_last_index(layout->view.buffer->lines[range.end.y]) + 1;
-                                   ce_range_list_insert_sorted(&range_list, range.start, range.end);
+                                   ce_range_list_insert_sorted(range_list, range.start, range.end);
                               }
                          }
                     } break;
@@ -526,7 +1076,7 @@ void draw_layout(CeLayout_t* layout, CeVim_t* vim, CeVimVisualData_t* visual, Ce
                          for(int64_t i = range.start.y; i <= range.end.y; i++){
                               CePoint_t start = {range.start.x, i};
                               CePoint_t end = {range.end.x, i};
-                              ce_range_list_insert(&range_list, start, end);
+                              ce_range_list_insert(range_list, start, end);
                          }
 
                          if(multiple_cursors && multiple_cursors->active){
@@ -546,7 +1096,7 @@ void draw_layout(CeLayout_t* layout, CeVim_t* vim, CeVimVisualData_t* visual, Ce
                                    for(int64_t i = range.start.y; i <= range.end.y; i++){
                                         CePoint_t start = {range.start.x, i};
                                         CePoint_t end = {range.end.x, i};
-                                        ce_range_list_insert_sorted(&range_list, start, end);
+                                        ce_range_list_insert_sorted(range_list, start, end);
                                    }
                               }
                          }
@@ -555,7 +1105,7 @@ void draw_layout(CeLayout_t* layout, CeVim_t* vim, CeVimVisualData_t* visual, Ce
                }
 
                // TODO: doesn't work for multiline searches
-               if(highlight_search){
+               if(highlight_search && !layout->view.buffer->no_search_highlight){
                     const char* pattern = NULL;
 
                     if((strcmp(input_buffer->name, "Search") == 0 ||
@@ -585,7 +1135,7 @@ void draw_layout(CeLayout_t* layout, CeVim_t* vim, CeVimVisualData_t* visual, Ce
                                    while((match = strstr(itr, pattern))){
                                         CePoint_t start = {ce_utf8_strlen_between(layout->view.buffer->lines[i], match) - 1, i};
                                         CePoint_t end = {start.x + (pattern_len - 1), i};
-                                        ce_range_list_insert(&range_list, start, end);
+                                        ce_range_list_insert(range_list, start, end);
                                         itr = match + pattern_len;
                                    }
                               }
@@ -607,7 +1157,7 @@ void draw_layout(CeLayout_t* layout, CeVim_t* vim, CeVimVisualData_t* visual, Ce
                                                   if(match_len > 0){
                                                        CePoint_t start = {prev_end_x + matches[0].rm_so, i};
                                                        CePoint_t end = {start.x + (match_len - 1), i};
-                                                       ce_range_list_insert(&range_list, start, end);
+                                                       ce_range_list_insert(range_list, start, end);
                                                        itr = ce_utf8_iterate_to(itr, matches[0].rm_so + match_len);
                                                        prev_end_x = end.x + 1;
                                                   }else{
@@ -622,35 +1172,61 @@ void draw_layout(CeLayout_t* layout, CeVim_t* vim, CeVimVisualData_t* visual, Ce
                          }
                     }
                }
+          }
+
+          // skip highlighting and drawing views that look the same as they did last frame
+          uint64_t highlight_hash = hash_highlights(range_list, multiple_cursors);
+          job->syntax_function = buffer_data->syntax_function;
+          job->needs_redraw = view_needs_redraw(&view_data->draw_state, &layout->view, buffer_data->syntax_function,
+                                                highlight_hash, screen);
+     } break;
+     case CE_LAYOUT_TYPE_LIST:
+          for(int64_t i = 0; i < layout->list.layout_count; i++){
+               collect_view_jobs(layout->list.layouts[i], vim, visual, terminal_list, input_buffer, screen, multiple_cursors,
+                                 current, highlight_search);
+          }
+          break;
+     case CE_LAYOUT_TYPE_TAB:
+          collect_view_jobs(layout->tab.root, vim, visual, terminal_list, input_buffer, screen, multiple_cursors, current,
+                            highlight_search);
+          break;
+     }
+}
 
-               buffer_data->syntax_function(&layout->view, &range_list, &draw_color_list, syntax_defs,
-                                            layout->view.buffer->syntax_data);
-               ce_range_list_free(&range_list);
+void draw_layout(CeLayout_t* layout, CeVim_t* vim, CeMacros_t* macros, CeDrawScreen_t* screen, int64_t tab_width,
+                 CeLineNumber_t line_number, CeVisualLineDisplayType_t visual_line_display_type,
+                 CeMultipleCursors_t* multiple_cursors, CeLayout_t* current, CeSyntaxDef_t* syntax_defs, int64_t terminal_width,
+                 int ui_fg_color, int ui_bg_color){
+     switch(layout->type){
+     default:
+          break;
+     case CE_LAYOUT_TYPE_VIEW:
+     {
+          CeDrawViewJob_t* job = draw_screen_find_view_job(screen, layout);
+          if(job && job->needs_redraw){
+               draw_view(screen, &layout->view, tab_width, line_number, visual_line_display_type, multiple_cursors,
+                         &job->draw_color_list, syntax_defs);
+               screen->views_redrawn++;
           }
 
-          draw_view(&layout->view, tab_width, line_number, visual_line_display_type, multiple_cursors, &draw_color_list, color_defs, syntax_defs);
-          ce_draw_color_list_free(&draw_color_list);
-          draw_view_status(&layout->view, layout == current ? vim : NULL, macros, multiple_cursors, color_defs, 0,
+          draw_view_status(screen, &layout->view, layout == current ? vim : NULL, macros, multiple_cursors, 0,
                            ui_fg_color, ui_bg_color);
           int64_t rect_height = layout->view.rect.bottom - layout->view.rect.top;
-          int color_pair = ce_color_def_get(color_defs, ui_fg_color, ui_bg_color);
-          attron(COLOR_PAIR(color_pair));
           if(layout->view.rect.right < (terminal_width - 1)){
                for(int i = 0; i < rect_height; i++){
-                    mvaddch(layout->view.rect.top + i, layout->view.rect.right, ' ');
+                    draw_screen_put(screen, layout->view.rect.right, layout->view.rect.top + i, ' ', ui_fg_color, ui_bg_color);
                }
           }
      } break;
      case CE_LAYOUT_TYPE_LIST:
           for(int64_t i = 0; i < layout->list.layout_count; i++){
-               draw_layout(layout->list.layouts[i], vim, visual, macros, terminal_list, input_buffer, color_defs, tab_width,
-                           line_number, visual_line_display_type, multiple_cursors, current, syntax_defs, terminal_width, highlight_search,
-                           ui_fg_color, ui_bg_color);
+               draw_layout(layout->list.layouts[i], vim, macros, screen, tab_width, line_number, visual_line_display_type,
+                           multiple_cursors, current, syntax_defs, terminal_width, ui_fg_color, ui_bg_color);
           }
           break;
      case CE_LAYOUT_TYPE_TAB:
-          draw_layout(layout->tab.root, vim, visual, macros, terminal_list, input_buffer, color_defs, tab_width, line_number,
-                      visual_line_display_type, multiple_cursors, current, syntax_defs, terminal_width, highlight_search, ui_fg_color, ui_bg_color);
+          draw_layout(layout->tab.root, vim, macros, screen, tab_width, line_number, visual_line_display_type,
+                      multiple_cursors, current, syntax_defs, terminal_width, ui_fg_color, ui_bg_color);
           break;
      }
 }
@@ -661,38 +1237,39 @@ uint64_t time_between(struct timeval previous, struct timeval current){
 }
 
 void draw(CeApp_t* app){
-     CeColorDefs_t color_defs = {};
+     CeDrawScreen_t* screen = &app->draw_screen;
+     CeConfigOptions_t* config_options = &app->config_options;
 
      CeLayout_t* tab_list_layout = app->tab_list_layout;
      CeLayout_t* tab_layout = tab_list_layout->tab_list.current;
 
-     // draw a tab bar if there is more than 1 tab
-     if(tab_list_layout->tab_list.tab_count > 1){
-          move(0, 0);
-          int color_pair = ce_color_def_get(&color_defs, app->config_options.ui_fg_color, app->config_options.ui_bg_color);
-          attron(COLOR_PAIR(color_pair));
-          for(int64_t i = tab_list_layout->tab_list.rect.left; i <= tab_list_layout->tab_list.rect.right; i++){
-               addch(' ');
-          }
-
-          move(0, 0);
-
-          for(int64_t i = 0; i < tab_list_layout->tab_list.tab_count; i++){
-               if(tab_list_layout->tab_list.tabs[i] == tab_list_layout->tab_list.current){
-                    color_pair = ce_color_def_get(&color_defs, COLOR_DEFAULT, COLOR_DEFAULT);
-                    attron(COLOR_PAIR(color_pair));
-               }else{
-                    color_pair = ce_color_def_get(&color_defs, app->config_options.ui_fg_color, app->config_options.ui_bg_color);
-                    attron(COLOR_PAIR(color_pair));
-               }
+     int screen_width = 0;
+     int screen_height = 0;
+     getmaxyx(stdscr, screen_height, screen_width);
+     if(screen_width != screen->width || screen_height != screen->height){
+          draw_screen_resize(screen, screen_width, screen_height);
+     }
 
-               if(tab_list_layout->tab_list.tabs[i]->tab.current->type == CE_LAYOUT_TYPE_VIEW){
-                    const char* buffer_name = tab_list_layout->tab_list.tabs[i]->tab.current->view.buffer->name;
+     const CeDrawBackend_t* backend = &g_curses_backend;
+     if(config_options->draw_backend == CE_DRAW_BACKEND_VT) backend = &g_vt_backend;
+     if(screen->backend != backend){
+          if(screen->backend && screen->backend->stop) screen->backend->stop(screen);
+          screen->backend = backend;
+          screen->invalidated = true;
+     }
 
-                    printw(" %s ", buffer_name);
-               }else{
-                    printw(" selection ");
-               }
+     screen->frame++;
+     screen->views_redrawn = 0;
+     screen->rows_redrawn = 0;
+     screen->bytes_written = 0;
+
+     if(screen->invalidated){
+          // we don't know what is on the terminal anymore, so start over and send every cell
+          screen->backend->clear_screen(screen);
+          int64_t cell_count = screen->width * screen->height;
+          for(int64_t i = 0; i < cell_count; i++){
+               screen->cells[i] = (CeDrawCell_t){' ', COLOR_DEFAULT, COLOR_DEFAULT};
+               screen->drawn_cells[i] = (CeDrawCell_t){CE_UTF8_INVALID, COLOR_DEFAULT, COLOR_DEFAULT};
           }
      }
 
@@ -701,31 +1278,14 @@ void draw(CeApp_t* app){
      // update cursor if it is on a terminal
      CeTerminal_t* terminal = ce_buffer_in_terminal_list(view->buffer, &app->terminal_list);
      if(terminal && app->vim.mode == CE_VIM_MODE_INSERT){
-          view->cursor.x = terminal->cursor.x;
-          view->cursor.y = terminal->cursor.y + terminal->start_line;
-     }
-
-     standend();
-     draw_layout(tab_layout, &app->vim, &app->visual, &app->macros, &app->terminal_list, app->input_view.buffer, &color_defs,
-                 app->config_options.tab_width, app->config_options.line_number, app->config_options.visual_line_display_type,
-                 &app->multiple_cursors, tab_layout->tab.current, app->syntax_defs, tab_list_layout->tab_list.rect.right,
-                 app->highlight_search, app->config_options.ui_fg_color, app->config_options.ui_bg_color);
-
-     if(app->input_complete_func){
-          CeDrawColorList_t draw_color_list = {};
-          draw_view(&app->input_view, app->config_options.tab_width, app->config_options.line_number,
-                    app->config_options.visual_line_display_type, NULL, &draw_color_list, &color_defs, app->syntax_defs);
-          ce_draw_color_list_free(&draw_color_list);
-          int64_t new_status_bar_offset = (app->input_view.rect.bottom - app->input_view.rect.top) + 1;
-          draw_view_status(&app->input_view, &app->vim, &app->macros, &app->multiple_cursors, &color_defs, 0,
-                           app->config_options.ui_fg_color, app->config_options.ui_bg_color);
-          draw_view_status(&tab_layout->tab.current->view, NULL, &app->macros, &app->multiple_cursors, &color_defs,
-                           -new_status_bar_offset, app->config_options.ui_fg_color, app->config_options.ui_bg_color);
+          view->cursor.x = terminal->snapshot.cursor.x;
+          view->cursor.y = terminal->snapshot.cursor.y + terminal->snapshot.start_line;
      }
 
      CeComplete_t* complete = ce_app_is_completing(app);
-     if(complete && tab_layout->tab.current->type == CE_LAYOUT_TYPE_VIEW && app->complete_list_buffer->line_count &&
-        strlen(app->complete_list_buffer->lines[0])){
+     bool show_complete = (complete && tab_layout->tab.current->type == CE_LAYOUT_TYPE_VIEW &&
+                           app->complete_list_buffer->line_count && strlen(app->complete_list_buffer->lines[0]));
+     if(show_complete){
           CeLayout_t* view_layout = tab_layout->tab.current;
           app->complete_view.rect.left = view_layout->view.rect.left;
           app->complete_view.rect.right = view_layout->view.rect.right - 1;
@@ -735,106 +1295,176 @@ void draw(CeApp_t* app){
                app->complete_view.rect.bottom = view_layout->view.rect.bottom - 1;
           }
           int64_t lines_to_show = app->complete_list_buffer->line_count;
-          if(lines_to_show > app->config_options.completion_line_limit){
-               lines_to_show = app->config_options.completion_line_limit;
+          if(lines_to_show > config_options->completion_line_limit){
+               lines_to_show = config_options->completion_line_limit;
           }
           app->complete_view.rect.top = app->complete_view.rect.bottom - lines_to_show;
           if(app->complete_view.rect.top <= view_layout->view.rect.top){
                app->complete_view.rect.top = view_layout->view.rect.top + 1; // account for current view's status bar
           }
+     }
+
+     CeRect_t* border_rect = NULL;
+     switch(tab_layout->tab.current->type){
+     default:
+          break;
+     case CE_LAYOUT_TYPE_LIST:
+          border_rect = &tab_layout->tab.current->list.rect;
+          break;
+     case CE_LAYOUT_TYPE_TAB:
+          border_rect = &tab_layout->tab.current->tab.rect;
+          break;
+     }
+
+     // if anything drawn over the views moves, or options that affect every view change, redraw all of the views
+     {
+          uint64_t frame_hash = FNV_OFFSET_BASIS;
+          frame_hash = hash_bytes(frame_hash, &tab_layout, sizeof(tab_layout));
+          frame_hash = hash_bytes(frame_hash, &config_options->tab_width, sizeof(config_options->tab_width));
+          frame_hash = hash_bytes(frame_hash, &config_options->line_number, sizeof(config_options->line_number));
+          frame_hash = hash_bytes(frame_hash, &config_options->visual_line_display_type,
+                                  sizeof(config_options->visual_line_display_type));
+          frame_hash = hash_bytes(frame_hash, app->syntax_defs, CE_SYNTAX_COLOR_COUNT * sizeof(*app->syntax_defs));
+          if(app->input_complete_func){
+               frame_hash = hash_bytes(frame_hash, &app->input_view.rect, sizeof(app->input_view.rect));
+          }
+          if(show_complete){
+               frame_hash = hash_bytes(frame_hash, &app->complete_view.rect, sizeof(app->complete_view.rect));
+          }
+          if(app->message_mode){
+               frame_hash = hash_bytes(frame_hash, &app->message_view.rect, sizeof(app->message_view.rect));
+          }
+          if(border_rect) frame_hash = hash_bytes(frame_hash, border_rect, sizeof(*border_rect));
+
+          screen->redraw_all = (screen->invalidated || frame_hash != screen->frame_hash);
+          screen->frame_hash = frame_hash;
+          screen->invalidated = false;
+     }
+
+     // draw a tab bar if there is more than 1 tab
+     if(tab_list_layout->tab_list.tab_count > 1){
+          int64_t right = tab_list_layout->tab_list.rect.right;
+          draw_screen_fill(screen, tab_list_layout->tab_list.rect.left, right, 0, config_options->ui_fg_color,
+                           config_options->ui_bg_color);
+
+          int64_t x = 0;
+          for(int64_t i = 0; i < tab_list_layout->tab_list.tab_count; i++){
+               int fg = config_options->ui_fg_color;
+               int bg = config_options->ui_bg_color;
+               if(tab_list_layout->tab_list.tabs[i] == tab_list_layout->tab_list.current){
+                    fg = COLOR_DEFAULT;
+                    bg = COLOR_DEFAULT;
+               }
+
+               const char* tab_name = "selection";
+               if(tab_list_layout->tab_list.tabs[i]->tab.current->type == CE_LAYOUT_TYPE_VIEW){
+                    tab_name = tab_list_layout->tab_list.tabs[i]->tab.current->view.buffer->name;
+               }
+
+               x = draw_screen_put_string(screen, x, 0, right, " ", fg, bg);
+               x = draw_screen_put_string(screen, x, 0, right, tab_name, fg, bg);
+               x = draw_screen_put_string(screen, x, 0, right, " ", fg, bg);
+          }
+     }
+
+     screen->view_job_count = 0;
+     collect_view_jobs(tab_layout, &app->vim, &app->visual, &app->terminal_list, app->input_view.buffer, screen,
+                       &app->multiple_cursors, tab_layout->tab.current, app->highlight_search);
+     int64_t buffer_job_count = chain_view_jobs_by_buffer(screen);
+     highlight_pool_highlight(&screen->highlight_pool, screen->view_jobs, screen->buffer_jobs, buffer_job_count,
+                              app->syntax_defs);
+     for(int64_t i = 0; i < screen->view_job_count; i++){
+          CeDrawViewJob_t* job = screen->view_jobs + i;
+          if(job->needs_redraw && job->syntax_function && !view_job_for_pool(job)) highlight_view_jobs(screen->view_jobs, i, app->syntax_defs);
+     }
+
+     draw_layout(tab_layout, &app->vim, &app->macros, screen, config_options->tab_width, config_options->line_number,
+                 config_options->visual_line_display_type, &app->multiple_cursors, tab_layout->tab.current, app->syntax_defs,
+                 tab_list_layout->tab_list.rect.right, config_options->ui_fg_color, config_options->ui_bg_color);
+
+     if(app->input_complete_func){
+          CeDrawColorList_t* draw_color_list = &screen->draw_color_list;
+          ce_draw_color_list_clear(draw_color_list);
+          draw_view(screen, &app->input_view, config_options->tab_width, config_options->line_number,
+                    config_options->visual_line_display_type, NULL, draw_color_list, app->syntax_defs);
+          int64_t new_status_bar_offset = (app->input_view.rect.bottom - app->input_view.rect.top) + 1;
+          draw_view_status(screen, &app->input_view, &app->vim, &app->macros, &app->multiple_cursors, 0,
+                           config_options->ui_fg_color, config_options->ui_bg_color);
+          draw_view_status(screen, &tab_layout->tab.current->view, NULL, &app->macros, &app->multiple_cursors,
+                           -new_status_bar_offset, config_options->ui_fg_color, config_options->ui_bg_color);
+     }
+
+     if(show_complete){
           app->complete_view.buffer = app->complete_list_buffer;
           app->complete_view.cursor.y = app->complete_list_buffer->cursor_save.y;
           app->complete_view.cursor.x = 0;
           app->complete_view.scroll.y = 0;
           app->complete_view.scroll.x = 0;
           ce_view_follow_cursor(&app->complete_view, 0, 0, 0); // NOTE: I don't think anyone wants their settings applied here
-          CeDrawColorList_t draw_color_list = {};
-          CeRangeList_t range_list = {};
+          CeDrawColorList_t* draw_color_list = &screen->draw_color_list;
+          CeRangeList_t* range_list = &screen->range_list;
+          ce_draw_color_list_clear(draw_color_list);
+          ce_range_list_clear(range_list);
           CeAppBufferData_t* buffer_data = app->complete_view.buffer->app_data;
-          buffer_data->syntax_function(&app->complete_view, &range_list, &draw_color_list, app->syntax_defs,
+          buffer_data->syntax_function(&app->complete_view, range_list, draw_color_list, app->syntax_defs,
                                        app->complete_view.buffer->syntax_data);
-          ce_range_list_free(&range_list);
-          draw_view(&app->complete_view, app->config_options.tab_width, app->config_options.line_number,
-                    app->config_options.visual_line_display_type, NULL, &draw_color_list, &color_defs, app->syntax_defs);
-          ce_draw_color_list_free(&draw_color_list);
+          draw_view(screen, &app->complete_view, config_options->tab_width, config_options->line_number,
+                    config_options->visual_line_display_type, NULL, draw_color_list, app->syntax_defs);
           if(app->input_complete_func){
                int64_t new_status_bar_offset = (app->complete_view.rect.bottom - app->complete_view.rect.top) + 1 + app->input_view.buffer->line_count;
-               draw_view_status(&tab_layout->tab.current->view, NULL, &app->macros, &app->multiple_cursors,
-                                &color_defs, -new_status_bar_offset, app->config_options.ui_fg_color,
-                                app->config_options.ui_bg_color);
+               draw_view_status(screen, &tab_layout->tab.current->view, NULL, &app->macros, &app->multiple_cursors,
+                                -new_status_bar_offset, config_options->ui_fg_color, config_options->ui_bg_color);
           }
      }
 
      if(app->message_mode){
-          CeDrawColorList_t draw_color_list = {};
-          CeRangeList_t range_list = {};
+          CeDrawColorList_t* draw_color_list = &screen->draw_color_list;
+          CeRangeList_t* range_list = &screen->range_list;
+          ce_draw_color_list_clear(draw_color_list);
+          ce_range_list_clear(range_list);
           CeAppBufferData_t* buffer_data = app->message_view.buffer->app_data;
-          buffer_data->syntax_function(&app->message_view, &range_list, &draw_color_list, app->syntax_defs,
+          buffer_data->syntax_function(&app->message_view, range_list, draw_color_list, app->syntax_defs,
                                        app->message_view.buffer->syntax_data);
-          ce_range_list_free(&range_list);
 
-          draw_view(&app->message_view, app->config_options.tab_width, app->config_options.line_number,
-                    app->config_options.visual_line_display_type, NULL, &draw_color_list, &color_defs, app->syntax_defs);
-          ce_draw_color_list_free(&draw_color_list);
+          draw_view(screen, &app->message_view, config_options->tab_width, config_options->line_number,
+                    config_options->visual_line_display_type, NULL, draw_color_list, app->syntax_defs);
 
           // set the specified background
           int message_len = ce_utf8_strlen(app->message_view.buffer->lines[0]);
-          int color_pair = ce_color_def_get(&color_defs, app->config_options.message_fg_color, app->config_options.message_bg_color);
-          attron(COLOR_PAIR(color_pair));
           int64_t view_width = ce_view_width(&app->message_view);
-          move(app->message_view.rect.top, app->message_view.rect.left + message_len);
-          for(int i = message_len; i < view_width; i++){
-               addch(' ');
-          }
-
+          draw_screen_fill(screen, app->message_view.rect.left + message_len, app->message_view.rect.left + view_width - 1,
+                           app->message_view.rect.top, config_options->message_fg_color, config_options->message_bg_color);
      }
 
      // show border when non view is selected
-     if(tab_layout->tab.current->type != CE_LAYOUT_TYPE_VIEW){
-          int64_t rect_height = 0;
-          int64_t rect_width = 0;
-          CeRect_t* rect = NULL;
-          switch(tab_layout->tab.current->type){
-          default:
-               break;
-          case CE_LAYOUT_TYPE_LIST:
-               rect = &tab_layout->tab.current->list.rect;
-               rect_width = rect->right - rect->left;
-               rect_height = rect->bottom - rect->top;
-               break;
-          case CE_LAYOUT_TYPE_TAB:
-               rect = &tab_layout->tab.current->tab.rect;
-               rect_width = rect->right - rect->left;
-               rect_height = rect->bottom - rect->top;
-               break;
-          }
+     if(border_rect){
+          int64_t rect_width = border_rect->right - border_rect->left;
+          int64_t rect_height = border_rect->bottom - border_rect->top;
 
-          int color_pair = ce_color_def_get(&color_defs, COLOR_BRIGHT_WHITE, COLOR_BRIGHT_WHITE);
-          attron(COLOR_PAIR(color_pair));
           for(int i = 0; i < rect_height; i++){
-               mvaddch(rect->top + i, rect->right, ' ');
-               mvaddch(rect->top + i, rect->left, ' ');
+               draw_screen_put(screen, border_rect->right, border_rect->top + i, ' ', COLOR_BRIGHT_WHITE, COLOR_BRIGHT_WHITE);
+               draw_screen_put(screen, border_rect->left, border_rect->top + i, ' ', COLOR_BRIGHT_WHITE, COLOR_BRIGHT_WHITE);
           }
 
           for(int i = 0; i < rect_width; i++){
-               mvaddch(rect->top, rect->left + i, ' ');
-               mvaddch(rect->bottom, rect->left + i, ' ');
+               draw_screen_put(screen, border_rect->left + i, border_rect->top, ' ', COLOR_BRIGHT_WHITE, COLOR_BRIGHT_WHITE);
+               draw_screen_put(screen, border_rect->left + i, border_rect->bottom, ' ', COLOR_BRIGHT_WHITE, COLOR_BRIGHT_WHITE);
           }
 
-          mvaddch(rect->bottom, rect->right, ' ');
+          draw_screen_put(screen, border_rect->right, border_rect->bottom, ' ', COLOR_BRIGHT_WHITE, COLOR_BRIGHT_WHITE);
+     }
 
-          move(0, 0);
+     CePoint_t screen_cursor = {0, 0};
+     if(border_rect){
+          // leave the cursor in the top left
      }else if(app->input_complete_func){
-          CePoint_t screen_cursor = view_cursor_on_screen(&app->input_view, app->config_options.tab_width,
-                                                          app->config_options.line_number);
-          move(screen_cursor.y, screen_cursor.x);
+          screen_cursor = view_cursor_on_screen(&app->input_view, config_options->tab_width, config_options->line_number);
      }else{
-          CePoint_t screen_cursor = view_cursor_on_screen(view, app->config_options.tab_width,
-                                                          app->config_options.line_number);
-          move(screen_cursor.y, screen_cursor.x);
+          screen_cursor = view_cursor_on_screen(view, config_options->tab_width, config_options->line_number);
      }
 
-     refresh();
+     screen->backend->flush(screen, screen_cursor);
+     screen->total_rows_redrawn += screen->rows_redrawn;
 }
 
 static int int_strneq(int* a, int* b, size_t len){
@@ -1204,6 +1834,7 @@ void app_handle_key(CeApp_t* app, CeView_t* view, int key){
                        itr->buffer == app->macro_list_buffer ||
                        itr->buffer == app->mark_list_buffer ||
                        itr->buffer == app->jump_list_buffer ||
+                       itr->buffer == app->syntax_info_buffer ||
                        itr->buffer == app->shell_command_buffer ||
                        itr->buffer == g_ce_log_buffer ||
                        itr->buffer == app->message_view.buffer ||
@@ -1429,17 +2060,46 @@ void print_help(char* program){
      printf("  -c <config file> path to shared object configuration\n");
 }
 
-void done_drawing(CeApp_t* app, struct timeval* previous_draw_time){
+// once cleared, the next update from a terminal or shell command will write to its ready fd again
+void clear_ready_to_draw(CeApp_t* app){
      CeTerminalNode_t* itr = app->terminal_list.head;
      while(itr){
-          if(itr->terminal.ready_to_draw){
-               itr->terminal.ready_to_draw = false;
-          }
+          __atomic_store_n(&itr->terminal.ready_to_draw, false, __ATOMIC_RELEASE);
           itr = itr->next;
      }
 
-     gettimeofday(previous_draw_time, NULL);
-     app->shell_command_ready_to_draw = false;
+     __atomic_store_n(&app->shell_command_ready_to_draw, false, __ATOMIC_RELEASE);
+}
+
+// terminals are only copied into what we read here, so a terminal doesn't change in the middle of handling a key or drawing
+void update_terminal_snapshots(CeApp_t* app){
+     for(CeTerminalNode_t* itr = app->terminal_list.head; itr; itr = itr->next){
+          ce_terminal_update_snapshot(&itr->terminal);
+     }
+}
+
+// lex buffers ahead of their views while there is no input, so scrolling and motions that ask about strings or comments
+// find the tokens already there
+void tokenize_buffers_while_idle(CeApp_t* app){
+     int64_t lines_left = IDLE_TOKENIZE_LINES;
+     for(CeBufferNode_t* itr = app->buffer_node_head; itr && lines_left > 0; itr = itr->next){
+          CeAppBufferData_t* buffer_data = itr->buffer->app_data;
+          if(!buffer_data) continue;
+          lines_left -= ce_syntax_tokenize(itr->buffer, buffer_data->syntax_function, lines_left);
+     }
+}
+
+bool drain_ready_fd(int fd, const char* name){
+     char buffer[BUFSIZ];
+     while(true){
+          int rc = read(fd, buffer, BUFSIZ);
+          if(rc > 0) continue;
+          if(rc == 0) return true;
+          if(errno == EINTR) continue;
+          if(errno == EAGAIN || errno == EWOULDBLOCK) return true;
+          ce_log("failed to read from %s ready fd: '%s'\n", name, strerror(errno));
+          return false;
+     }
 }
 
 int main(int argc, char** argv){
@@ -1508,6 +2168,7 @@ int main(int argc, char** argv){
           app.macro_list_buffer = new_buffer();
           app.mark_list_buffer = new_buffer();
           app.jump_list_buffer = new_buffer();
+          app.syntax_info_buffer = new_buffer();
           app.shell_command_buffer = new_buffer();
           CeBuffer_t* scratch_buffer = new_buffer();
 
@@ -1523,6 +2184,8 @@ int main(int argc, char** argv){
           ce_buffer_node_insert(&app.buffer_node_head, app.mark_list_buffer);
           ce_buffer_alloc(app.jump_list_buffer, 1, "[jumps]");
           ce_buffer_node_insert(&app.buffer_node_head, app.jump_list_buffer);
+          ce_buffer_alloc(app.syntax_info_buffer, 1, "[syntax]");
+          ce_buffer_node_insert(&app.buffer_node_head, app.syntax_info_buffer);
           ce_buffer_alloc(app.shell_command_buffer, 1, "[shell command]");
           ce_buffer_node_insert(&app.buffer_node_head, app.shell_command_buffer);
           ce_buffer_alloc(scratch_buffer, 1, "scratch");
@@ -1534,6 +2197,7 @@ int main(int argc, char** argv){
           app.macro_list_buffer->status = CE_BUFFER_STATUS_NONE;
           app.mark_list_buffer->status = CE_BUFFER_STATUS_NONE;
           app.jump_list_buffer->status = CE_BUFFER_STATUS_NONE;
+          app.syntax_info_buffer->status = CE_BUFFER_STATUS_NONE;
           app.shell_command_buffer->status = CE_BUFFER_STATUS_NONE;
           scratch_buffer->status = CE_BUFFER_STATUS_NONE;
 
@@ -1543,7 +2207,9 @@ int main(int argc, char** argv){
           app.macro_list_buffer->no_line_numbers = true;
           app.mark_list_buffer->no_line_numbers = true;
           app.jump_list_buffer->no_line_numbers = true;
+          app.syntax_info_buffer->no_line_numbers = true;
           app.shell_command_buffer->no_line_numbers = true;
+          app.shell_command_buffer->no_token_cache = true; // the shell command thread writes to it
 
           app.complete_list_buffer->no_highlight_current_line = true;
 
@@ -1560,6 +2226,8 @@ int main(int argc, char** argv){
           buffer_data->syntax_function = ce_syntax_highlight_c;
           buffer_data = app.jump_list_buffer->app_data;
           buffer_data->syntax_function = ce_syntax_highlight_c;
+          buffer_data = app.syntax_info_buffer->app_data;
+          buffer_data->syntax_function = ce_syntax_highlight_plain; // so showing the stats doesn't change them
           buffer_data = app.shell_command_buffer->app_data;
           buffer_data->syntax_function = ce_syntax_highlight_c;
           buffer_data = scratch_buffer->app_data;
@@ -1648,12 +2316,18 @@ int main(int argc, char** argv){
           config_options->vertical_scroll_off = 0;
           config_options->insert_spaces_on_tab = true;
           config_options->terminal_scroll_back = 1024;
+          config_options->terminal_scroll_back_archive = 100000;
           config_options->line_number = CE_LINE_NUMBER_NONE;
           config_options->completion_line_limit = 15;
           config_options->message_display_time_usec = 5000000; // 5 seconds
           config_options->apply_completion_key = CE_TAB;
           config_options->cycle_next_completion_key = ce_ctrl_key('n');
           config_options->cycle_prev_completion_key = ce_ctrl_key('p');
+          config_options->max_frames_per_second = 60;
+          config_options->large_file_size = 64 * 1024 * 1024;
+          config_options->large_file_line_length = 64 * 1024;
+          config_options->highlight_thread_count = sysconf(_SC_NPROCESSORS_ONLN) - 1;
+          CE_CLAMP(config_options->highlight_thread_count, 0, 7);
 
           // keybinds
           CeKeyBindDef_t normal_mode_bind_defs[] = {
@@ -1740,8 +2414,17 @@ int main(int argc, char** argv){
           }
      }
 
+     // the files from the command line were loaded before the large file thresholds were configured
+     for(CeBufferNode_t* itr = app.buffer_node_head; itr; itr = itr->next){
+          determine_large_file(itr->buffer, &app.config_options);
+     }
+
+     highlight_pool_start(&app.draw_screen.highlight_pool, app.config_options.highlight_thread_count);
+
      pipe(g_terminal_ready_fds);
      pipe(g_shell_command_ready_fds);
+     fcntl(g_terminal_ready_fds[0], F_SETFL, O_NONBLOCK);
+     fcntl(g_shell_command_ready_fds[0], F_SETFL, O_NONBLOCK);
 
      draw(&app);
 
@@ -1749,6 +2432,11 @@ int main(int argc, char** argv){
      struct timeval current_draw_time = {};
      uint64_t time_since_last_message = 0;
 
+     // output from terminals and shell commands is drawn at most once per frame, key input is drawn immediately
+     struct timeval last_frame_time = {};
+     gettimeofday(&last_frame_time, NULL);
+     bool redraw_pending = false;
+
      // main loop
      while(!app.quit){
           // TODO: add shell command buffer
@@ -1767,14 +2455,30 @@ int main(int argc, char** argv){
                input_fds[2].events = POLLIN;
           }
 
-          int poll_rc = poll(input_fds, input_fd_count, 10);
+          uint64_t frame_usec = 0;
+          if(app.config_options.max_frames_per_second > 0) frame_usec = 1000000 / app.config_options.max_frames_per_second;
+
+          int poll_timeout = 10;
+          if(redraw_pending){
+               struct timeval now;
+               gettimeofday(&now, NULL);
+               uint64_t elapsed = time_between(last_frame_time, now);
+               poll_timeout = (elapsed >= frame_usec) ? 0 : (frame_usec - elapsed + 999) / 1000;
+          }
+
+          int poll_rc = poll(input_fds, input_fd_count, poll_timeout);
           switch(poll_rc){
           default:
                break;
           case -1:
                assert(errno == EINTR);
-          case 0:
                continue;
+          case 0:
+               if(!redraw_pending){
+                    tokenize_buffers_while_idle(&app);
+                    continue;
+               }
+               break;
           }
 
           bool check_stdin = false;
@@ -1784,27 +2488,19 @@ int main(int argc, char** argv){
           }
 
           if(input_fds[1].revents != 0){
-               char buffer[BUFSIZ];
-               int rc;
-               do{
-                    rc = read(g_terminal_ready_fds[0], buffer, BUFSIZ);
-               }while(rc == -1 && errno == EINTR);
-               if(rc < 0){
-                    ce_log("failed to read from terminal ready fd: '%s'\n", strerror(errno));
-                    continue;
-               }
+               if(!drain_ready_fd(g_terminal_ready_fds[0], "terminal")) continue;
+               redraw_pending = true;
           }
 
           if(input_fds[2].revents != 0){
-               char buffer[BUFSIZ];
-               int rc;
-               do{
-                    rc = read(g_shell_command_ready_fds[0], buffer, BUFSIZ);
-               }while(rc == -1 && errno == EINTR);
-               if(rc < 0){
-                    ce_log("failed to read from shell command ready fd: '%s'\n", strerror(errno));
-                    continue;
-               }
+               if(!drain_ready_fd(g_shell_command_ready_fds[0], "shell command")) continue;
+               redraw_pending = true;
+          }
+
+          if(!check_stdin){
+               struct timeval now;
+               gettimeofday(&now, NULL);
+               if(time_between(last_frame_time, now) < frame_usec) continue;
           }
 
           if(app.message_mode){
@@ -1828,6 +2524,7 @@ int main(int argc, char** argv){
 
           int key = ERR;
 
+          update_terminal_snapshots(&app);
           if(check_stdin) key = getch();
 
           // TODO: compress with below
@@ -1836,7 +2533,7 @@ int main(int argc, char** argv){
                if(terminal){
                     if(app.vim.mode == CE_VIM_MODE_INSERT){
                          view->scroll.x = 0;
-                         view->scroll.y = terminal->start_line;
+                         view->scroll.y = terminal->snapshot.start_line;
                     }else{
                          ce_view_follow_cursor(view, 0, 0, app.config_options.tab_width);
                     }
@@ -1847,7 +2544,7 @@ int main(int argc, char** argv){
           CeTerminalNode_t* itr = app.terminal_list.head;
           CeTerminalNode_t* prev = NULL;
           while(itr){
-               if(itr->terminal.killed){
+               if(__atomic_load_n(&itr->terminal.killed, __ATOMIC_ACQUIRE)){
                     if(prev){
                          prev->next = itr->next;
                     }else{
@@ -1911,6 +2608,9 @@ int main(int argc, char** argv){
           // handle input from the user
           app_handle_key(&app, view, key);
 
+          // the changes the key made have moved the other cursors by now, buffers without undo don't need them anymore
+          if(view->buffer && view->buffer->no_undo) ce_buffer_forget_changes(view->buffer);
+
           // update refs to view and tab_layout
           tab_layout = app.tab_list_layout->tab_list.current;
 
@@ -1927,7 +2627,7 @@ int main(int argc, char** argv){
                if(terminal){
                     if(app.vim.mode == CE_VIM_MODE_INSERT){
                          view->scroll.x = 0;
-                         view->scroll.y = terminal->start_line;
+                         view->scroll.y = terminal->snapshot.start_line;
                     }else{
                          ce_view_follow_cursor(view, 0, 0, app.config_options.tab_width);
                     }
@@ -1963,7 +2663,15 @@ int main(int argc, char** argv){
                build_jump_list(app.jump_list_buffer, &view_data->jump_list);
           }
 
+          if(ce_layout_buffer_in_view(tab_layout, app.syntax_info_buffer)){
+               build_syntax_info(app.syntax_info_buffer, app.buffer_node_head);
+          }
+
+          clear_ready_to_draw(&app);
+          update_terminal_snapshots(&app);
           draw(&app);
+          gettimeofday(&last_frame_time, NULL);
+          redraw_pending = false;
      }
 
      // cleanup
@@ -1975,6 +2683,19 @@ int main(int argc, char** argv){
      ce_macros_free(&app.macros);
      ce_complete_free(&app.input_complete);
 
+     free(app.draw_screen.cells);
+     free(app.draw_screen.drawn_cells);
+     free(app.draw_screen.vt_output.bytes);
+     ce_draw_color_list_free(&app.draw_screen.draw_color_list);
+     ce_range_list_free(&app.draw_screen.range_list);
+     highlight_pool_stop(&app.draw_screen.highlight_pool);
+     for(int64_t i = 0; i < app.draw_screen.view_job_capacity; i++){
+          ce_draw_color_list_free(&app.draw_screen.view_jobs[i].draw_color_list);
+          ce_range_list_free(&app.draw_screen.view_jobs[i].range_list);
+     }
+     free(app.draw_screen.view_jobs);
+     free(app.draw_screen.buffer_jobs);
+
      CeKeyBinds_t* binds = &app.key_binds;
      for(int64_t i = 0; i < binds->count; ++i){
           ce_command_free(&binds->binds[i].command);
@@ -2017,6 +2738,7 @@ int main(int argc, char** argv){
      ce_history_free(&app.command_history);
      ce_history_free(&app.search_history);
 
+     if(app.draw_screen.backend && app.draw_screen.backend->stop) app.draw_screen.backend->stop(&app.draw_screen);
      endwin();
      return 0;
 }
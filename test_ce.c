@@ -465,6 +465,64 @@ TEST(buffer_dupe_string_too_long){
      EXPECT(dupe == NULL);
 }
 
+TEST(buffer_edit_shifts_tokens){
+     CeBuffer_t buffer = {};
+     ce_buffer_load_string(&buffer, g_multiline_string, g_name);
+     buffer.tokens.lines = calloc(3, sizeof(*buffer.tokens.lines));
+     buffer.tokens.count = 3;
+     buffer.tokens.capacity = 3;
+     buffer.tokens.valid_count = 3;
+     buffer.tokens.dirty_end = 3;
+     buffer.tokens.lines[1].start_state = 5;
+     buffer.tokens.lines[2].start_state = 7;
+
+     // the line after the split keeps its tokens, the split line and the new line have to be lexed again
+     EXPECT(ce_buffer_insert_string(&buffer, "x\n", (CePoint_t){0, 1}));
+     EXPECT(buffer.tokens.count == 4);
+     EXPECT(buffer.tokens.valid_count == 1);
+     EXPECT(buffer.tokens.dirty_end == 3);
+     EXPECT(buffer.tokens.lines[1].start_state == 5);
+     EXPECT(buffer.tokens.lines[3].start_state == 7);
+
+     EXPECT(ce_buffer_remove_lines(&buffer, 1, 1));
+     EXPECT(buffer.tokens.count == 3);
+     EXPECT(buffer.tokens.valid_count == 1);
+     EXPECT(buffer.tokens.dirty_end == 2);
+     EXPECT(buffer.tokens.lines[1].start_state == 5);
+     EXPECT(buffer.tokens.lines[2].start_state == 7);
+
+     EXPECT(ce_buffer_remove_string(&buffer, (CePoint_t){0, 0}, 1));
+     EXPECT(buffer.tokens.valid_count == 0);
+     ce_buffer_free(&buffer);
+     EXPECT(buffer.tokens.count == 0);
+}
+
+TEST(buffer_change_without_undo){
+     CeBuffer_t buffer = {};
+     ce_buffer_load_string(&buffer, g_multiline_string, g_name);
+     buffer.no_undo = true;
+
+     CePoint_t cursor = {0, 0};
+     CeBufferChangeNode_t* before_change_node = buffer.change_node;
+     EXPECT(ce_buffer_insert_string_change(&buffer, strdup("taco"), (CePoint_t){2, 1}, &cursor, (CePoint_t){6, 1}, false));
+     EXPECT(strcmp(buffer.lines[1], "abtacocdefghij") == 0);
+
+     // other cursors still move with the change until it is forgotten
+     CePoint_t other_cursor = ce_move_point_based_on_buffer_changes(&buffer, before_change_node, (CePoint_t){8, 1});
+     EXPECT(other_cursor.x == 12 && other_cursor.y == 1);
+     ce_buffer_forget_changes(&buffer);
+     EXPECT(buffer.change_node == NULL);
+
+     EXPECT(ce_buffer_remove_string_change(&buffer, (CePoint_t){0, 0}, 1, &cursor, (CePoint_t){0, 0}, false));
+     EXPECT(strcmp(buffer.lines[0], "123456789") == 0);
+     ce_buffer_forget_changes(&buffer);
+     EXPECT(buffer.change_node == NULL);
+     EXPECT(ce_buffer_undo(&buffer, &cursor));
+     EXPECT(strcmp(buffer.lines[0], "123456789") == 0);
+
+     ce_buffer_free(&buffer);
+}
+
 TEST(view_follow_cursor){
      int64_t tab_width = 2;
      int64_t horizontal_scroll_off = 2;
@@ -583,7 +641,7 @@ TEST(util_visible_index_to_string_index){
 
 int main()
 {
-     g_ce_log_buffer = malloc(sizeof(*g_ce_log_buffer));
+     g_ce_log_buffer = calloc(1, sizeof(*g_ce_log_buffer));
      ce_buffer_alloc(g_ce_log_buffer, 1, "[log]");
      ce_log_init("ce_test.log");
      setlocale(LC_ALL, "");
@@ -0,0 +1,368 @@
+#include "test.h"
+#include "ce_syntax.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+#include <pthread.h>
+
+FILE* g_ce_log = NULL;
+CeBuffer_t* g_ce_log_buffer = NULL;
+
+static CeSyntaxDef_t g_syntax_defs[CE_SYNTAX_COLOR_COUNT];
+
+static void setup_syntax_defs(){
+     for(int i = 0; i < CE_SYNTAX_COLOR_COUNT; i++){
+          g_syntax_defs[i].fg = i;
+          g_syntax_defs[i].bg = COLOR_DEFAULT;
+     }
+     g_syntax_defs[CE_SYNTAX_COLOR_NORMAL].fg = COLOR_DEFAULT;
+}
+
+static void highlight(CeSyntaxHighlightFunc_t* highlight_func, CeBuffer_t* buffer, int64_t scroll_y, CeDrawColorList_t* draw_color_list){
+     CeView_t view = {};
+     view.buffer = buffer;
+     view.rect = (CeRect_t){0, 79, 0, 0};
+     view.scroll.y = scroll_y;
+     view.cursor = (CePoint_t){0, buffer->line_count};
+     CeRangeList_t range_list = {};
+     ce_draw_color_list_clear(draw_color_list);
+     highlight_func(&view, &range_list, draw_color_list, g_syntax_defs, NULL);
+     ce_range_list_free(&range_list);
+}
+
+// returns the foreground color the highlighter left in effect at the point
+static int color_at(CeDrawColorList_t* draw_color_list, CePoint_t point){
+     int fg = COLOR_DEFAULT;
+     for(CeDrawColorNode_t* node = draw_color_list->head; node; node = node->next){
+          if(ce_point_after(node->point, point)) break;
+          fg = node->fg;
+     }
+     return fg;
+}
+
+TEST(c_string_with_utf8){
+     CeBuffer_t buffer = {};
+     ce_buffer_load_string(&buffer, "x = \"¢€\"; y", "test.c");
+     CeDrawColorList_t draw_color_list = {};
+     highlight(ce_syntax_highlight_c, &buffer, 0, &draw_color_list);
+     EXPECT(color_at(&draw_color_list, (CePoint_t){7, 0}) == CE_SYNTAX_COLOR_STRING);
+     EXPECT(color_at(&draw_color_list, (CePoint_t){8, 0}) == COLOR_DEFAULT);
+     ce_draw_color_list_free(&draw_color_list);
+     ce_buffer_free(&buffer);
+}
+
+TEST(c_multiline_comment_above_view){
+     CeBuffer_t buffer = {};
+     ce_buffer_load_string(&buffer, "char* s = \"/*\"; /* real\ncomment */ int b;\nint c;", "test.c");
+     CeDrawColorList_t draw_color_list = {};
+     highlight(ce_syntax_highlight_c, &buffer, 1, &draw_color_list);
+     EXPECT(color_at(&draw_color_list, (CePoint_t){0, 1}) == CE_SYNTAX_COLOR_COMMENT);
+     highlight(ce_syntax_highlight_c, &buffer, 2, &draw_color_list);
+     EXPECT(color_at(&draw_color_list, (CePoint_t){0, 2}) == CE_SYNTAX_COLOR_TYPE);
+
+     // the states are cached now, turning the comment into a line comment has to be picked up
+     EXPECT(ce_buffer_insert_string(&buffer, "//", (CePoint_t){16, 0}));
+     highlight(ce_syntax_highlight_c, &buffer, 1, &draw_color_list);
+     EXPECT(color_at(&draw_color_list, (CePoint_t){0, 1}) != CE_SYNTAX_COLOR_COMMENT);
+     ce_draw_color_list_free(&draw_color_list);
+     ce_buffer_free(&buffer);
+}
+
+TEST(buffer_without_token_cache_keeps_no_tokens){
+     CeBuffer_t buffer = {};
+     ce_buffer_load_string(&buffer, "int a; /* real\ncomment */ int b;\nint c;", "test.c");
+     buffer.no_token_cache = true;
+     CeDrawColorList_t draw_color_list = {};
+     highlight(ce_syntax_highlight_c, &buffer, 1, &draw_color_list);
+     EXPECT(color_at(&draw_color_list, (CePoint_t){0, 1}) == CE_SYNTAX_COLOR_COMMENT);
+     EXPECT(ce_buffer_insert_string(&buffer, "int d;\n", (CePoint_t){0, 2}));
+     highlight(ce_syntax_highlight_c, &buffer, 2, &draw_color_list);
+     EXPECT(color_at(&draw_color_list, (CePoint_t){0, 2}) == CE_SYNTAX_COLOR_TYPE);
+     CeSyntaxColor_t syntax_class = CE_SYNTAX_COLOR_NORMAL;
+     EXPECT(ce_syntax_token_at(&buffer, ce_syntax_highlight_c, (CePoint_t){2, 1}, &syntax_class));
+     EXPECT(syntax_class == CE_SYNTAX_COLOR_COMMENT);
+     EXPECT(ce_syntax_tokenize(&buffer, ce_syntax_highlight_c, 100) == 0);
+     EXPECT(buffer.tokens.count == 0 && buffer.tokens.lines == NULL);
+     ce_draw_color_list_free(&draw_color_list);
+     ce_buffer_free(&buffer);
+}
+
+static char* repeated_lines(const char* line, int64_t count){
+     int64_t line_len = strlen(line);
+     char* string = malloc(line_len * count + 1);
+     for(int64_t i = 0; i < count; i++) memcpy(string + i * line_len, line, line_len);
+     string[line_len * count] = 0;
+     return string;
+}
+
+static int64_t cache_lookups(CeSyntaxCacheStats_t before, CeSyntaxCacheStats_t after){
+     return (after.hits - before.hits) + (after.misses - before.misses);
+}
+
+TEST(buffer_without_token_cache_lexes_a_window_above_the_view){
+     const int64_t line_count = 4 * CE_SYNTAX_DRAW_LEX_LINES;
+     char* string = repeated_lines("int a; /* comment */\n", line_count);
+     CeBuffer_t buffer = {};
+     ce_buffer_load_string(&buffer, string, "test.c");
+     free(string);
+     buffer.no_token_cache = true;
+     CeDrawColorList_t draw_color_list = {};
+
+     CeSyntaxCacheStats_t before = ce_syntax_cache_stats();
+     highlight(ce_syntax_highlight_c, &buffer, line_count - 1, &draw_color_list);
+     CeSyntaxCacheStats_t after = ce_syntax_cache_stats();
+     EXPECT(cache_lookups(before, after) == CE_SYNTAX_LOOK_BACK_LINES + 1);
+     EXPECT(color_at(&draw_color_list, (CePoint_t){0, line_count - 1}) == CE_SYNTAX_COLOR_TYPE);
+
+     CeSyntaxColor_t syntax_class = CE_SYNTAX_COLOR_NORMAL;
+     before = ce_syntax_cache_stats();
+     EXPECT(ce_syntax_token_at(&buffer, ce_syntax_highlight_c, (CePoint_t){8, line_count - 2}, &syntax_class));
+     after = ce_syntax_cache_stats();
+     EXPECT(syntax_class == CE_SYNTAX_COLOR_COMMENT);
+     EXPECT(cache_lookups(before, after) == CE_SYNTAX_LOOK_BACK_LINES + 1);
+     ce_draw_color_list_free(&draw_color_list);
+     ce_buffer_free(&buffer);
+}
+
+TEST(highlighting_leaves_most_of_a_large_buffer_for_idle){
+     const int64_t line_count = 4 * CE_SYNTAX_DRAW_LEX_LINES;
+     char* string = repeated_lines("int a; /* comment */\n", line_count);
+     CeBuffer_t buffer = {};
+     ce_buffer_load_string(&buffer, string, "test.c");
+     free(string);
+     CeDrawColorList_t draw_color_list = {};
+
+     highlight(ce_syntax_highlight_c, &buffer, line_count - 1, &draw_color_list);
+     EXPECT(buffer.tokens.valid_count == CE_SYNTAX_DRAW_LEX_LINES);
+     EXPECT(color_at(&draw_color_list, (CePoint_t){0, line_count - 1}) == CE_SYNTAX_COLOR_TYPE);
+
+     EXPECT(ce_syntax_tokenize(&buffer, ce_syntax_highlight_c, INT64_MAX) == line_count - CE_SYNTAX_DRAW_LEX_LINES + 1);
+     CeSyntaxCacheStats_t before = ce_syntax_cache_stats();
+     highlight(ce_syntax_highlight_c, &buffer, line_count - 1, &draw_color_list);
+     CeSyntaxCacheStats_t after = ce_syntax_cache_stats();
+     EXPECT(cache_lookups(before, after) == 0);
+     EXPECT(color_at(&draw_color_list, (CePoint_t){0, line_count - 1}) == CE_SYNTAX_COLOR_TYPE);
+     ce_draw_color_list_free(&draw_color_list);
+     ce_buffer_free(&buffer);
+}
+
+TEST(python_docstring_above_view){
+     CeBuffer_t buffer = {};
+     ce_buffer_load_string(&buffer, "def f():\n    \"\"\"doc # not a comment\n    more\n    \"\"\"\n    return 1", "test.py");
+     CeDrawColorList_t draw_color_list = {};
+     highlight(ce_syntax_highlight_python, &buffer, 2, &draw_color_list);
+     EXPECT(color_at(&draw_color_list, (CePoint_t){0, 2}) == CE_SYNTAX_COLOR_STRING);
+     highlight(ce_syntax_highlight_python, &buffer, 4, &draw_color_list);
+     EXPECT(color_at(&draw_color_list, (CePoint_t){4, 4}) == CE_SYNTAX_COLOR_CONTROL);
+     ce_draw_color_list_free(&draw_color_list);
+     ce_buffer_free(&buffer);
+}
+
+TEST(keywords_sharing_a_prefix){
+     CeBuffer_t buffer = {};
+     ce_buffer_load_string(&buffer, "assert as asserts", "test.py");
+     CeDrawColorList_t draw_color_list = {};
+     highlight(ce_syntax_highlight_python, &buffer, 0, &draw_color_list);
+     EXPECT(color_at(&draw_color_list, (CePoint_t){0, 0}) == CE_SYNTAX_COLOR_KEYWORD);
+     EXPECT(color_at(&draw_color_list, (CePoint_t){7, 0}) == CE_SYNTAX_COLOR_KEYWORD);
+     EXPECT(color_at(&draw_color_list, (CePoint_t){10, 0}) == COLOR_DEFAULT);
+
+     ce_buffer_load_string(&buffer, "done; size_t do", "test.sh");
+     highlight(ce_syntax_highlight_bash, &buffer, 0, &draw_color_list);
+     EXPECT(color_at(&draw_color_list, (CePoint_t){0, 0}) == CE_SYNTAX_COLOR_KEYWORD);
+     EXPECT(color_at(&draw_color_list, (CePoint_t){6, 0}) == COLOR_DEFAULT);
+     EXPECT(color_at(&draw_color_list, (CePoint_t){13, 0}) == CE_SYNTAX_COLOR_KEYWORD);
+
+     ce_buffer_load_string(&buffer, "my_size_t x; static_cast", "test.cpp");
+     highlight(ce_syntax_highlight_cpp, &buffer, 0, &draw_color_list);
+     EXPECT(color_at(&draw_color_list, (CePoint_t){0, 0}) == CE_SYNTAX_COLOR_TYPE);
+     EXPECT(color_at(&draw_color_list, (CePoint_t){13, 0}) == CE_SYNTAX_COLOR_KEYWORD);
+     ce_draw_color_list_free(&draw_color_list);
+     ce_buffer_free(&buffer);
+}
+
+TEST(declarative_lexers){
+     CeBuffer_t buffer = {};
+     ce_buffer_load_string(&buffer, "s := `raw\nstill raw`\nreturn nil", "test.go");
+     CeDrawColorList_t draw_color_list = {};
+     highlight(ce_syntax_highlight_go, &buffer, 1, &draw_color_list);
+     EXPECT(color_at(&draw_color_list, (CePoint_t){0, 1}) == CE_SYNTAX_COLOR_STRING);
+     highlight(ce_syntax_highlight_go, &buffer, 2, &draw_color_list);
+     EXPECT(color_at(&draw_color_list, (CePoint_t){0, 2}) == CE_SYNTAX_COLOR_CONTROL);
+
+     ce_buffer_load_string(&buffer, "# title\na # b", "test.md");
+     highlight(ce_syntax_highlight_markdown, &buffer, 0, &draw_color_list);
+     EXPECT(color_at(&draw_color_list, (CePoint_t){2, 0}) == CE_SYNTAX_COLOR_KEYWORD);
+     highlight(ce_syntax_highlight_markdown, &buffer, 1, &draw_color_list);
+     EXPECT(color_at(&draw_color_list, (CePoint_t){2, 1}) == COLOR_DEFAULT);
+
+     ce_buffer_load_string(&buffer, "{\"a\": true, \"b\": nullable}", "test.json");
+     highlight(ce_syntax_highlight_json, &buffer, 0, &draw_color_list);
+     EXPECT(color_at(&draw_color_list, (CePoint_t){1, 0}) == CE_SYNTAX_COLOR_STRING);
+     EXPECT(color_at(&draw_color_list, (CePoint_t){6, 0}) == CE_SYNTAX_COLOR_KEYWORD);
+     EXPECT(color_at(&draw_color_list, (CePoint_t){18, 0}) == COLOR_DEFAULT);
+     ce_draw_color_list_free(&draw_color_list);
+     ce_buffer_free(&buffer);
+}
+
+static bool line_tokens_equal(const CeBufferLineTokens_t* a, const CeBufferLineTokens_t* b){
+     if(a->start_state != b->start_state || a->count != b->count) return false;
+     for(int32_t i = 0; i < a->count; i++){
+          if(a->tokens[i].start != b->tokens[i].start || a->tokens[i].len != b->tokens[i].len ||
+             a->tokens[i].syntax_class != b->tokens[i].syntax_class) return false;
+     }
+     return true;
+}
+
+TEST(tokens_resync_after_edits){
+     CeBuffer_t buffer = {};
+     ce_buffer_load_string(&buffer, "int a; /* one\n(two\nthree */ int b;\nchar* s = \"(\";\nint c;", "test.c");
+     EXPECT(ce_syntax_tokenize(&buffer, ce_syntax_highlight_c, 2) == 2);
+     EXPECT(ce_syntax_tokenize(&buffer, ce_syntax_highlight_c, 100) == 3);
+     EXPECT(ce_syntax_tokenize(&buffer, ce_syntax_highlight_c, 100) == 0);
+     EXPECT(ce_syntax_tokenize(&buffer, ce_syntax_highlight_plain, 100) == 0);
+
+     CeSyntaxColor_t syntax_class;
+     EXPECT(ce_syntax_token_at(&buffer, ce_syntax_highlight_c, (CePoint_t){0, 1}, &syntax_class));
+     EXPECT(syntax_class == CE_SYNTAX_COLOR_COMMENT);
+     EXPECT(ce_syntax_token_at(&buffer, ce_syntax_highlight_c, (CePoint_t){11, 3}, &syntax_class));
+     EXPECT(syntax_class == CE_SYNTAX_COLOR_STRING);
+     EXPECT(ce_syntax_token_at(&buffer, ce_syntax_highlight_c, (CePoint_t){4, 4}, &syntax_class));
+     EXPECT(syntax_class == CE_SYNTAX_COLOR_NORMAL);
+     EXPECT(!ce_syntax_token_at(&buffer, ce_syntax_highlight_plain, (CePoint_t){0, 1}, &syntax_class));
+
+     // an edit that doesn't change the state lines start in only lexes the edited line
+     EXPECT(ce_buffer_insert_string(&buffer, "x", (CePoint_t){0, 3}));
+     EXPECT(ce_syntax_tokenize(&buffer, ce_syntax_highlight_c, 100) == 1);
+
+     // closing the comment early changes the lines after it, add and remove lines along the way
+     EXPECT(ce_buffer_insert_string(&buffer, "*/\n\n", (CePoint_t){0, 1}));
+     EXPECT(ce_buffer_remove_lines(&buffer, 5, 1));
+     EXPECT(ce_syntax_token_at(&buffer, ce_syntax_highlight_c, (CePoint_t){0, 3}, &syntax_class));
+     EXPECT(syntax_class == CE_SYNTAX_COLOR_NORMAL);
+     ce_syntax_tokenize(&buffer, ce_syntax_highlight_c, 100);
+
+     CeBuffer_t fresh = {};
+     ce_buffer_alloc(&fresh, buffer.line_count, "fresh.c");
+     for(int64_t i = 0; i < buffer.line_count; i++){
+          free(fresh.lines[i]);
+          fresh.lines[i] = strdup(buffer.lines[i]);
+     }
+     ce_syntax_tokenize(&fresh, ce_syntax_highlight_c, 100);
+     EXPECT(fresh.tokens.count == buffer.tokens.count);
+     for(int64_t i = 0; i < fresh.tokens.count; i++){
+          EXPECT(line_tokens_equal(fresh.tokens.lines + i, buffer.tokens.lines + i));
+     }
+
+     ce_buffer_free(&fresh);
+     ce_buffer_free(&buffer);
+}
+
+TEST(span_cache_reuses_lexed_lines){
+     CeBuffer_t buffer = {};
+     ce_buffer_load_string(&buffer, "int span_cache_a;\nint span_cache_a;\nint span_cache_b;", "test.c");
+     CeSyntaxCacheStats_t before = ce_syntax_cache_stats();
+     ce_syntax_tokenize(&buffer, ce_syntax_highlight_c, 100);
+     CeSyntaxCacheStats_t after = ce_syntax_cache_stats();
+     EXPECT(after.misses - before.misses == 2);
+     EXPECT(after.hits - before.hits == 1);
+
+     // opening a comment on the first line changes the state the others start in, closing it again finds them cached
+     EXPECT(ce_buffer_insert_string(&buffer, "/*", (CePoint_t){0, 0}));
+     ce_syntax_tokenize(&buffer, ce_syntax_highlight_c, 100);
+     before = ce_syntax_cache_stats();
+     EXPECT(ce_buffer_remove_string(&buffer, (CePoint_t){0, 0}, 2));
+     ce_syntax_tokenize(&buffer, ce_syntax_highlight_c, 100);
+     after = ce_syntax_cache_stats();
+     EXPECT(after.misses == before.misses);
+     EXPECT(after.hits - before.hits == 3);
+
+     CeSyntaxColor_t syntax_class;
+     EXPECT(ce_syntax_token_at(&buffer, ce_syntax_highlight_c, (CePoint_t){0, 2}, &syntax_class));
+     EXPECT(syntax_class == CE_SYNTAX_COLOR_TYPE);
+     ce_buffer_free(&buffer);
+}
+
+#define CONCURRENT_VIEW_COUNT 4
+
+typedef struct{
+     CeBuffer_t buffer;
+     CeDrawColorList_t draw_color_list;
+}ConcurrentView_t;
+
+static void* highlight_concurrent_view(void* data){
+     ConcurrentView_t* concurrent_view = data;
+     CeView_t view = {};
+     view.buffer = &concurrent_view->buffer;
+     view.rect = (CeRect_t){0, 79, 0, 63};
+     view.cursor = (CePoint_t){0, concurrent_view->buffer.line_count};
+     CeRangeList_t range_list = {};
+     ce_draw_color_list_clear(&concurrent_view->draw_color_list);
+     ce_syntax_highlight_rust(&view, &range_list, &concurrent_view->draw_color_list, g_syntax_defs, NULL);
+     ce_range_list_free(&range_list);
+     return NULL;
+}
+
+// views are highlighted on several threads at once, they share the lexer and span cache but must come out the same
+TEST(concurrent_views_highlight_the_same){
+     const char* string = "fn main() {\n    /* one\n    two */ let x = \"s\";\n    return 0x1F;\n}\n";
+     ConcurrentView_t views[CONCURRENT_VIEW_COUNT] = {};
+     pthread_t threads[CONCURRENT_VIEW_COUNT];
+     for(int i = 0; i < CONCURRENT_VIEW_COUNT; i++){
+          ce_buffer_load_string(&views[i].buffer, string, "test.rs");
+     }
+     for(int i = 0; i < CONCURRENT_VIEW_COUNT; i++){
+          EXPECT(pthread_create(threads + i, NULL, highlight_concurrent_view, views + i) == 0);
+     }
+     for(int i = 0; i < CONCURRENT_VIEW_COUNT; i++){
+          pthread_join(threads[i], NULL);
+     }
+
+     EXPECT(color_at(&views[0].draw_color_list, (CePoint_t){0, 2}) == CE_SYNTAX_COLOR_COMMENT);
+     for(int i = 1; i < CONCURRENT_VIEW_COUNT; i++){
+          CeDrawColorNode_t* a = views[0].draw_color_list.head;
+          CeDrawColorNode_t* b = views[i].draw_color_list.head;
+          while(a && b){
+               EXPECT(a->fg == b->fg && a->bg == b->bg && ce_points_equal(a->point, b->point));
+               a = a->next;
+               b = b->next;
+          }
+          EXPECT(a == NULL && b == NULL);
+     }
+
+     for(int i = 0; i < CONCURRENT_VIEW_COUNT; i++){
+          ce_draw_color_list_free(&views[i].draw_color_list);
+          ce_buffer_free(&views[i].buffer);
+     }
+}
+
+TEST(range_list_insert_sorted_keeps_order_while_growing){
+     CeRangeList_t range_list = {};
+     int64_t count = 1000; // enough to grow the array several times
+     EXPECT(ce_range_list_insert(&range_list, (CePoint_t){0, 0}, (CePoint_t){5, 0}));
+     for(int64_t i = 1; i < count; i++){
+          EXPECT(ce_range_list_insert_sorted(&range_list, (CePoint_t){0, i}, (CePoint_t){5, i}));
+     }
+     // ranges that would go before the tail are rejected
+     EXPECT(!ce_range_list_insert_sorted(&range_list, (CePoint_t){7, 0}, (CePoint_t){8, 0}));
+
+     int64_t y = 0;
+     for(CeRangeNode_t* node = range_list.head; node; node = node->next){
+          EXPECT(node->range.start.y == y);
+          y++;
+     }
+     EXPECT(y == count);
+     EXPECT(range_list.tail && range_list.tail->range.start.y == count - 1);
+     ce_range_list_free(&range_list);
+}
+
+int main()
+{
+     g_ce_log_buffer = calloc(1, sizeof(*g_ce_log_buffer));
+     ce_buffer_alloc(g_ce_log_buffer, 1, "[log]");
+     ce_log_init("ce_test.log");
+     setlocale(LC_ALL, "");
+     setup_syntax_defs();
+     RUN_TESTS();
+}
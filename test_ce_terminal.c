@@ -0,0 +1,697 @@
+#include "test.h"
+#include "ce_terminal.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+#include <ncurses.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+FILE* g_ce_log = NULL;
+CeBuffer_t* g_ce_log_buffer = NULL;
+
+#define TERMINAL_WIDTH 80
+#define TERMINAL_HEIGHT 24
+#define TERMINAL_SCROLL_BACK 1024
+#define TERMINAL_SCROLL_BACK_ARCHIVE 4096
+#define STRESS_OUTPUT_BYTES (2 * 1024 * 1024)
+
+static void write_string(CeTerminal_t* terminal, const char* string){
+     ce_terminal_write_output(terminal, string, strlen(string));
+}
+
+static const char* screen_line(CeTerminal_t* terminal, int64_t y){
+     ce_terminal_update_snapshot(terminal);
+     return terminal->buffer->lines[terminal->snapshot.start_line + y];
+}
+
+static const CeTerminalLine_t* screen_attributes(CeTerminal_t* terminal, int64_t y){
+     const CeTerminalScreen_t* screen = &terminal->screen;
+     return screen->lines + ((screen->head + terminal->start_line + y) % screen->capacity);
+}
+
+static bool line_starts_with(const char* line, const char* prefix){
+     return strncmp(line, prefix, strlen(prefix)) == 0;
+}
+
+TEST(printable_run_fills_line){
+     CeTerminal_t terminal = {};
+     EXPECT(ce_terminal_init_headless(&terminal, TERMINAL_WIDTH, TERMINAL_HEIGHT, TERMINAL_SCROLL_BACK, 0, "terminal"));
+     write_string(&terminal, "hello world\r\nsecond");
+     EXPECT(line_starts_with(screen_line(&terminal, 0), "hello world "));
+     EXPECT(line_starts_with(screen_line(&terminal, 1), "second "));
+     EXPECT(terminal.cursor.x == 6 && terminal.cursor.y == 1);
+     EXPECT(screen_attributes(&terminal, 0)->count == 1);
+     ce_terminal_free(&terminal);
+}
+
+TEST(printable_run_keeps_attribute_spans){
+     CeTerminal_t terminal = {};
+     EXPECT(ce_terminal_init_headless(&terminal, TERMINAL_WIDTH, TERMINAL_HEIGHT, TERMINAL_SCROLL_BACK, 0, "terminal"));
+     write_string(&terminal, "ab\033[31mred\033[0mcd");
+     EXPECT(line_starts_with(screen_line(&terminal, 0), "abredcd "));
+
+     const CeTerminalLine_t* line = screen_attributes(&terminal, 0);
+     EXPECT(line->count == 3);
+     if(line->count == 3){
+          EXPECT(line->spans[0].start == 0 && line->spans[0].len == 2);
+          EXPECT(line->spans[1].start == 2 && line->spans[1].len == 3 && line->spans[1].glyph.foreground == COLOR_RED);
+          EXPECT(line->spans[2].start == 5 && line->spans[2].len == TERMINAL_WIDTH - 5);
+     }
+     ce_terminal_free(&terminal);
+}
+
+TEST(printable_run_replaces_multibyte_runes){
+     CeTerminal_t terminal = {};
+     EXPECT(ce_terminal_init_headless(&terminal, TERMINAL_WIDTH, TERMINAL_HEIGHT, TERMINAL_SCROLL_BACK, 0, "terminal"));
+     write_string(&terminal, "¢€¢€ tail\rab");
+     EXPECT(line_starts_with(screen_line(&terminal, 0), "ab¢€ tail "));
+     ce_terminal_free(&terminal);
+}
+
+TEST(invalid_utf8_becomes_replacement_rune){
+     CeTerminal_t terminal = {};
+     EXPECT(ce_terminal_init_headless(&terminal, TERMINAL_WIDTH, TERMINAL_HEIGHT, TERMINAL_SCROLL_BACK, 0, "terminal"));
+     write_string(&terminal, "a\xff" "b\xe2\x82" "c\xed\xa0\x80" "d\xc0\xaf" "e");
+     EXPECT(line_starts_with(screen_line(&terminal, 0), "a�b�c�d�e "));
+     ce_terminal_free(&terminal);
+}
+
+TEST(printable_run_wraps_at_end_of_line){
+     CeTerminal_t terminal = {};
+     EXPECT(ce_terminal_init_headless(&terminal, TERMINAL_WIDTH, TERMINAL_HEIGHT, TERMINAL_SCROLL_BACK, 0, "terminal"));
+     char line[TERMINAL_WIDTH + 4];
+     memset(line, 'x', TERMINAL_WIDTH);
+     memcpy(line + TERMINAL_WIDTH, "yz", 3);
+     write_string(&terminal, line);
+     EXPECT(strncmp(screen_line(&terminal, 0), line, TERMINAL_WIDTH) == 0);
+     EXPECT(screen_attributes(&terminal, 0)->wrapped);
+     EXPECT(line_starts_with(screen_line(&terminal, 1), "yz "));
+     EXPECT(terminal.cursor.x == 2 && terminal.cursor.y == 1);
+     ce_terminal_free(&terminal);
+}
+
+TEST(buffer_text_waits_for_snapshot){
+     CeTerminal_t terminal = {};
+     EXPECT(ce_terminal_init_headless(&terminal, TERMINAL_WIDTH, TERMINAL_HEIGHT, TERMINAL_SCROLL_BACK, 0, "terminal"));
+     write_string(&terminal, "first\rsecond ¢");
+     const char* text = terminal.buffer->lines[terminal.start_line];
+     EXPECT(line_starts_with(text, "     "));
+     EXPECT(screen_attributes(&terminal, 0)->dirty);
+     EXPECT(line_starts_with(screen_line(&terminal, 0), "second ¢ "));
+     EXPECT(!screen_attributes(&terminal, 0)->dirty);
+     EXPECT(!screen_attributes(&terminal, 1)->dirty);
+     ce_terminal_free(&terminal);
+}
+
+TEST(scroll_back_grows_then_reuses_oldest_lines){
+     CeTerminal_t terminal = {};
+     const int64_t line_count = TERMINAL_HEIGHT + 8;
+     EXPECT(ce_terminal_init_headless(&terminal, TERMINAL_WIDTH, TERMINAL_HEIGHT, line_count, 0, "terminal"));
+     EXPECT(terminal.buffer->line_count == TERMINAL_HEIGHT);
+
+     char line[64];
+     for(int i = 0; i < 40; i++){
+          snprintf(line, sizeof(line), "line %d\r\n", i);
+          write_string(&terminal, line);
+     }
+
+     // 31 lines were printed into the 32 kept, the last one is where the cursor is
+     ce_terminal_update_snapshot(&terminal);
+     EXPECT(terminal.buffer->line_count == line_count);
+     EXPECT(terminal.start_line == line_count - TERMINAL_HEIGHT);
+     EXPECT(line_starts_with(terminal.buffer->lines[0], "line 9 "));
+     EXPECT(line_starts_with(terminal.buffer->lines[line_count - 2], "line 39 "));
+     EXPECT(line_starts_with(screen_line(&terminal, 0), "line 17 "));
+     EXPECT(line_starts_with(screen_line(&terminal, TERMINAL_HEIGHT - 1), "    "));
+     ce_terminal_free(&terminal);
+}
+
+TEST(scroll_back_archives_lines_past_the_ring){
+     CeTerminal_t terminal = {};
+     const int64_t line_count = TERMINAL_HEIGHT + 8;
+     EXPECT(ce_terminal_init_headless(&terminal, TERMINAL_WIDTH, TERMINAL_HEIGHT, line_count, TERMINAL_SCROLL_BACK_ARCHIVE, "terminal"));
+
+     char line[64];
+     for(int i = 0; i < 40; i++){
+          snprintf(line, sizeof(line), "line %d\r\n", i);
+          write_string(&terminal, line);
+     }
+
+     // the 9 lines that fell out of the ring come first, without their trailing blanks
+     ce_terminal_update_snapshot(&terminal);
+     EXPECT(terminal.snapshot.archived == 9);
+     EXPECT(terminal.buffer->line_count == 9 + line_count);
+     EXPECT(strcmp(terminal.buffer->lines[0], "line 0") == 0);
+     EXPECT(strcmp(terminal.buffer->lines[8], "line 8") == 0);
+     EXPECT(line_starts_with(terminal.buffer->lines[9], "line 9 "));
+     EXPECT(line_starts_with(screen_line(&terminal, 0), "line 17 "));
+     ce_terminal_free(&terminal);
+}
+
+TEST(scroll_back_archive_drops_oldest_blocks){
+     CeTerminal_t terminal = {};
+     const int64_t archive_line_count = 1000;
+     EXPECT(ce_terminal_init_headless(&terminal, TERMINAL_WIDTH, TERMINAL_HEIGHT, TERMINAL_HEIGHT, archive_line_count, "terminal"));
+
+     char line[TERMINAL_WIDTH];
+     const int total = 5000;
+     for(int i = 0; i < total; i++){
+          snprintf(line, sizeof(line), "line %d %060d\r\n", i, 0);
+          write_string(&terminal, line);
+          if(i % 1000 == 999) ce_terminal_update_snapshot(&terminal);
+     }
+
+     // whole blocks are dropped, so we keep at least as many lines as asked for but less than another block's worth
+     ce_terminal_update_snapshot(&terminal);
+     int64_t archived = terminal.snapshot.archived;
+     EXPECT(archived >= archive_line_count);
+     EXPECT(archived < archive_line_count + CE_TERMINAL_ARCHIVE_BLOCK_SIZE / 64);
+
+     int64_t first = total - archived - (TERMINAL_HEIGHT - 1);
+     bool in_order = true;
+     for(int64_t y = 0; y < archived; y++){
+          snprintf(line, sizeof(line), "line %ld ", first + y);
+          if(!line_starts_with(terminal.buffer->lines[y], line)) in_order = false;
+     }
+     EXPECT(in_order);
+     ce_terminal_free(&terminal);
+}
+
+TEST(alternate_screen_is_allocated_while_used){
+     CeTerminal_t terminal = {};
+     EXPECT(ce_terminal_init_headless(&terminal, TERMINAL_WIDTH, TERMINAL_HEIGHT, TERMINAL_SCROLL_BACK, 0, "terminal"));
+     EXPECT(terminal.alternate_screen.lines == NULL);
+     EXPECT(terminal.alternate_lines_buffer->line_count == 0);
+
+     // the alternate screen doesn't scroll back
+     write_string(&terminal, "\033[?1049h");
+     EXPECT(terminal.screen.capacity == TERMINAL_HEIGHT);
+     char line[64];
+     for(int i = 0; i < 100; i++){
+          snprintf(line, sizeof(line), "line %d\r\n", i);
+          write_string(&terminal, line);
+     }
+     ce_terminal_update_snapshot(&terminal);
+     EXPECT(terminal.snapshot.buffer == terminal.alternate_lines_buffer);
+     EXPECT(terminal.alternate_lines_buffer->line_count == TERMINAL_HEIGHT);
+     EXPECT(line_starts_with(screen_line(&terminal, 0), "line 77 "));
+
+     // leaving keeps it around for a while, then it is freed
+     write_string(&terminal, "\033[?1049l");
+     ce_terminal_update_snapshot(&terminal);
+     EXPECT(terminal.alternate_screen.lines != NULL);
+     terminal.alternate_screen_left -= CE_TERMINAL_ALTERNATE_SCREEN_KEEP_SECONDS;
+     ce_terminal_update_snapshot(&terminal);
+     EXPECT(terminal.alternate_screen.lines == NULL);
+     EXPECT(terminal.alternate_lines_buffer->line_count == 0);
+
+     write_string(&terminal, "\033[?1049h");
+     EXPECT(line_starts_with(screen_line(&terminal, 0), "    "));
+     ce_terminal_free(&terminal);
+}
+
+TEST(resize_sizes_alternate_screen_to_rows){
+     CeTerminal_t terminal = {};
+     EXPECT(ce_terminal_init_headless(&terminal, TERMINAL_WIDTH, TERMINAL_HEIGHT, TERMINAL_HEIGHT, 0, "terminal"));
+     write_string(&terminal, "\033[?1049h");
+
+     // taller than the primary screen's scroll back grows it too
+     ce_terminal_resize(&terminal, TERMINAL_WIDTH, TERMINAL_HEIGHT + 4);
+     EXPECT(terminal.line_count == TERMINAL_HEIGHT + 4);
+     EXPECT(terminal.screen.capacity == TERMINAL_HEIGHT + 4);
+     EXPECT(terminal.alternate_screen.capacity == TERMINAL_HEIGHT + 4);
+     EXPECT(terminal.alternate_lines_buffer->line_count == TERMINAL_HEIGHT + 4);
+
+     ce_terminal_resize(&terminal, TERMINAL_WIDTH, TERMINAL_HEIGHT - 4);
+     EXPECT(terminal.screen.capacity == TERMINAL_HEIGHT - 4);
+     EXPECT(terminal.alternate_lines_buffer->line_count == TERMINAL_HEIGHT - 4);
+     EXPECT(terminal.alternate_screen.capacity == TERMINAL_HEIGHT + 4);
+     ce_terminal_free(&terminal);
+}
+
+static void write_repeated(CeTerminal_t* terminal, char c, int count){
+     for(int i = 0; i < count; i++) ce_terminal_write_output(terminal, &c, 1);
+}
+
+TEST(resize_reflows_wrapped_lines){
+     CeTerminal_t terminal = {};
+     EXPECT(ce_terminal_init_headless(&terminal, TERMINAL_WIDTH, TERMINAL_HEIGHT, TERMINAL_SCROLL_BACK, 0, "terminal"));
+     write_string(&terminal, "\033[31m");
+     write_repeated(&terminal, 'a', 100);
+     write_string(&terminal, "\033[0m\r\n$ ");
+     EXPECT(screen_attributes(&terminal, 0)->wrapped);
+     EXPECT(terminal.cursor.x == 2 && terminal.cursor.y == 2);
+
+     ce_terminal_resize(&terminal, 120, TERMINAL_HEIGHT);
+     EXPECT(strspn(screen_line(&terminal, 0), "a") == 100);
+     EXPECT(line_starts_with(screen_line(&terminal, 1), "$ "));
+     EXPECT(!screen_attributes(&terminal, 0)->wrapped);
+     EXPECT(screen_attributes(&terminal, 0)->spans[0].len == 100);
+     EXPECT(screen_attributes(&terminal, 0)->spans[0].glyph.foreground == COLOR_RED);
+     EXPECT(terminal.cursor.x == 2 && terminal.cursor.y == 1);
+
+     ce_terminal_resize(&terminal, 50, TERMINAL_HEIGHT);
+     EXPECT(strspn(screen_line(&terminal, 0), "a") == 50);
+     EXPECT(strspn(screen_line(&terminal, 1), "a") == 50);
+     EXPECT(line_starts_with(screen_line(&terminal, 2), "$ "));
+     EXPECT(screen_attributes(&terminal, 0)->wrapped && !screen_attributes(&terminal, 1)->wrapped);
+     EXPECT(terminal.cursor.x == 2 && terminal.cursor.y == 2);
+
+     // text written after the resize wraps at the new width
+     write_repeated(&terminal, 'b', 60);
+     EXPECT(strspn(screen_line(&terminal, 2) + 2, "b") == 48);
+     EXPECT(strspn(screen_line(&terminal, 3), "b") == 12);
+     EXPECT(terminal.cursor.x == 12 && terminal.cursor.y == 3);
+     ce_terminal_free(&terminal);
+}
+
+// the tty thread widens the scroll back lines as they come back around, but the buffer still points at their text
+TEST(resize_leaves_snapshot_text_until_next_snapshot){
+     CeTerminal_t terminal = {};
+     EXPECT(ce_terminal_init_headless(&terminal, 20, 4, 8, 0, "terminal"));
+     char line[64];
+     for(int i = 0; i < 8; i++){
+          snprintf(line, sizeof(line), "line %d\r\n", i);
+          write_string(&terminal, line);
+     }
+     ce_terminal_resize(&terminal, 60, 4);
+     char first[64];
+     snprintf(first, sizeof(first), "%s", terminal.buffer->lines[0]);
+
+     for(int i = 8; i < 24; i++){
+          snprintf(line, sizeof(line), "line %d\r\n", i);
+          write_string(&terminal, line);
+     }
+     EXPECT(strcmp(terminal.buffer->lines[0], first) == 0);
+
+     ce_terminal_update_snapshot(&terminal);
+     EXPECT(line_starts_with(terminal.buffer->lines[0], "line 17 "));
+     EXPECT(strlen(terminal.buffer->lines[0]) == 60);
+     ce_terminal_free(&terminal);
+}
+
+TEST(resize_keeps_cursor_on_screen){
+     CeTerminal_t terminal = {};
+     EXPECT(ce_terminal_init_headless(&terminal, TERMINAL_WIDTH, TERMINAL_HEIGHT, TERMINAL_SCROLL_BACK, 0, "terminal"));
+     write_string(&terminal, "one\r\ntwo");
+
+     // the blank lines under the cursor go instead of the output above it
+     ce_terminal_resize(&terminal, TERMINAL_WIDTH, 10);
+     EXPECT(line_starts_with(screen_line(&terminal, 0), "one "));
+     EXPECT(terminal.cursor.x == 3 && terminal.cursor.y == 1);
+
+     char line[64];
+     for(int i = 0; i < 30; i++){
+          snprintf(line, sizeof(line), "\r\nline %d", i);
+          write_string(&terminal, line);
+     }
+     ce_terminal_resize(&terminal, TERMINAL_WIDTH, TERMINAL_HEIGHT);
+     EXPECT(terminal.cursor.y == TERMINAL_HEIGHT - 1);
+     EXPECT(line_starts_with(screen_line(&terminal, TERMINAL_HEIGHT - 1), "line 29 "));
+     EXPECT(line_starts_with(screen_line(&terminal, 0), "line 6 "));
+     ce_terminal_free(&terminal);
+}
+
+TEST(scroll_back_archive_joins_wrapped_lines){
+     CeTerminal_t terminal = {};
+     EXPECT(ce_terminal_init_headless(&terminal, TERMINAL_WIDTH, TERMINAL_HEIGHT, TERMINAL_HEIGHT, TERMINAL_SCROLL_BACK_ARCHIVE, "terminal"));
+     write_repeated(&terminal, 'b', 200);
+     write_string(&terminal, "\r\n");
+     for(int i = 0; i < TERMINAL_HEIGHT; i++) write_string(&terminal, "x\r\n");
+
+     ce_terminal_update_snapshot(&terminal);
+     EXPECT(terminal.snapshot.archived == 2);
+     EXPECT(strlen(terminal.buffer->lines[0]) == 200 && strspn(terminal.buffer->lines[0], "b") == 200);
+     EXPECT(strcmp(terminal.buffer->lines[1], "x") == 0);
+     ce_terminal_free(&terminal);
+}
+
+// a log with some colored levels, like what builds and servers print
+static char* generate_output(int64_t size){
+     char* output = malloc(size);
+     if(!output) return NULL;
+     static const char* levels[] = {"INFO", "\033[33mWARN\033[0m", "INFO", "\033[1;31mERROR\033[0m", "DEBUG"};
+     int64_t len = 0;
+     char line[256];
+     for(int64_t i = 0; len < size; i++){
+          int line_len = snprintf(line, sizeof(line), "2024-01-01 12:00:%02ld [%s] request %ld handled in %ld ms path=/api/v1/items/%ld\r\n",
+                                  i % 60, levels[i % 5], i, (i * 7) % 1000, i * 13);
+          if(len + line_len > size) line_len = size - len;
+          memcpy(output + len, line, line_len);
+          len += line_len;
+     }
+     return output;
+}
+
+typedef struct{
+     CeTerminal_t* terminal;
+     const char* output;
+     int64_t output_len;
+     bool done;
+}OutputWriter_t;
+
+static void* write_output_in_chunks(void* data){
+     OutputWriter_t* writer = data;
+     for(int64_t i = 0; i < writer->output_len; i += BUFSIZ){
+          int64_t len = writer->output_len - i;
+          if(len > BUFSIZ) len = BUFSIZ;
+          ce_terminal_write_output(writer->terminal, writer->output + i, len);
+     }
+     __atomic_store_n(&writer->done, true, __ATOMIC_RELEASE);
+     return NULL;
+}
+
+static bool snapshot_is_whole(const CeTerminal_t* terminal){
+     const CeTerminalSnapshot_t* snapshot = &terminal->snapshot;
+     if(snapshot->cursor.x < 0 || snapshot->cursor.x >= TERMINAL_WIDTH) return false;
+     if(snapshot->cursor.y < 0 || snapshot->cursor.y >= TERMINAL_HEIGHT) return false;
+
+     // wrapped lines are joined when they are archived, so each one is a whole line of the log
+     for(int64_t y = 0; y < snapshot->archived; y++){
+          if(!line_starts_with(snapshot->buffer->lines[y], "2024-01-01 ")) return false;
+     }
+
+     for(int64_t y = snapshot->archived; y < snapshot->buffer->line_count; y++){
+          const CeTerminalLineCopy_t* line = snapshot->lines[y - snapshot->archived];
+          if(snapshot->buffer->lines[y] != line->text) return false;
+          if(ce_utf8_strlen(line->text) != TERMINAL_WIDTH) return false;
+
+          int32_t x = 0;
+          for(int32_t s = 0; s < line->count; s++){
+               if(line->spans[s].start != x) return false;
+               x += line->spans[s].len;
+          }
+          if(x != TERMINAL_WIDTH) return false;
+     }
+     return true;
+}
+
+// run this under -fsanitize=thread to check the snapshot doesn't race with the tty thread
+TEST(snapshot_while_output_is_written){
+     CeTerminal_t terminal = {};
+     EXPECT(ce_terminal_init_headless(&terminal, TERMINAL_WIDTH, TERMINAL_HEIGHT, TERMINAL_SCROLL_BACK, TERMINAL_SCROLL_BACK_ARCHIVE,
+                                      "terminal"));
+     OutputWriter_t writer = {&terminal, generate_output(STRESS_OUTPUT_BYTES), STRESS_OUTPUT_BYTES, false};
+     EXPECT(writer.output);
+     if(!writer.output) return;
+
+     pthread_t thread;
+     EXPECT(pthread_create(&thread, NULL, write_output_in_chunks, &writer) == 0);
+     int64_t snapshot_count = 0;
+     bool whole = true;
+     do{
+          ce_terminal_update_snapshot(&terminal);
+          if(!snapshot_is_whole(&terminal)) whole = false;
+          snapshot_count++;
+     }while(!__atomic_load_n(&writer.done, __ATOMIC_ACQUIRE));
+     pthread_join(thread, NULL);
+
+     EXPECT(whole);
+     EXPECT(snapshot_count > 0);
+
+     // once the writer is done, the last snapshot matches the same output written on one thread
+     CeTerminal_t expected = {};
+     EXPECT(ce_terminal_init_headless(&expected, TERMINAL_WIDTH, TERMINAL_HEIGHT, TERMINAL_SCROLL_BACK, TERMINAL_SCROLL_BACK_ARCHIVE,
+                                      "expected"));
+     ce_terminal_write_output(&expected, writer.output, writer.output_len);
+     ce_terminal_update_snapshot(&expected);
+     ce_terminal_update_snapshot(&terminal);
+     EXPECT(terminal.lines_buffer->line_count == expected.lines_buffer->line_count);
+     EXPECT(terminal.snapshot.archived == expected.snapshot.archived);
+     for(int64_t y = 0; y < terminal.lines_buffer->line_count && y < expected.lines_buffer->line_count; y++){
+          EXPECT(strcmp(terminal.lines_buffer->lines[y], expected.lines_buffer->lines[y]) == 0);
+     }
+
+     ce_terminal_free(&expected);
+     ce_terminal_free(&terminal);
+     free((char*)(writer.output));
+}
+
+#define CONFORMANCE_WIDTH 20
+#define CONFORMANCE_HEIGHT 4
+
+typedef struct{
+     const char* output;
+     const char* lines[CONFORMANCE_HEIGHT]; // only the text before the trailing blanks
+     int32_t x;
+     int32_t y;
+}ConformanceCase_t;
+
+// how the parser handled these before it was driven by a table, anything it doesn't handle should be swallowed whole
+static const ConformanceCase_t g_conformance_cases[] = {
+     {"abc", {"abc"}, 3, 0},
+     {"ab\r\ncd", {"ab", "cd"}, 2, 1},
+     {"a\x7f" "b\x05\x11" "c", {"abc"}, 3, 0},
+     {"abcdef\033[3Dx", {"abcxef"}, 4, 0},
+     {"\033[3;5Hx", {"", "", "    x"}, 5, 2},
+     {"\033[;3Hx", {"  x"}, 3, 0},
+     {"\033[2;Hx", {"", "x"}, 1, 1},
+     {"\033[Hx\033[2Bx\033[Ax\033[3Cx", {"x", "  x   x", " x"}, 7, 1},
+     {"\033[99999999999Cx", {"                   x"}, 19, 0},
+     {"abcdef\033[3D\033[K", {"abc"}, 3, 0},
+     {"ab\r\ncd\r\nef\033[1J", {"", "", ""}, 2, 2},
+     {"abcdef\r\033[2@", {"  abcdef"}, 0, 0},
+     {"abcdef\r\033[2P", {"cdef"}, 0, 0},
+     {"abcdef\r\033[2X", {"  cdef"}, 0, 0},
+     {"a\r\nb\r\nc\033[H\033[Lx", {"x", "a", "b", "c"}, 1, 0},
+     {"a\r\nb\r\nc\033[H\033[Mx", {"x", "c"}, 1, 0},
+     {"abc\033[4h\r\033[2Cx\033[4ly", {"abxy"}, 4, 0},
+     {"\033[?7l01234567890123456789xy", {"0123456789012345678y"}, 19, 0},
+     {"\033[2;3r\033[2;1Ha\r\nb\033[Sc", {"", "b", " c"}, 2, 2},
+     {"\033[3;1Hx\0337\033[H\0338y", {"", "", "xy"}, 2, 2},
+     {"\033[3;1Hx\033[s\033[H\033[uy", {"", "", "xy"}, 2, 2},
+     {"a\033Db\033Ec", {"a", " b", "c"}, 1, 2},
+     {"\033[2;1Ha\033Mb\033Mc", {"  c", " b", "a"}, 3, 0},
+     {"a\033(Bb\033)0c\033#8d\033%Ge", {"abcde"}, 5, 0},
+     {"a\033]0;title\ab\033]2;t\033\\c", {"abc"}, 3, 0},
+     {"a\033]0;tìtle\ab", {"ab"}, 2, 0},
+     {"a\033Pq#0;2;0;0;0#0~~\033\\b\033_apc\033\\c\033^pm\033\\d", {"abcd"}, 4, 0},
+     {"a\xc2\x9d" "0;t\xc2\x9c" "b\xc2\x85" "c", {"ab", "c"}, 1, 1},
+     {"\033[2\r;3Hx", {"", "  x"}, 3, 1},
+     {"a\033[3\033[Cb", {"a b"}, 3, 0},
+     {"a\033[>cb\033[2 qc\033[1$pd", {"abcd"}, 4, 0},
+     {"a\033[?25l\033[?1h\033[?1000h\033[?2004hb\033[?25h", {"ab"}, 2, 0},
+     {"a\033[1;4;31;42mb\033[38;5;196;48;2;1;2;3mc\033[md", {"abcd"}, 4, 0},
+     {"a\033[?1049hb", {" b"}, 2, 0},
+     {"a\033[?1049hb\033[?1049lc", {"ac"}, 2, 0},
+     {"abc\033cd", {"d"}, 1, 0},
+     {"a\tb", {"a    b"}, 6, 0},
+
+     // these follow DEC's parser where the old one didn't: CAN ends a sequence, the 8 bit CSI starts one, sequences
+     // with colons are ignored and arguments past the last one we keep don't stop the sequence from being handled
+     {"a\033[3\030Cb", {"aCb"}, 3, 0},
+     {"a\xc2\x9b" "2Cb", {"a  b"}, 4, 0},
+     {"a\033[38:2:1:2:3mb", {"ab"}, 2, 0},
+     {"\033[2;3;1;1;1;1;1;1;1;1;1;1;1;1;1;1;1;1Hx", {"", "  x"}, 3, 1},
+};
+
+TEST(parser_conformance){
+     bool all = true;
+     for(size_t i = 0; i < sizeof(g_conformance_cases) / sizeof(g_conformance_cases[0]); i++){
+          const ConformanceCase_t* conformance = g_conformance_cases + i;
+          CeTerminal_t terminal = {};
+          EXPECT(ce_terminal_init_headless(&terminal, CONFORMANCE_WIDTH, CONFORMANCE_HEIGHT, CONFORMANCE_HEIGHT, 0, "terminal"));
+          write_string(&terminal, conformance->output);
+
+          bool match = terminal.cursor.x == conformance->x && terminal.cursor.y == conformance->y;
+          for(int64_t y = 0; y < CONFORMANCE_HEIGHT; y++){
+               const char* expected = conformance->lines[y] ? conformance->lines[y] : "";
+               const char* line = screen_line(&terminal, y);
+               if(!line_starts_with(line, expected)) match = false;
+               for(const char* c = line + strlen(expected); *c; c++){
+                    if(*c != ' ') match = false;
+               }
+          }
+
+          if(!match){
+               printf("conformance case %zu doesn't match, cursor %d, %d\n", i, terminal.cursor.x, terminal.cursor.y);
+               for(int64_t y = 0; y < CONFORMANCE_HEIGHT; y++) printf("  '%s'\n", screen_line(&terminal, y));
+               all = false;
+          }
+          ce_terminal_free(&terminal);
+     }
+     EXPECT(all);
+}
+
+TEST(parser_keeps_attributes){
+     CeTerminal_t terminal = {};
+     EXPECT(ce_terminal_init_headless(&terminal, TERMINAL_WIDTH, TERMINAL_HEIGHT, TERMINAL_SCROLL_BACK, 0, "terminal"));
+     write_string(&terminal, "\033[1;4;31;42ma\033[38;5;196;48;5;21mb\033[0;7mc\033[md");
+     screen_line(&terminal, 0);
+     const CeTerminalLine_t* line = screen_attributes(&terminal, 0);
+     EXPECT(line->count == 4);
+     if(line->count == 4){
+          EXPECT(line->spans[0].glyph.foreground == COLOR_RED && line->spans[0].glyph.background == COLOR_GREEN);
+          EXPECT(line->spans[0].glyph.attributes == (CE_TERMINAL_GLYPH_ATTRIBUTE_BOLD | CE_TERMINAL_GLYPH_ATTRIBUTE_UNDERLINE));
+          EXPECT(line->spans[1].glyph.foreground == 196 && line->spans[1].glyph.background == 21);
+          EXPECT(line->spans[2].glyph.attributes == CE_TERMINAL_GLYPH_ATTRIBUTE_REVERSE);
+          EXPECT(line->spans[3].glyph.attributes == CE_TERMINAL_GLYPH_ATTRIBUTE_NONE);
+          EXPECT(line->spans[3].glyph.foreground == COLOR_DEFAULT && line->spans[3].glyph.background == COLOR_DEFAULT);
+     }
+     ce_terminal_free(&terminal);
+}
+
+static bool terminals_match(CeTerminal_t* a, CeTerminal_t* b){
+     ce_terminal_update_snapshot(a);
+     ce_terminal_update_snapshot(b);
+     if(a->buffer->line_count != b->buffer->line_count) return false;
+     if(a->cursor.x != b->cursor.x || a->cursor.y != b->cursor.y) return false;
+     for(int64_t y = 0; y < a->buffer->line_count; y++){
+          if(strcmp(a->buffer->lines[y], b->buffer->lines[y]) != 0) return false;
+     }
+     return true;
+}
+
+// reads can end anywhere, including in the middle of a utf8 sequence or an escape
+TEST(output_split_at_every_byte_matches_whole_output){
+     const char* output = "plain ascii that runs long enough to wrap past the end of the line at eighty columns wide\r\n"
+                          "\033[31m¢ € 𝄞 漢字\033[0m \033]0;títle\a\033[1;32mgrün\033[0m\r\n"
+                          "bad \xff \xe2\x82 \xed\xa0\x80 \xc0\xaf \xf4\x90\x80\x80 end\r\n"
+                          "\033[2A\033[5C\xe2\x94\x80\xe2\x94\x80\033[K\r\n";
+     int64_t len = strlen(output);
+
+     CeTerminal_t expected = {};
+     EXPECT(ce_terminal_init_headless(&expected, TERMINAL_WIDTH, TERMINAL_HEIGHT, TERMINAL_HEIGHT, 0, "expected"));
+     ce_terminal_write_output(&expected, output, len);
+
+     bool match = true;
+     for(int64_t split = 1; split < len; split++){
+          CeTerminal_t terminal = {};
+          EXPECT(ce_terminal_init_headless(&terminal, TERMINAL_WIDTH, TERMINAL_HEIGHT, TERMINAL_HEIGHT, 0, "terminal"));
+          ce_terminal_write_output(&terminal, output, split);
+          ce_terminal_write_output(&terminal, output + split, len - split);
+          if(!terminals_match(&terminal, &expected)){
+               printf("output split at byte %ld doesn't match\n", split);
+               match = false;
+          }
+          ce_terminal_free(&terminal);
+     }
+     EXPECT(match);
+
+     CeTerminal_t terminal = {};
+     EXPECT(ce_terminal_init_headless(&terminal, TERMINAL_WIDTH, TERMINAL_HEIGHT, TERMINAL_HEIGHT, 0, "terminal"));
+     for(int64_t i = 0; i < len; i++) ce_terminal_write_output(&terminal, output + i, 1);
+     EXPECT(terminals_match(&terminal, &expected));
+     ce_terminal_free(&terminal);
+     ce_terminal_free(&expected);
+}
+
+// the tty thread hands output over on its own time, so keep taking snapshots until the line shows up
+static bool wait_for_line(CeTerminal_t* terminal, const char* text){
+     for(int i = 0; i < 500; i++){
+          ce_terminal_update_snapshot(terminal);
+          for(int64_t y = 0; y < terminal->buffer->line_count; y++){
+               if(line_starts_with(terminal->buffer->lines[y], text)) return true;
+          }
+          usleep(10000);
+     }
+     return false;
+}
+
+TEST(tty_thread_reads_every_terminal){
+     // the shell is a script, so the output doesn't depend on the user's shell or its prompt
+     char shell[] = "/tmp/ce_test_shell_XXXXXX";
+     int file_descriptor = mkstemp(shell);
+     EXPECT(file_descriptor >= 0);
+     if(file_descriptor < 0) return;
+     const char* script = "#!/bin/sh\nseq 1 5000\necho done\nexec sleep 10\n";
+     EXPECT(write(file_descriptor, script, strlen(script)) == (ssize_t)(strlen(script)));
+     fchmod(file_descriptor, 0700);
+     close(file_descriptor);
+     setenv("SHELL", shell, 1);
+     EXPECT(pipe(g_terminal_ready_fds) == 0);
+
+     CeTerminal_t terminals[3] = {};
+     for(int i = 0; i < 3; i++){
+          EXPECT(ce_terminal_init(terminals + i, TERMINAL_WIDTH, TERMINAL_HEIGHT, TERMINAL_SCROLL_BACK,
+                                  TERMINAL_SCROLL_BACK_ARCHIVE, "terminal"));
+     }
+     for(int i = 0; i < 3; i++){
+          EXPECT(wait_for_line(terminals + i, "done"));
+          EXPECT(wait_for_line(terminals + i, "4999"));
+          EXPECT(!terminals[i].killed);
+     }
+
+     // the thread keeps reading the others once one is freed
+     ce_terminal_free(terminals + 1);
+     ce_terminal_free(terminals);
+     ce_terminal_free(terminals + 2);
+
+     close(g_terminal_ready_fds[0]);
+     close(g_terminal_ready_fds[1]);
+     unlink(shell);
+}
+
+TEST(capture_records_output_and_resizes){
+     char filepath[] = "/tmp/ce_test_capture_XXXXXX";
+     int file_descriptor = mkstemp(filepath);
+     EXPECT(file_descriptor >= 0);
+     if(file_descriptor < 0) return;
+     close(file_descriptor);
+
+     CeTerminal_t terminal = {};
+     EXPECT(ce_terminal_init_headless(&terminal, TERMINAL_WIDTH, TERMINAL_HEIGHT, TERMINAL_SCROLL_BACK, 0, "terminal"));
+     write_string(&terminal, "before");
+     EXPECT(ce_terminal_capture_start(&terminal, filepath));
+     write_string(&terminal, "\033[31mred");
+     ce_terminal_resize(&terminal, 40, 10);
+     write_string(&terminal, "after");
+     ce_terminal_capture_stop(&terminal);
+     write_string(&terminal, "stopped");
+     ce_terminal_free(&terminal);
+
+     char expected[256];
+     int64_t expected_len = 0;
+     CeTerminalCaptureHeader_t header = {};
+     memcpy(header.magic, CE_TERMINAL_CAPTURE_MAGIC, sizeof(header.magic));
+     header.columns = TERMINAL_WIDTH;
+     header.rows = TERMINAL_HEIGHT;
+     memcpy(expected, &header, sizeof(header));
+     expected_len += sizeof(header);
+
+     char capture[256];
+     FILE* file = fopen(filepath, "rb");
+     EXPECT(file);
+     if(!file) return;
+     int64_t capture_len = fread(capture, 1, sizeof(capture), file);
+     fclose(file);
+     unlink(filepath);
+
+     // the timestamps can't be known ahead of time, so they are copied over
+     int32_t size[2] = {40, 10};
+     struct{
+          CeTerminalCaptureRecordType_t type;
+          const void* bytes;
+          int32_t length;
+     }records[] = {
+          {CE_TERMINAL_CAPTURE_RECORD_OUTPUT, "\033[31mred", 8},
+          {CE_TERMINAL_CAPTURE_RECORD_RESIZE, size, sizeof(size)},
+          {CE_TERMINAL_CAPTURE_RECORD_OUTPUT, "after", 5},
+     };
+     int64_t last_nanoseconds = 0;
+     for(int64_t i = 0; i < 3 && expected_len + (int64_t)(sizeof(CeTerminalCaptureRecord_t)) <= capture_len; i++){
+          CeTerminalCaptureRecord_t record;
+          memcpy(&record, capture + expected_len, sizeof(record));
+          EXPECT(record.nanoseconds >= last_nanoseconds);
+          last_nanoseconds = record.nanoseconds;
+          record.type = records[i].type;
+          record.length = records[i].length;
+          memcpy(expected + expected_len, &record, sizeof(record));
+          expected_len += sizeof(record);
+          memcpy(expected + expected_len, records[i].bytes, records[i].length);
+          expected_len += records[i].length;
+     }
+     EXPECT(capture_len == expected_len);
+     EXPECT(memcmp(capture, expected, expected_len) == 0);
+}
+
+int main()
+{
+     g_ce_log_buffer = calloc(1, sizeof(*g_ce_log_buffer));
+     ce_buffer_alloc(g_ce_log_buffer, 1, "[log]");
+     ce_log_init("ce_test.log");
+     setlocale(LC_ALL, "");
+     RUN_TESTS();
+}